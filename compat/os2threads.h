@@ -101,6 +101,19 @@ static av_always_inline int pthread_join(pthread_t thread, void **value_ptr)
     return 0;
 }
 
+/* Only the tid is set, which is all pthread_equal() compares. */
+static av_always_inline pthread_t pthread_self(void)
+{
+    pthread_t thread = { 0 };
+    thread.tid = _gettid();
+    return thread;
+}
+
+static av_always_inline int pthread_equal(pthread_t t1, pthread_t t2)
+{
+    return t1.tid == t2.tid;
+}
+
 static av_always_inline int pthread_mutex_init(pthread_mutex_t *mutex,
                                                const pthread_mutexattr_t *attr)
 {
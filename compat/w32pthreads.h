@@ -51,6 +51,7 @@ typedef struct pthread_t {
     void *(*func)(void* arg);
     void *arg;
     void *ret;
+    DWORD id;
 } pthread_t;
 
 /* use light weight mutex/condition variable API for Windows Vista and later */
@@ -80,14 +81,27 @@ static av_unused int pthread_create(pthread_t *thread, const void *unused_attr,
     thread->arg    = arg;
 #if HAVE_WINRT
     thread->handle = (void*)CreateThread(NULL, 0, win32thread_worker, thread,
-                                           0, NULL);
+                                           0, &thread->id);
 #else
     thread->handle = (void*)_beginthreadex(NULL, 0, win32thread_worker, thread,
-                                           0, NULL);
+                                           0, (unsigned *)&thread->id);
 #endif
     return !thread->handle;
 }
 
+/* Only the id is set, which is all pthread_equal() compares. */
+static inline pthread_t pthread_self(void)
+{
+    pthread_t thread = { 0 };
+    thread.id = GetCurrentThreadId();
+    return thread;
+}
+
+static inline int pthread_equal(pthread_t t1, pthread_t t2)
+{
+    return t1.id == t2.id;
+}
+
 static av_unused int pthread_join(pthread_t thread, void **value_ptr)
 {
     DWORD ret = WaitForSingleObject(thread.handle, INFINITE);
@@ -356,6 +356,7 @@ static void ffmpeg_cleanup(int ret)
 
     for (i = 0; i < nb_filtergraphs; i++) {
         FilterGraph *fg = filtergraphs[i];
+        print_filtergraph_stats(fg);
         avfilter_graph_free(&fg->graph);
         for (j = 0; j < fg->nb_inputs; j++) {
             InputFilter *ifilter = fg->inputs[j];
@@ -426,6 +427,8 @@ static void ffmpeg_cleanup(int ret)
     }
     av_freep(&vstats_filename);
     av_freep(&filter_nbthreads);
+    av_freep(&filter_thread_type);
+    av_freep(&filter_max_queued_bytes);
 
     av_freep(&input_streams);
     av_freep(&input_files);
@@ -1773,13 +1776,14 @@ static void check_decode_result(InputStream *ist, int *got_output, int ret)
 }
 
 // Filters can be configured only if the formats of all inputs are known.
+// Subtitle inputs take their format from the decoder, and their buffer
+// sources send heartbeats until the first subtitle arrives.
 static int ifilter_has_all_input_formats(FilterGraph *fg)
 {
     int i;
     for (i = 0; i < fg->nb_inputs; i++) {
         if (fg->inputs[i]->format < 0 && (fg->inputs[i]->type == AVMEDIA_TYPE_AUDIO ||
-                                          fg->inputs[i]->type == AVMEDIA_TYPE_VIDEO ||
-                                          fg->inputs[i]->type == AVMEDIA_TYPE_SUBTITLE))
+                                          fg->inputs[i]->type == AVMEDIA_TYPE_VIDEO))
             return 0;
     }
     return 1;
@@ -2129,81 +2133,6 @@ fail:
     return err < 0 ? err : ret;
 }
 
-static void subtitle_send_kickoff(InputStream *ist, int64_t heartbeat_pts)
-{
-    AVFrame *frame;
-    int64_t pts;
-
-    frame = av_frame_alloc();
-    if (!frame) {
-        av_log(ist->dec_ctx, AV_LOG_ERROR, "Unable to alloc frame (out of memory).\n");
-        return;
-    }
-
-    frame->type = AVMEDIA_TYPE_SUBTITLE;
-    av_frame_get_buffer2(frame, 0);
-
-    frame->format = (uint16_t)ist->dec_ctx->subtitle_type;
-
-    pts = FFMAX(heartbeat_pts, ist->subtitle_kickoff.last_pts) + av_rescale_q(10, (AVRational){ 1, 1000 }, ist->st->time_base);
-
-    frame->width = ist->subtitle_kickoff.w;
-    frame->height = ist->subtitle_kickoff.h;
-    frame->subtitle_timing.start_pts = av_rescale_q(pts, ist->st->time_base, AV_TIME_BASE_Q);
-    frame->subtitle_timing.duration =  av_rescale_q(10, (AVRational){ 1, 1000 }, AV_TIME_BASE_Q);
-    frame->pts = pts;
-
-    av_log(NULL, AV_LOG_WARNING, "subtitle_kickoff: call subtitle_resend_current %"PRId64" frame->format: %d\n", pts, frame->format);
-
-    ist->subtitle_kickoff.last_pts = pts;
-
-    send_frame_to_filters(ist, frame);
-
-    av_frame_free(&frame);
-}
-
-// Opposed to the earlier "subtitle hearbeat", this is primarily aimed at
-// sending an initial subtitle frame to the filters for propagating the initial
-// timing values and to avoid that too much time is spent on a single "HW" decoder
-// which could overflow its buffer pool otherwise
-static void subtitle_kickoff(InputStream *ist, int64_t pts)
-{
-    int i;
-    int64_t pts2;
-    int64_t diff;
-
-    if (ist->st->codecpar->codec_type != AVMEDIA_TYPE_VIDEO)
-        return;
-
-    for (i = 0; i < nb_input_streams; i++) {
-        InputStream *ist2 = input_streams[i];
-        unsigned j, nb_reqs;
-
-        if (!ist2->subtitle_kickoff.is_active)
-            continue;
-        /* It's primarily the initial send that matters and which propagates
-         * the right start times to subtitle filters depending on input from decoding */
-        diff = av_rescale_q(5000, (AVRational){ 1, 1000 }, ist2->st->time_base);
-        pts2 = av_rescale_q(pts, ist->st->time_base, ist2->st->time_base);
-
-        /* do not send a kickoff frame if the subtitle is already ahead */
-        if (pts2 - diff <= ist2->subtitle_kickoff.last_pts)
-            continue;
-
-        for (j = 0, nb_reqs = 0; j < ist2->nb_filters; j++) {
-            if (ist2->filters[j]->filter == NULL) {
-                subtitle_send_kickoff(ist2, pts2);
-                return;
-            }
-            nb_reqs += av_buffersrc_get_nb_failed_requests(ist2->filters[j]->filter);
-        }
-        if (nb_reqs) {
-            av_log(NULL, AV_LOG_WARNING, "subtitle_kickoff: resend - pts: %"PRIi64"\n", pts2);
-            subtitle_send_kickoff(ist2, pts2);
-        }
-    }
-}
-
 static InputStream *get_input_stream(OutputStream *ost)
 {
     if (ost->source_index >= 0)
@@ -2285,10 +2214,7 @@ static int decode_subtitles(InputStream *ist, AVPacket *pkt, int *got_output,
         return ret;
 
     pts = av_rescale_q(decoded_frame->subtitle_timing.start_pts, AV_TIME_BASE_Q, ist->st->time_base);
-    if (ist->subtitle_kickoff.last_pts > 0 && pts <= ist->subtitle_kickoff.last_pts)
-        pts = ist->subtitle_kickoff.last_pts + 1;
-
-    ist->subtitle_kickoff.last_pts = decoded_frame->pts = pts;
+    decoded_frame->pts = pts;
 
     if (ist->nb_filters > 0) {
         AVFrame *filter_frame = av_frame_clone(decoded_frame);
@@ -2614,6 +2540,8 @@ static int init_input_stream(int ist_index, char *error, int error_len)
 
         if (!av_dict_get(ist->decoder_opts, "threads", NULL, 0))
             av_dict_set(&ist->decoder_opts, "threads", "auto", 0);
+        if (shared_threads)
+            av_dict_set(&ist->decoder_opts, "shared_threads", "1", AV_DICT_DONT_OVERWRITE);
         /* Attached pics are sparse, therefore we would not want to delay their decoding till EOF. */
         if (ist->st->disposition & AV_DISPOSITION_ATTACHED_PIC)
             av_dict_set(&ist->decoder_opts, "threads", "1", 0);
@@ -3121,6 +3049,8 @@ static int init_output_stream(OutputStream *ost, AVFrame *frame,
         }
         if (!av_dict_get(ost->encoder_opts, "threads", NULL, 0))
             av_dict_set(&ost->encoder_opts, "threads", "auto", 0);
+        if (shared_threads)
+            av_dict_set(&ost->encoder_opts, "shared_threads", "1", AV_DICT_DONT_OVERWRITE);
 
         ret = hw_device_setup_for_encode(ost);
         if (ret < 0) {
@@ -3803,8 +3733,6 @@ static int process_input(int file_index)
                av_ts2timestr(input_files[ist->file_index]->ts_offset, &AV_TIME_BASE_Q));
     }
 
-    subtitle_kickoff(ist, pkt->pts);
-
     process_input_packet(ist, pkt, 0);
 
 discard_packet:
@@ -4004,7 +3932,6 @@ static int transcode(void)
     /* at the end of stream, we must flush the decoder buffers */
     for (i = 0; i < nb_input_streams; i++) {
         ist = input_streams[i];
-        ist->subtitle_kickoff.is_active = 0;
         if (!input_files[ist->file_index]->eof_reached) {
             process_input_packet(ist, NULL, 0);
         }
@@ -389,12 +389,6 @@ typedef struct InputStream {
         AVFrame *subtitle;
     } prev_sub;
 
-    struct subtitle_kickoff {
-        int is_active;
-        int64_t last_pts;
-        int w, h;
-    } subtitle_kickoff;
-
     AVBufferRef *subtitle_header;
 
     /* decoded data from this stream goes into all those filters
@@ -675,6 +669,10 @@ extern float max_error_rate;
 
 extern char *filter_nbthreads;
 extern int filter_complex_nbthreads;
+extern char *filter_thread_type;
+extern char *filter_max_queued_bytes;
+extern int filter_stats;
+extern int shared_threads;
 extern int vstats_version;
 extern int auto_conversion_filters;
 
@@ -709,6 +707,7 @@ const AVCodec *find_codec_or_die(const char *name, enum AVMediaType type, int en
 int parse_and_set_vsync(const char *arg, int *vsync_var, int file_idx, int st_idx, int is_global);
 
 int configure_filtergraph(FilterGraph *fg);
+void print_filtergraph_stats(FilterGraph *fg);
 void check_filter_outputs(void);
 int filtergraph_is_simple(FilterGraph *fg);
 int init_simple_filtergraph(InputStream *ist, OutputStream *ost);
@@ -752,8 +752,6 @@ static int configure_input_subtitle_filter(FilterGraph *fg, InputFilter *ifilter
         ifilter->format = (uint16_t)ist->dec_ctx->subtitle_type;
     }
 
-    ist->subtitle_kickoff.is_active = 1;
-
     w = ifilter->width;
     h = ifilter->height;
 
@@ -770,24 +768,20 @@ static int configure_input_subtitle_filter(FilterGraph *fg, InputFilter *ifilter
         avpriv_ass_split_free(ass_ctx);
     }
 
-    ist->subtitle_kickoff.w = w;
-    ist->subtitle_kickoff.h = h;
-    av_log(ifilter, AV_LOG_INFO, "subtitle input filter: decoding size %dx%d\n", ist->subtitle_kickoff.w, ist->subtitle_kickoff.h);
+    av_log(ifilter, AV_LOG_INFO, "subtitle input filter: decoding size %dx%d\n", w, h);
 
     ifilter->width = w;
     ifilter->height = h;
     ist->dec_ctx->width = w;
     ist->dec_ctx->height = h;
 
-    ist->subtitle_kickoff.last_pts = INT64_MIN;
-
     snprintf(name, sizeof(name), "graph %d subtitle input from stream %d:%d", fg->index,
              ist->file_index, ist->st->index);
 
 
     av_bprint_init(&args, 0, AV_BPRINT_SIZE_AUTOMATIC);
     av_bprintf(&args,
-             "subtitle_type=%d:width=%d:height=%d:time_base=%d/%d:",
+             "subtitle_type=%d:width=%d:height=%d:time_base=%d/%d:heartbeat=1:",
              ifilter->format, ifilter->width, ifilter->height,
              ist->st->time_base.num, ist->st->time_base.den);
     if ((ret = avfilter_graph_create_filter(&ifilter->filter, buffer_filt, name,
@@ -1083,9 +1077,62 @@ static int configure_input_filter(FilterGraph *fg, InputFilter *ifilter,
     }
 }
 
+typedef struct FilterStatsEntry {
+    const AVFilterContext *filter;
+    AVFilterStats stats;
+} FilterStatsEntry;
+
+static int cmp_filter_stats(const void *a, const void *b)
+{
+    const FilterStatsEntry *sa = a, *sb = b;
+    return FFDIFFSIGN(sb->stats.wall_time, sa->stats.wall_time);
+}
+
+void print_filtergraph_stats(FilterGraph *fg)
+{
+    AVFilterGraph *graph = fg->graph;
+    AVFilterStats *stats;
+    FilterStatsEntry *entries;
+
+    if (!filter_stats || !graph || !graph->nb_filters)
+        return;
+
+    stats   = av_calloc(graph->nb_filters, sizeof(*stats));
+    entries = av_calloc(graph->nb_filters, sizeof(*entries));
+    if (!stats || !entries)
+        goto end;
+
+    avfilter_graph_get_stats(graph, stats);
+    for (unsigned i = 0; i < graph->nb_filters; i++) {
+        entries[i].filter = graph->filters[i];
+        entries[i].stats  = stats[i];
+    }
+    qsort(entries, graph->nb_filters, sizeof(*entries), cmp_filter_stats);
+
+    av_log(NULL, AV_LOG_INFO, "Filtergraph #%d statistics:\n", fg->index);
+    av_log(NULL, AV_LOG_INFO, "  %-32s %12s %10s %10s %10s %10s %10s\n",
+           "filter", "activations", "wall(ms)", "cpu(ms)",
+           "frames in", "frames out", "allocated");
+    for (unsigned i = 0; i < graph->nb_filters; i++) {
+        const FilterStatsEntry *e = &entries[i];
+
+        av_log(NULL, AV_LOG_INFO,
+               "  %-32s %12"PRIu64" %10.3f %10.3f %10"PRIu64" %10"PRIu64" %10"PRIu64"\n",
+               e->filter->name, e->stats.activations,
+               e->stats.wall_time / 1000.0, e->stats.cpu_time / 1000.0,
+               e->stats.frames_in, e->stats.frames_out,
+               e->stats.frames_allocated);
+    }
+
+end:
+    av_freep(&stats);
+    av_freep(&entries);
+}
+
 static void cleanup_filtergraph(FilterGraph *fg)
 {
     int i;
+    print_filtergraph_stats(fg);
     for (i = 0; i < fg->nb_outputs; i++)
         fg->outputs[i]->filter = (AVFilterContext *)NULL;
     for (i = 0; i < fg->nb_inputs; i++)
@@ -1129,6 +1176,27 @@ int configure_filtergraph(FilterGraph *fg)
     if (!(fg->graph = avfilter_graph_alloc()))
         return AVERROR(ENOMEM);
 
+    if (filter_thread_type) {
+        ret = av_opt_set(fg->graph, "thread_type", filter_thread_type, 0);
+        if (ret < 0)
+            goto fail;
+    }
+    if (filter_max_queued_bytes) {
+        ret = av_opt_set(fg->graph, "max_queued_bytes", filter_max_queued_bytes, 0);
+        if (ret < 0)
+            goto fail;
+    }
+    if (filter_stats) {
+        ret = av_opt_set_int(fg->graph, "profiling", 1, 0);
+        if (ret < 0)
+            goto fail;
+    }
+    if (shared_threads) {
+        ret = av_opt_set_int(fg->graph, "shared_threads", 1, 0);
+        if (ret < 0)
+            goto fail;
+    }
+
     if (simple) {
         OutputStream *ost = fg->outputs[0]->ost;
         char args[512];
@@ -53,6 +53,7 @@
 #include "libavutil/parseutils.h"
 #include "libavutil/pixdesc.h"
 #include "libavutil/pixfmt.h"
+#include "libavutil/threadpool.h"
 
 const char *const opt_name_codec_names[]                      = {"c", "codec", "acodec", "vcodec", "scodec", "dcodec", NULL};
 const char *const opt_name_frame_rates[]                      = {"r", NULL};
@@ -99,6 +100,10 @@ int stdin_interaction = 1;
 float max_error_rate  = 2.0/3;
 char *filter_nbthreads;
 int filter_complex_nbthreads = 0;
+char *filter_thread_type;
+char *filter_max_queued_bytes;
+int filter_stats = 0;
+int shared_threads = 0;
 int vstats_version = 2;
 int auto_conversion_filters = 1;
 int64_t stats_period = 500000;
@@ -275,6 +280,17 @@ static int opt_filter_threads(void *optctx, const char *opt, const char *arg)
     return 0;
 }
 
+static int opt_shared_threads(void *optctx, const char *opt, const char *arg)
+{
+    int nb_threads = parse_number_or_die(opt, arg, OPT_INT, 0, INT_MAX);
+    int ret = av_thread_pool_set_threads(nb_threads);
+
+    if (ret < 0)
+        return ret;
+    shared_threads = 1;
+    return 0;
+}
+
 static int opt_abort_on(void *optctx, const char *opt, const char *arg)
 {
     static const AVOption opts[] = {
@@ -915,7 +931,6 @@ static void add_input_streams(OptionsContext *o, AVFormatContext *ic)
                 av_log(NULL, AV_LOG_FATAL, "Invalid canvas size: %s.\n", canvas_size);
                 exit_program(1);
             }
-            ist->subtitle_kickoff.is_active = 1;
             break;
         }
         case AVMEDIA_TYPE_ATTACHMENT:
@@ -2113,6 +2128,14 @@ const OptionDef options[] = {
         "create a complex filtergraph", "graph_description" },
     { "filter_complex_threads", HAS_ARG | OPT_INT,                   { &filter_complex_nbthreads },
         "number of threads for -filter_complex" },
+    { "filter_thread_type", HAS_ARG | OPT_STRING | OPT_EXPERT,        { &filter_thread_type },
+        "set the allowed threading types of all filtergraphs", "flags" },
+    { "filter_max_queued_bytes", HAS_ARG | OPT_STRING | OPT_EXPERT,   { &filter_max_queued_bytes },
+        "soft limit for the size of the frames queued in each filtergraph", "bytes" },
+    { "filter_stats",   OPT_BOOL | OPT_EXPERT,                       { &filter_stats },
+        "print the time spent in each filter at the end of the filtergraphs" },
+    { "shared_threads", HAS_ARG | OPT_EXPERT,                        { .func_arg = opt_shared_threads },
+        "run the slice threads of all codecs and filters on a shared pool of threads", "number" },
     { "lavfi",          HAS_ARG | OPT_EXPERT,                        { .func_arg = opt_filter_complex },
         "create a complex filtergraph", "graph_description" },
     { "filter_complex_script", HAS_ARG | OPT_EXPERT,                 { .func_arg = opt_filter_complex_script },
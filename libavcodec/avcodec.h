@@ -2060,6 +2060,16 @@ typedef struct AVCodecContext {
     AVChannelLayout ch_layout;
 
     enum AVSubtitleType subtitle_type;
+
+    /**
+     * Run the slice threading jobs on the process-wide shared thread pool
+     * instead of threads of the codec, see libavutil/threadpool.h.
+     * thread_count is then the maximum number of threads working on the
+     * codec at once. Frame threads are not affected.
+     * - encoding: Set by user.
+     * - decoding: Set by user.
+     */
+    int shared_threads;
 } AVCodecContext;
 
 /**
@@ -83,6 +83,7 @@ typedef struct Mpeg1Context {
     int first_slice;
     int extradata_decoded;
     int64_t timecode_frame_start;  /*< GOP timecode frame start number, in non drop frame format */
+    int64_t timecode_frame_out;    /*< timecode to export with the frame output by this packet */
 } Mpeg1Context;
 
 #define MB_TYPE_ZERO_MV   0x20000000
@@ -1068,6 +1069,7 @@ static av_cold int mpeg_decode_init(AVCodecContext *avctx)
     s2->chroma_format              = 1;
     s->mpeg_enc_ctx_allocated      = 0;
     s->repeat_field                = 0;
+    s->timecode_frame_out          = -1;
     avctx->color_range             = AVCOL_RANGE_MPEG;
     return 0;
 }
@@ -1089,10 +1091,37 @@ static int mpeg_decode_update_thread_context(AVCodecContext *avctx,
     if (err)
         return err;
 
-    if (!ctx->mpeg_enc_ctx_allocated)
-        memcpy(s + 1, s1 + 1, sizeof(Mpeg1Context) - sizeof(MpegEncContext));
-
-    return 0;
+    /* sequence level state not handled by ff_mpeg_update_thread_context() */
+    s->codec_id = avctx->codec_id = s1->codec_id;
+    s->bit_rate = s1->bit_rate;
+    memcpy(s->intra_matrix,        s1->intra_matrix,        sizeof(s->intra_matrix));
+    memcpy(s->chroma_intra_matrix, s1->chroma_intra_matrix, sizeof(s->chroma_intra_matrix));
+    memcpy(s->inter_matrix,        s1->inter_matrix,        sizeof(s->inter_matrix));
+    memcpy(s->chroma_inter_matrix, s1->chroma_inter_matrix, sizeof(s->chroma_inter_matrix));
+
+    /* slice_count, first_slice and timecode_frame_out belong to the packet
+     * being decoded by the other thread and are not copied */
+    ctx->mpeg_enc_ctx_allocated = ctx_from->mpeg_enc_ctx_allocated;
+    ctx->pan_scan               = ctx_from->pan_scan;
+    ctx->stereo3d               = ctx_from->stereo3d;
+    ctx->has_stereo3d           = ctx_from->has_stereo3d;
+    ctx->afd                    = ctx_from->afd;
+    ctx->has_afd                = ctx_from->has_afd;
+    ctx->aspect_ratio_info      = ctx_from->aspect_ratio_info;
+    ctx->save_aspect            = ctx_from->save_aspect;
+    ctx->save_width             = ctx_from->save_width;
+    ctx->save_height            = ctx_from->save_height;
+    ctx->save_progressive_seq   = ctx_from->save_progressive_seq;
+    ctx->rc_buffer_size         = ctx_from->rc_buffer_size;
+    ctx->frame_rate_ext         = ctx_from->frame_rate_ext;
+    ctx->frame_rate_index       = ctx_from->frame_rate_index;
+    ctx->sync                   = ctx_from->sync;
+    ctx->closed_gop             = ctx_from->closed_gop;
+    ctx->tmpgexs                = ctx_from->tmpgexs;
+    ctx->extradata_decoded      = ctx_from->extradata_decoded;
+    ctx->timecode_frame_start   = ctx_from->timecode_frame_start;
+
+    return av_buffer_replace(&ctx->a53_buf_ref, ctx_from->a53_buf_ref);
 }
 #endif
 
@@ -1641,9 +1670,6 @@ static int mpeg_field_start(MpegEncContext *s, const uint8_t *buf, int buf_size)
             *sd->data   = s1->afd;
             s1->has_afd = 0;
         }
-
-        if (HAVE_THREADS && (avctx->active_thread_type & FF_THREAD_FRAME))
-            ff_thread_finish_setup(avctx);
     } else { // second field
         int i;
 
@@ -1668,6 +1694,21 @@ static int mpeg_field_start(MpegEncContext *s, const uint8_t *buf, int buf_size)
         }
     }
 
+    /* Like h264, the first field of a field pair is decoded before
+     * finishing the setup, so that the next thread starts from the state
+     * after the complete frame. */
+    if (!s->first_field) {
+        /* the GOP timecode goes with the picture this packet outputs */
+        if (s->pict_type == AV_PICTURE_TYPE_B || s->low_delay ||
+            s->last_picture_ptr) {
+            s1->timecode_frame_out   = s1->timecode_frame_start;
+            s1->timecode_frame_start = -1;
+        }
+
+        if (HAVE_THREADS && (avctx->active_thread_type & FF_THREAD_FRAME))
+            ff_thread_finish_setup(avctx);
+    }
+
     if (avctx->hwaccel) {
         if ((ret = avctx->hwaccel->start_frame(avctx, buf, buf_size)) < 0)
             return ret;
@@ -1833,7 +1874,9 @@ static int mpeg_decode_slice(MpegEncContext *s, int mb_y,
             int left;
 
             ff_mpeg_draw_horiz_band(s, mb_size * (s->mb_y >> field_pic), mb_size);
-            ff_mpv_report_decode_progress(s);
+            /* field pictures only report progress when the frame is done */
+            if (!field_pic)
+                ff_mpv_report_decode_progress(s);
 
             s->mb_x  = 0;
             s->mb_y += 1 << field_pic;
@@ -2669,7 +2712,9 @@ static int decode_chunks(AVCodecContext *avctx, AVFrame *picture,
                         }
                     }
                 }
-                if (s2->pict_type == AV_PICTURE_TYPE_I || (s2->avctx->flags2 & AV_CODEC_FLAG2_SHOW_ALL))
+                /* only written before the frame setup is finished */
+                if (!s->sync && (s2->pict_type == AV_PICTURE_TYPE_I ||
+                                 (s2->avctx->flags2 & AV_CODEC_FLAG2_SHOW_ALL)))
                     s->sync = 1;
                 if (!s2->next_picture_ptr) {
                     /* Skip P-frames if we do not have a reference frame or
@@ -2824,21 +2869,20 @@ static int mpeg_decode_frame(AVCodecContext *avctx, AVFrame *picture,
     if (ret<0 || *got_output) {
         s2->current_picture_ptr = NULL;
 
-        if (s->timecode_frame_start != -1 && *got_output) {
+        if (s->timecode_frame_out != -1 && *got_output) {
             char tcbuf[AV_TIMECODE_STR_SIZE];
             AVFrameSideData *tcside = av_frame_new_side_data(picture,
                                                              AV_FRAME_DATA_GOP_TIMECODE,
                                                              sizeof(int64_t));
             if (!tcside)
                 return AVERROR(ENOMEM);
-            memcpy(tcside->data, &s->timecode_frame_start, sizeof(int64_t));
+            memcpy(tcside->data, &s->timecode_frame_out, sizeof(int64_t));
 
-            av_timecode_make_mpeg_tc_string(tcbuf, s->timecode_frame_start);
+            av_timecode_make_mpeg_tc_string(tcbuf, s->timecode_frame_out);
             av_dict_set(&picture->metadata, "timecode", tcbuf, 0);
-
-            s->timecode_frame_start = -1;
         }
     }
+    s->timecode_frame_out = -1;
 
     return ret;
 }
@@ -2876,8 +2920,10 @@ const FFCodec ff_mpeg1video_decoder = {
 #if FF_API_FLAG_TRUNCATED
                              AV_CODEC_CAP_TRUNCATED |
 #endif
-                             AV_CODEC_CAP_DELAY | AV_CODEC_CAP_SLICE_THREADS,
-    .caps_internal         = FF_CODEC_CAP_SKIP_FRAME_FILL_PARAM,
+                             AV_CODEC_CAP_DELAY | AV_CODEC_CAP_SLICE_THREADS |
+                             AV_CODEC_CAP_FRAME_THREADS,
+    .caps_internal         = FF_CODEC_CAP_SKIP_FRAME_FILL_PARAM |
+                             FF_CODEC_CAP_ALLOCATE_PROGRESS,
     .flush                 = flush,
     .p.max_lowres          = 3,
     UPDATE_THREAD_CONTEXT(mpeg_decode_update_thread_context),
@@ -2908,11 +2954,14 @@ const FFCodec ff_mpeg2video_decoder = {
 #if FF_API_FLAG_TRUNCATED
                       AV_CODEC_CAP_TRUNCATED |
 #endif
-                      AV_CODEC_CAP_DELAY | AV_CODEC_CAP_SLICE_THREADS,
-    .caps_internal  = FF_CODEC_CAP_SKIP_FRAME_FILL_PARAM,
+                      AV_CODEC_CAP_DELAY | AV_CODEC_CAP_SLICE_THREADS |
+                      AV_CODEC_CAP_FRAME_THREADS,
+    .caps_internal  = FF_CODEC_CAP_SKIP_FRAME_FILL_PARAM |
+                      FF_CODEC_CAP_ALLOCATE_PROGRESS,
     .flush          = flush,
     .p.max_lowres   = 3,
     .p.profiles     = NULL_IF_CONFIG_SMALL(ff_mpeg2_video_profiles),
+    UPDATE_THREAD_CONTEXT(mpeg_decode_update_thread_context),
     .hw_configs     = (const AVCodecHWConfigInternal *const []) {
 #if CONFIG_MPEG2_DXVA2_HWACCEL
                         HWACCEL_DXVA2(mpeg2),
@@ -2953,10 +3002,13 @@ const FFCodec ff_mpegvideo_decoder = {
 #if FF_API_FLAG_TRUNCATED
                       AV_CODEC_CAP_TRUNCATED |
 #endif
-                      AV_CODEC_CAP_DELAY | AV_CODEC_CAP_SLICE_THREADS,
-    .caps_internal  = FF_CODEC_CAP_SKIP_FRAME_FILL_PARAM,
+                      AV_CODEC_CAP_DELAY | AV_CODEC_CAP_SLICE_THREADS |
+                      AV_CODEC_CAP_FRAME_THREADS,
+    .caps_internal  = FF_CODEC_CAP_SKIP_FRAME_FILL_PARAM |
+                      FF_CODEC_CAP_ALLOCATE_PROGRESS,
     .flush          = flush,
     .p.max_lowres   = 3,
+    UPDATE_THREAD_CONTEXT(mpeg_decode_update_thread_context),
 };
 
 typedef struct IPUContext {
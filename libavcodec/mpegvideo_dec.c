@@ -960,7 +960,7 @@ static inline void MPV_motion_lowres(MpegEncContext *s,
 static int lowest_referenced_row(MpegEncContext *s, int dir)
 {
     int my_max = INT_MIN, my_min = INT_MAX, qpel_shift = !s->quarter_sample;
-    int off, mvs;
+    int off, mvs, field = 0;
 
     if (s->picture_structure != PICT_FRAME || s->mcsel)
         goto unhandled;
@@ -975,6 +975,15 @@ static int lowest_referenced_row(MpegEncContext *s, int dir)
         case MV_TYPE_8X8:
             mvs = 4;
             break;
+        /* field vectors are in units of field lines */
+        case MV_TYPE_FIELD:
+            mvs   = 2;
+            field = 1;
+            break;
+        case MV_TYPE_DMV:
+            mvs   = 4;
+            field = 1;
+            break;
         default:
             goto unhandled;
     }
@@ -985,7 +994,9 @@ static int lowest_referenced_row(MpegEncContext *s, int dir)
         my_min = FFMIN(my_min, my);
     }
 
-    off = ((FFMAX(-my_min, my_max) << qpel_shift) + 63) >> 6;
+    /* one more row for the bottom field and its interpolation */
+    off = ((FFMAX(-my_min, my_max) << qpel_shift << field) + 63) >> 6;
+    off += field;
 
     return av_clip(s->mb_y + off, 0, s->mb_height - 1);
 unhandled:
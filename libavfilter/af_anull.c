@@ -31,6 +31,7 @@ static const AVFilterPad avfilter_af_anull_inputs[] = {
     {
         .name = "default",
         .type = AVMEDIA_TYPE_AUDIO,
+        .get_buffer.audio = ff_null_get_audio_buffer,
     },
 };
 
@@ -47,11 +47,12 @@ FF_DISABLE_DEPRECATION_WARNINGS
 FF_ENABLE_DEPRECATION_WARNINGS
 #endif
 
+    ff_link_pool_lock(link);
     if (!link->frame_pool) {
         link->frame_pool = ff_frame_pool_audio_init(av_buffer_allocz, channels,
                                                     nb_samples, link->format, align);
         if (!link->frame_pool)
-            return NULL;
+            goto fail;
     } else {
         int pool_channels = 0;
         int pool_nb_samples = 0;
@@ -61,7 +62,7 @@ FF_ENABLE_DEPRECATION_WARNINGS
         if (ff_frame_pool_get_audio_config(link->frame_pool,
                                            &pool_channels, &pool_nb_samples,
                                            &pool_format, &pool_align) < 0) {
-            return NULL;
+            goto fail;
         }
 
         if (pool_channels != channels || pool_nb_samples < nb_samples ||
@@ -71,11 +72,15 @@ FF_ENABLE_DEPRECATION_WARNINGS
             link->frame_pool = ff_frame_pool_audio_init(av_buffer_allocz, channels,
                                                         nb_samples, link->format, align);
             if (!link->frame_pool)
-                return NULL;
+                goto fail;
         }
     }
 
     frame = ff_frame_pool_get(link->frame_pool);
+    if (frame)
+        link->frame_count_alloc++;
+fail:
+    ff_link_pool_unlock(link);
     if (!frame)
         return NULL;
 
@@ -19,6 +19,10 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include <time.h>
+
+#include "config.h"
+
 #include "libavutil/avassert.h"
 #include "libavutil/avstring.h"
 #include "libavutil/bprint.h"
@@ -33,6 +37,7 @@
 #include "libavutil/pixdesc.h"
 #include "libavutil/rational.h"
 #include "libavutil/samplefmt.h"
+#include "libavutil/time.h"
 
 #define FF_INTERNAL_FIELDS 1
 #include "framequeue.h"
@@ -44,6 +49,7 @@
 #include "framepool.h"
 #include "internal.h"
 #include "subtitles.h"
+#include "thread.h"
 
 static void tlog_ref(void *ctx, AVFrame *ref, int end)
 {
@@ -199,9 +205,165 @@ void avfilter_link_free(AVFilterLink **link)
     av_freep(link);
 }
 
+/**
+ * With pipeline threading, filter callbacks run without the graph lock so
+ * that other filters can be activated meanwhile. The functions they use to
+ * access links and scheduling state take it back for the duration of the
+ * call, see filter_lock(). Whether the lock is held is tracked per thread,
+ * as these functions may be used on the links of any filter.
+ */
+static int callback_unlock(AVFilterContext *filter)
+{
+    AVFilterGraph *graph = filter->graph;
+
+    if (!graph || !graph->internal->pipeline)
+        return 0;
+    *ff_graph_pipeline_unlocked(graph) = 1;
+    ff_mutex_unlock(&graph->internal->lock);
+    return 1;
+}
+
+static void callback_relock(AVFilterContext *filter, int unlocked)
+{
+    if (!unlocked)
+        return;
+    ff_mutex_lock(&filter->graph->internal->lock);
+    *ff_graph_pipeline_unlocked(filter->graph) = 0;
+}
+
+static int filter_lock(AVFilterContext *filter)
+{
+    AVFilterGraph *graph = filter->graph;
+    uint8_t *unlocked;
+
+    if (!graph || !graph->internal->pipeline)
+        return 0;
+    unlocked = ff_graph_pipeline_unlocked(graph);
+    if (!*unlocked)
+        return 0;
+    ff_mutex_lock(&graph->internal->lock);
+    *unlocked = 0;
+    return 1;
+}
+
+static void filter_unlock(AVFilterContext *filter, int locked)
+{
+    if (!locked)
+        return;
+    *ff_graph_pipeline_unlocked(filter->graph) = 1;
+    ff_mutex_unlock(&filter->graph->internal->lock);
+}
+
+static void filter_set_ready(AVFilterContext *filter, unsigned priority)
+{
+    if (priority <= filter->ready)
+        return;
+    if (!filter->ready && filter->graph && filter->graph->internal->pipeline)
+        ff_graph_pipeline_wake(filter->graph);
+    filter->ready = priority;
+}
+
+/**
+ * While the graph exceeds its max_queued_bytes, a filter which already has
+ * frames queued on one of its outputs must not pull more input: its
+ * requests are held back until enough queued frames are consumed.
+ */
+static int request_must_wait(AVFilterLink *link)
+{
+    AVFilterGraph *graph = link->dst->graph;
+    AVFilterContext *dst = link->dst;
+
+    if (!graph || !graph->max_queued_bytes ||
+        graph->internal->frame_queues.queued_bytes <= graph->max_queued_bytes)
+        return 0;
+    for (unsigned i = 0; i < dst->nb_outputs; i++)
+        if (ff_framequeue_queued_frames(&dst->outputs[i]->fifo))
+            return 1;
+    return 0;
+}
+
+static void defer_request(AVFilterLink *link)
+{
+    if (link->frame_wanted_deferred)
+        return;
+    link->frame_wanted_deferred = 1;
+    link->dst->graph->internal->nb_deferred_requests++;
+}
+
+static void clear_deferred_request(AVFilterLink *link)
+{
+    if (!link->frame_wanted_deferred)
+        return;
+    link->frame_wanted_deferred = 0;
+    link->dst->graph->internal->nb_deferred_requests--;
+}
+
+static void issue_deferred_requests(AVFilterGraph *graph)
+{
+    for (unsigned i = 0; i < graph->nb_filters; i++) {
+        AVFilterContext *filter = graph->filters[i];
+
+        for (unsigned j = 0; j < filter->nb_inputs; j++) {
+            AVFilterLink *link = filter->inputs[j];
+
+            if (!link->frame_wanted_deferred)
+                continue;
+            clear_deferred_request(link);
+            if (link->status_in || link->status_out)
+                continue;
+            link->frame_wanted_out = 1;
+            filter_set_ready(link->src, 100);
+        }
+    }
+}
+
+/**
+ * Issue the held back requests once the queued frames fit in the limit.
+ */
+static void update_deferred_requests(AVFilterLink *link)
+{
+    AVFilterGraph *graph = link->dst->graph;
+
+    if (graph && graph->internal->nb_deferred_requests &&
+        graph->internal->frame_queues.queued_bytes <= graph->max_queued_bytes)
+        issue_deferred_requests(graph);
+}
+
+int ff_filter_graph_force_deferred_requests(AVFilterGraph *graph)
+{
+    AVFilterGraphInternal *gi = graph->internal;
+
+    if (!gi->nb_deferred_requests)
+        return 0;
+
+    /* If a buffer source waits for a frame, the application can still
+       make progress by feeding it. */
+    for (unsigned i = 0; i < graph->nb_filters; i++) {
+        AVFilterContext *filter = graph->filters[i];
+
+        if (filter->nb_inputs)
+            continue;
+        for (unsigned j = 0; j < filter->nb_outputs; j++)
+            if (filter->outputs[j]->frame_wanted_out)
+                return 0;
+    }
+
+    if (!gi->queued_bytes_warned) {
+        av_log(graph, AV_LOG_WARNING, "%"PRIu64" bytes of frames are queued in "
+               "the graph, more than max_queued_bytes, and the graph cannot "
+               "make progress without queuing more.\n",
+               gi->frame_queues.queued_bytes);
+        gi->queued_bytes_warned = 1;
+    }
+    issue_deferred_requests(graph);
+    return 1;
+}
+
 void ff_filter_set_ready(AVFilterContext *filter, unsigned priority)
 {
-    filter->ready = FFMAX(filter->ready, priority);
+    int locked = filter_lock(filter);
+    filter_set_ready(filter, priority);
+    filter_unlock(filter, locked);
 }
 
 /**
@@ -219,26 +381,34 @@ static void filter_unblock(AVFilterContext *filter)
 
 void ff_avfilter_link_set_in_status(AVFilterLink *link, int status, int64_t pts)
 {
-    if (link->status_in == status)
-        return;
-    av_assert0(!link->status_in);
-    link->status_in = status;
-    link->status_in_pts = pts;
-    link->frame_wanted_out = 0;
-    link->frame_blocked_in = 0;
-    filter_unblock(link->dst);
-    ff_filter_set_ready(link->dst, 200);
+    int locked = filter_lock(link->src);
+
+    if (link->status_in != status) {
+        av_assert0(!link->status_in);
+        link->status_in = status;
+        link->status_in_pts = pts;
+        link->frame_wanted_out = 0;
+        link->frame_blocked_in = 0;
+        clear_deferred_request(link);
+        filter_unblock(link->dst);
+        filter_set_ready(link->dst, 200);
+    }
+    filter_unlock(link->src, locked);
 }
 
 void ff_avfilter_link_set_out_status(AVFilterLink *link, int status, int64_t pts)
 {
+    int locked = filter_lock(link->dst);
+
     av_assert0(!link->frame_wanted_out);
     av_assert0(!link->status_out);
     link->status_out = status;
+    clear_deferred_request(link);
     if (pts != AV_NOPTS_VALUE)
         ff_update_link_current_pts(link, pts);
     filter_unblock(link->dst);
-    ff_filter_set_ready(link->src, 200);
+    filter_set_ready(link->src, 200);
+    filter_unlock(link->dst, locked);
 }
 
 int avfilter_insert_filter(AVFilterLink *link, AVFilterContext *filt,
@@ -418,7 +588,7 @@ void ff_tlog_link(void *ctx, AVFilterLink *link, int end)
 }
 #endif
 
-int ff_request_frame(AVFilterLink *link)
+static int request_frame(AVFilterLink *link)
 {
     FF_TPRINTF_START(NULL, request_frame); ff_tlog_link(NULL, link, 1);
 
@@ -438,11 +608,23 @@ int ff_request_frame(AVFilterLink *link)
             return link->status_out;
         }
     }
+    if (request_must_wait(link)) {
+        defer_request(link);
+        return 0;
+    }
     link->frame_wanted_out = 1;
-    ff_filter_set_ready(link->src, 100);
+    filter_set_ready(link->src, 100);
     return 0;
 }
 
+int ff_request_frame(AVFilterLink *link)
+{
+    int locked = filter_lock(link->dst);
+    int ret = request_frame(link);
+    filter_unlock(link->dst, locked);
+    return ret;
+}
+
 static int64_t guess_status_pts(AVFilterContext *ctx, int status, AVRational link_time_base)
 {
     unsigned i;
@@ -468,9 +650,11 @@ static int ff_request_frame_to_filter(AVFilterLink *link, int input_index)
     FF_TPRINTF_START(NULL, request_frame_to_filter); ff_tlog_link(NULL, link, 1);
     /* Assume the filter is blocked, let the method clear it if not */
     link->frame_blocked_in = 1;
-    if (link->srcpad->request_frame)
+    if (link->srcpad->request_frame) {
+        int unlocked = callback_unlock(link->src);
         ret = link->srcpad->request_frame(link);
-    else if (link->src->inputs[input_index])
+        callback_relock(link->src, unlocked);
+    } else if (link->src->inputs[input_index])
         ret = ff_request_frame(link->src->inputs[input_index]);
     if (ret < 0) {
         if (ret != AVERROR(EAGAIN) && ret != link->status_in)
@@ -991,13 +1175,15 @@ static int ff_filter_frame_framed(AVFilterLink *link, AVFrame *frame)
     int (*filter_frame)(AVFilterLink *, AVFrame *);
     AVFilterContext *dstctx = link->dst;
     AVFilterPad *dst = link->dstpad;
-    int ret;
+    int ret, unlocked;
 
     if (!(filter_frame = dst->filter_frame))
         filter_frame = default_filter_frame;
 
     if (dst->flags & AVFILTERPAD_FLAG_NEEDS_WRITABLE) {
+        unlocked = callback_unlock(dstctx);
         ret = ff_inlink_make_frame_writable(link, &frame);
+        callback_relock(dstctx, unlocked);
         if (ret < 0)
             goto fail;
     }
@@ -1008,7 +1194,9 @@ static int ff_filter_frame_framed(AVFilterLink *link, AVFrame *frame)
     if (dstctx->is_disabled &&
         (dstctx->filter->flags & AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC))
         filter_frame = default_filter_frame;
+    unlocked = callback_unlock(dstctx);
     ret = filter_frame(link, frame);
+    callback_relock(dstctx, unlocked);
     link->frame_count_out++;
     return ret;
 
@@ -1017,7 +1205,7 @@ fail:
     return ret;
 }
 
-int ff_filter_frame(AVFilterLink *link, AVFrame *frame)
+static int filter_frame(AVFilterLink *link, AVFrame *frame)
 {
     int ret;
     FF_TPRINTF_START(NULL, filter_frame); ff_tlog_link(NULL, link, 1); ff_tlog(NULL, " "); tlog_ref(NULL, frame, 1);
@@ -1053,6 +1241,7 @@ int ff_filter_frame(AVFilterLink *link, AVFrame *frame)
     }
 
     link->frame_blocked_in = link->frame_wanted_out = 0;
+    clear_deferred_request(link);
     link->frame_count_in++;
     link->sample_count_in += frame->nb_samples;
     filter_unblock(link->dst);
@@ -1061,7 +1250,7 @@ int ff_filter_frame(AVFilterLink *link, AVFrame *frame)
         av_frame_free(&frame);
         return ret;
     }
-    ff_filter_set_ready(link->dst, 300);
+    filter_set_ready(link->dst, 300);
     return 0;
 
 error:
@@ -1069,6 +1258,14 @@ error:
     return AVERROR_PATCHWELCOME;
 }
 
+int ff_filter_frame(AVFilterLink *link, AVFrame *frame)
+{
+    int locked = filter_lock(link->src);
+    int ret = filter_frame(link, frame);
+    filter_unlock(link->src, locked);
+    return ret;
+}
+
 static int samples_ready(AVFilterLink *link, unsigned min)
 {
     return ff_framequeue_queued_frames(&link->fifo) &&
@@ -1162,7 +1359,7 @@ static int ff_filter_frame_to_filter(AVFilterLink *link)
     } else {
         /* Run once again, to see if several frames were available, or if
            the input status has also changed, or any other reason. */
-        ff_filter_set_ready(dst, 300);
+        filter_set_ready(dst, 300);
     }
     return ret;
 }
@@ -1203,7 +1400,7 @@ static int forward_status_change(AVFilterContext *filter, AVFilterLink *in)
             out = 0;
         }
     }
-    ff_filter_set_ready(filter, 200);
+    filter_set_ready(filter, 200);
     return 0;
 }
 
@@ -1361,24 +1558,64 @@ static int ff_filter_activate_default(AVFilterContext *filter)
      Rationale: checking frame_blocked_in is necessary to avoid requesting
      repeatedly on a blocked input if another is not blocked (example:
      [buffersrc1][testsrc1][buffersrc2][testsrc2]concat=v=2).
+
+   Pipeline threading:
+
+   With AVFILTER_THREAD_PIPELINE, worker threads repeatedly activate the
+   ready filter with the highest priority that is not already being
+   activated, so a filter is never activated twice at the same time but
+   different filters, including neighbours, are. The framework code above
+   runs with the graph lock held; the activate(), filter_frame() and
+   request_frame() callbacks run without it, and the ff_inlink_*(),
+   ff_outlink_*(), ff_filter_frame(), ff_request_frame() and
+   ff_filter_set_ready() functions they call take it back for the duration
+   of the call. The filters the application uses through buffersrc and
+   buffersink are not activated by the workers while it does.
  */
 
+static int64_t thread_cpu_time(void)
+{
+#if HAVE_CLOCK_GETTIME && defined(CLOCK_THREAD_CPUTIME_ID)
+    struct timespec ts;
+
+    if (!clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts))
+        return ts.tv_sec * INT64_C(1000000) + ts.tv_nsec / 1000;
+#endif
+    return 0;
+}
+
 int ff_filter_activate(AVFilterContext *filter)
 {
+    int profiling = filter->graph && filter->graph->profiling;
+    int64_t wall_time = 0, cpu_time = 0;
     int ret;
 
     /* Generic timeline support is not yet implemented but should be easy */
     av_assert1(!(filter->filter->flags & AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC &&
                  filter->filter->activate));
+    if (profiling) {
+        wall_time = av_gettime_relative();
+        cpu_time  = thread_cpu_time();
+    }
     filter->ready = 0;
-    ret = filter->filter->activate ? filter->filter->activate(filter) :
-          ff_filter_activate_default(filter);
+    if (filter->filter->activate) {
+        int unlocked = callback_unlock(filter);
+        ret = filter->filter->activate(filter);
+        callback_relock(filter, unlocked);
+    } else {
+        ret = ff_filter_activate_default(filter);
+    }
+    filter->internal->activations++;
+    if (profiling) {
+        filter->internal->wall_time += av_gettime_relative() - wall_time;
+        filter->internal->cpu_time  += thread_cpu_time() - cpu_time;
+    }
     if (ret == FFERROR_NOT_READY)
         ret = 0;
     return ret;
 }
 
-int ff_inlink_acknowledge_status(AVFilterLink *link, int *rstatus, int64_t *rpts)
+static int inlink_acknowledge_status(AVFilterLink *link, int *rstatus, int64_t *rpts)
 {
     *rpts = link->current_pts;
     if (ff_framequeue_queued_frames(&link->fifo))
@@ -1393,28 +1630,53 @@ int ff_inlink_acknowledge_status(AVFilterLink *link, int *rstatus, int64_t *rpts
     return 1;
 }
 
+int ff_inlink_acknowledge_status(AVFilterLink *link, int *rstatus, int64_t *rpts)
+{
+    int locked = filter_lock(link->dst);
+    int ret = inlink_acknowledge_status(link, rstatus, rpts);
+    filter_unlock(link->dst, locked);
+    return ret;
+}
+
 size_t ff_inlink_queued_frames(AVFilterLink *link)
 {
-    return ff_framequeue_queued_frames(&link->fifo);
+    int locked = filter_lock(link->dst);
+    size_t ret = ff_framequeue_queued_frames(&link->fifo);
+    filter_unlock(link->dst, locked);
+    return ret;
 }
 
 int ff_inlink_check_available_frame(AVFilterLink *link)
 {
-    return ff_framequeue_queued_frames(&link->fifo) > 0;
+    int locked = filter_lock(link->dst);
+    int ret = ff_framequeue_queued_frames(&link->fifo) > 0;
+    filter_unlock(link->dst, locked);
+    return ret;
 }
 
 int ff_inlink_queued_samples(AVFilterLink *link)
 {
-    return ff_framequeue_queued_samples(&link->fifo);
+    int locked = filter_lock(link->dst);
+    int ret = ff_framequeue_queued_samples(&link->fifo);
+    filter_unlock(link->dst, locked);
+    return ret;
 }
 
-int ff_inlink_check_available_samples(AVFilterLink *link, unsigned min)
+static int inlink_check_available_samples(AVFilterLink *link, unsigned min)
 {
     uint64_t samples = ff_framequeue_queued_samples(&link->fifo);
     av_assert1(min);
     return samples >= min || (link->status_in && samples);
 }
 
+int ff_inlink_check_available_samples(AVFilterLink *link, unsigned min)
+{
+    int locked = filter_lock(link->dst);
+    int ret = inlink_check_available_samples(link, min);
+    filter_unlock(link->dst, locked);
+    return ret;
+}
+
 static void consume_update(AVFilterLink *link, const AVFrame *frame)
 {
     ff_update_link_current_pts(link, frame->pts);
@@ -1424,7 +1686,7 @@ static void consume_update(AVFilterLink *link, const AVFrame *frame)
     link->sample_count_out += frame->nb_samples;
 }
 
-int ff_inlink_consume_frame(AVFilterLink *link, AVFrame **rframe)
+static int inlink_consume_frame(AVFilterLink *link, AVFrame **rframe)
 {
     AVFrame *frame;
 
@@ -1439,12 +1701,21 @@ int ff_inlink_consume_frame(AVFilterLink *link, AVFrame **rframe)
 
     frame = ff_framequeue_take(&link->fifo);
     consume_update(link, frame);
+    update_deferred_requests(link);
     *rframe = frame;
     return 1;
 }
 
-int ff_inlink_consume_samples(AVFilterLink *link, unsigned min, unsigned max,
-                            AVFrame **rframe)
+int ff_inlink_consume_frame(AVFilterLink *link, AVFrame **rframe)
+{
+    int locked = filter_lock(link->dst);
+    int ret = inlink_consume_frame(link, rframe);
+    filter_unlock(link->dst, locked);
+    return ret;
+}
+
+static int inlink_consume_samples(AVFilterLink *link, unsigned min, unsigned max,
+                                  AVFrame **rframe)
 {
     AVFrame *frame;
     int ret;
@@ -1459,13 +1730,26 @@ int ff_inlink_consume_samples(AVFilterLink *link, unsigned min, unsigned max,
     if (ret < 0)
         return ret;
     consume_update(link, frame);
+    update_deferred_requests(link);
     *rframe = frame;
     return 1;
 }
 
+int ff_inlink_consume_samples(AVFilterLink *link, unsigned min, unsigned max,
+                            AVFrame **rframe)
+{
+    int locked = filter_lock(link->dst);
+    int ret = inlink_consume_samples(link, min, max, rframe);
+    filter_unlock(link->dst, locked);
+    return ret;
+}
+
 AVFrame *ff_inlink_peek_frame(AVFilterLink *link, size_t idx)
 {
-    return ff_framequeue_peek(&link->fifo, idx);
+    int locked = filter_lock(link->dst);
+    AVFrame *ret = ff_framequeue_peek(&link->fifo, idx);
+    filter_unlock(link->dst, locked);
+    return ret;
 }
 
 int ff_inlink_make_frame_writable(AVFilterLink *link, AVFrame **rframe)
@@ -1511,7 +1795,7 @@ int ff_inlink_make_frame_writable(AVFilterLink *link, AVFrame **rframe)
     return 0;
 }
 
-int ff_inlink_process_commands(AVFilterLink *link, const AVFrame *frame)
+static int inlink_process_commands(AVFilterLink *link, const AVFrame *frame)
 {
     AVFilterCommand *cmd = link->dst->command_queue;
 
@@ -1526,6 +1810,14 @@ int ff_inlink_process_commands(AVFilterLink *link, const AVFrame *frame)
     return 0;
 }
 
+int ff_inlink_process_commands(AVFilterLink *link, const AVFrame *frame)
+{
+    int locked = filter_lock(link->dst);
+    int ret = inlink_process_commands(link, frame);
+    filter_unlock(link->dst, locked);
+    return ret;
+}
+
 int ff_inlink_evaluate_timeline_at_frame(AVFilterLink *link, const AVFrame *frame)
 {
     AVFilterContext *dstctx = link->dst;
@@ -1544,15 +1836,26 @@ int ff_inlink_evaluate_timeline_at_frame(AVFilterLink *link, const AVFrame *fram
     return fabs(av_expr_eval(dstctx->enable, dstctx->var_values, NULL)) >= 0.5;
 }
 
-void ff_inlink_request_frame(AVFilterLink *link)
+static void inlink_request_frame(AVFilterLink *link)
 {
     av_assert1(!link->status_in);
     av_assert1(!link->status_out);
+    if (request_must_wait(link)) {
+        defer_request(link);
+        return;
+    }
     link->frame_wanted_out = 1;
-    ff_filter_set_ready(link->src, 100);
+    filter_set_ready(link->src, 100);
 }
 
-void ff_inlink_set_status(AVFilterLink *link, int status)
+void ff_inlink_request_frame(AVFilterLink *link)
+{
+    int locked = filter_lock(link->dst);
+    inlink_request_frame(link);
+    filter_unlock(link->dst, locked);
+}
+
+static void inlink_set_status(AVFilterLink *link, int status)
 {
     if (link->status_out)
         return;
@@ -1563,13 +1866,32 @@ void ff_inlink_set_status(AVFilterLink *link, int status)
            AVFrame *frame = ff_framequeue_take(&link->fifo);
            av_frame_free(&frame);
     }
+    update_deferred_requests(link);
     if (!link->status_in)
         link->status_in = status;
 }
 
+void ff_inlink_set_status(AVFilterLink *link, int status)
+{
+    int locked = filter_lock(link->dst);
+    inlink_set_status(link, status);
+    filter_unlock(link->dst, locked);
+}
+
 int ff_outlink_get_status(AVFilterLink *link)
 {
-    return link->status_in;
+    int locked = filter_lock(link->src);
+    int ret = link->status_in;
+    filter_unlock(link->src, locked);
+    return ret;
+}
+
+int ff_outlink_frame_wanted(AVFilterLink *link)
+{
+    int locked = filter_lock(link->src);
+    int ret = link->frame_wanted_out;
+    filter_unlock(link->src, locked);
+    return ret;
 }
 
 int ff_inoutlink_check_flow(AVFilterLink *inlink, AVFilterLink *outlink)
@@ -1605,3 +1927,82 @@ int ff_filter_init_hw_frames(AVFilterContext *avctx, AVFilterLink *link,
 
     return 0;
 }
+
+static void get_buffer_stats(AVFilterGraph *graph, AVFilterLink *link,
+                             AVFilterBufferStats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    if (link) {
+        stats->queued_frames     = ff_framequeue_queued_frames(&link->fifo);
+        stats->queued_bytes      = ff_framequeue_queued_bytes(&link->fifo);
+        stats->peak_queued_bytes = link->fifo.peak_queued_bytes;
+        stats->deferred_requests = link->frame_wanted_deferred;
+        return;
+    }
+    for (unsigned i = 0; i < graph->nb_filters; i++) {
+        AVFilterContext *filter = graph->filters[i];
+
+        for (unsigned j = 0; j < filter->nb_inputs; j++)
+            stats->queued_frames += ff_framequeue_queued_frames(&filter->inputs[j]->fifo);
+    }
+    stats->queued_bytes      = graph->internal->frame_queues.queued_bytes;
+    stats->peak_queued_bytes = graph->internal->frame_queues.peak_queued_bytes;
+    stats->deferred_requests = graph->internal->nb_deferred_requests;
+}
+
+void ff_filter_get_buffer_stats(AVFilterContext *filter, AVFilterLink *link,
+                                AVFilterBufferStats *stats)
+{
+    int locked = filter_lock(filter);
+    get_buffer_stats(filter->graph, link, stats);
+    filter_unlock(filter, locked);
+}
+
+void avfilter_link_get_buffer_stats(AVFilterLink *link, AVFilterBufferStats *stats)
+{
+    AVFilterGraph *graph = link->dst->graph;
+
+    ff_filter_graph_api_enter(graph, NULL);
+    get_buffer_stats(graph, link, stats);
+    ff_filter_graph_api_leave(graph, NULL);
+}
+
+void avfilter_graph_get_buffer_stats(AVFilterGraph *graph, AVFilterBufferStats *stats)
+{
+    ff_filter_graph_api_enter(graph, NULL);
+    get_buffer_stats(graph, NULL, stats);
+    ff_filter_graph_api_leave(graph, NULL);
+}
+
+static void get_stats(AVFilterContext *filter, AVFilterStats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    stats->activations = filter->internal->activations;
+    stats->wall_time   = filter->internal->wall_time;
+    stats->cpu_time    = filter->internal->cpu_time;
+    for (unsigned i = 0; i < filter->nb_inputs; i++)
+        stats->frames_in += filter->inputs[i]->frame_count_out;
+    for (unsigned i = 0; i < filter->nb_outputs; i++) {
+        AVFilterLink *link = filter->outputs[i];
+
+        stats->frames_out += link->frame_count_in;
+        ff_link_pool_lock(link);
+        stats->frames_allocated += link->frame_count_alloc;
+        ff_link_pool_unlock(link);
+    }
+}
+
+void avfilter_get_stats(AVFilterContext *filter, AVFilterStats *stats)
+{
+    ff_filter_graph_api_enter(filter->graph, NULL);
+    get_stats(filter, stats);
+    ff_filter_graph_api_leave(filter->graph, NULL);
+}
+
+void avfilter_graph_get_stats(AVFilterGraph *graph, AVFilterStats *stats)
+{
+    ff_filter_graph_api_enter(graph, NULL);
+    for (unsigned i = 0; i < graph->nb_filters; i++)
+        get_stats(graph->filters[i], &stats[i]);
+    ff_filter_graph_api_leave(graph, NULL);
+}
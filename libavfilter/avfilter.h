@@ -419,6 +419,12 @@ unsigned avfilter_filter_pad_count(const AVFilter *filter, int is_output);
  * Process multiple parts of the frame concurrently.
  */
 #define AVFILTER_THREAD_SLICE (1 << 0)
+/**
+ * Activate different filters of a graph concurrently, so that e.g. the
+ * filters of a chain work on consecutive frames at the same time. Only
+ * meaningful in AVFilterGraph.thread_type.
+ */
+#define AVFILTER_THREAD_PIPELINE (1 << 1)
 
 typedef struct AVFilterInternal AVFilterInternal;
 
@@ -693,6 +699,11 @@ struct AVFilterLink {
      */
     AVBufferRef *hw_frames_ctx;
 
+    /**
+     * Number of frames allocated from the frame pool of the link.
+     */
+    int64_t frame_count_alloc;
+
 #ifndef FF_INTERNAL_FIELDS
 
     /**
@@ -735,6 +746,12 @@ struct AVFilterLink {
      */
     int status_out;
 
+    /**
+     * A frame was requested on the link but the request was held back
+     * because the graph exceeds its max_queued_bytes.
+     */
+    int frame_wanted_deferred;
+
 #endif /* FF_INTERNAL_FIELDS */
 
 };
@@ -904,6 +921,19 @@ typedef struct AVFilterGraph {
      * bit AND with AVFilterContext.thread_type to get the final mask used for
      * determining allowed threading types. I.e. a threading type needs to be
      * set in both to be allowed.
+     *
+     * AVFILTER_THREAD_PIPELINE is not enabled by default. If it is set when
+     * avfilter_graph_config() is called, nb_threads worker threads activate
+     * the filters of the graph until avfilter_graph_free(). The graph must
+     * then only be accessed through the buffersrc, buffersink and
+     * avfilter_graph_*() functions, and not from more than one thread at a
+     * time. Frames added with AV_BUFFERSRC_FLAG_PUSH are then processed in
+     * the background instead of before av_buffersrc_add_frame_flags()
+     * returns, except when closing the source.
+     *
+     * The workers serialize on a single graph lock and each pick of the next
+     * filter to activate is linear in the number of filters, so this mode
+     * does not scale to very large graphs or many threads.
      */
     int thread_type;
 
@@ -942,6 +972,39 @@ typedef struct AVFilterGraph {
 
     char *aresample_swr_opts; ///< swr options to use for the auto-inserted aresample filters, Access ONLY through AVOptions
 
+    /**
+     * Soft limit for the total size of the frames queued on the links of
+     * the graph, in bytes; 0 for no limit.
+     *
+     * While the limit is exceeded, a filter which already has frames
+     * queued on one of its outputs does not get the frames it requests on
+     * its inputs until enough queued frames are consumed. Frames pushed
+     * into buffer sources are still accepted; the sources whose frames are
+     * held back just do not report failed requests, see
+     * av_buffersrc_get_nb_failed_requests(). If the graph cannot make
+     * progress otherwise, the held back requests are issued anyway.
+     *
+     * Access ONLY through AVOptions.
+     */
+    int64_t max_queued_bytes;
+
+    /**
+     * Measure the time spent in each filter, see AVFilterStats.
+     *
+     * Access ONLY through AVOptions.
+     */
+    int profiling;
+
+    /**
+     * Run the slice threading jobs on the process-wide shared thread pool
+     * instead of threads of the graph, see libavutil/threadpool.h.
+     * nb_threads is then the maximum number of threads working on a filter
+     * at once. The pipeline threads are not affected.
+     *
+     * Access ONLY through AVOptions.
+     */
+    int shared_threads;
+
     /**
      * Private fields
      *
@@ -1207,6 +1270,64 @@ char *avfilter_graph_dump(AVFilterGraph *graph, const char *options);
  */
 int avfilter_graph_request_oldest(AVFilterGraph *graph);
 
+/**
+ * Statistics about the frames queued on a link or in a whole graph.
+ *
+ * The size of a frame is the size of the buffers it references, so frames
+ * sharing their buffers are counted once for every queue they are in.
+ */
+typedef struct AVFilterBufferStats {
+    uint64_t queued_frames;     ///< number of queued frames
+    uint64_t queued_bytes;      ///< total size of the queued frames
+    uint64_t peak_queued_bytes; ///< highest value of queued_bytes so far
+    /**
+     * Number of frame requests held back because of
+     * AVFilterGraph.max_queued_bytes.
+     */
+    unsigned deferred_requests;
+} AVFilterBufferStats;
+
+/**
+ * Get the statistics about the frames queued on a link.
+ */
+void avfilter_link_get_buffer_stats(AVFilterLink *link, AVFilterBufferStats *stats);
+
+/**
+ * Get the statistics about the frames queued on all the links of a graph.
+ */
+void avfilter_graph_get_buffer_stats(AVFilterGraph *graph, AVFilterBufferStats *stats);
+
+/**
+ * Statistics about the processing done by a filter.
+ *
+ * The times are only measured if AVFilterGraph.profiling is set. They cover
+ * the activations of the filter, i.e. the callbacks processing its frames,
+ * but not its initialization and configuration. The CPU time is the one of
+ * the thread activating the filter, it does not include the work done by
+ * the slice threads.
+ */
+typedef struct AVFilterStats {
+    uint64_t activations;      ///< number of times the filter was activated
+    int64_t  wall_time;        ///< time spent in the activations, in microseconds
+    int64_t  cpu_time;         ///< CPU time used by the activations, in microseconds, 0 if unsupported
+    uint64_t frames_in;        ///< number of frames consumed on the inputs
+    uint64_t frames_out;       ///< number of frames sent on the outputs
+    uint64_t frames_allocated; ///< number of frames allocated for the outputs
+} AVFilterStats;
+
+/**
+ * Get the processing statistics of a filter.
+ */
+void avfilter_get_stats(AVFilterContext *filter, AVFilterStats *stats);
+
+/**
+ * Get the processing statistics of all the filters of a graph at once.
+ *
+ * @param stats array of graph->nb_filters entries, set to the statistics of
+ *              graph->filters in the same order
+ */
+void avfilter_graph_get_stats(AVFilterGraph *graph, AVFilterStats *stats);
+
 /**
  * @}
  */
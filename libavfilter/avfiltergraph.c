@@ -30,6 +30,7 @@
 #include "libavutil/imgutils.h"
 #include "libavutil/opt.h"
 #include "libavutil/pixdesc.h"
+#include "libavutil/qsort.h"
 
 #define FF_INTERNAL_FIELDS 1
 #include "framequeue.h"
@@ -48,6 +49,7 @@ static const AVOption filtergraph_options[] = {
     { "thread_type", "Allowed thread types", OFFSET(thread_type), AV_OPT_TYPE_FLAGS,
         { .i64 = AVFILTER_THREAD_SLICE }, 0, INT_MAX, F|V|A, "thread_type" },
         { "slice", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_SLICE }, .flags = F|V|A, .unit = "thread_type" },
+        { "pipeline", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_PIPELINE }, .flags = F|V|A, .unit = "thread_type" },
     { "threads",     "Maximum number of threads", OFFSET(nb_threads), AV_OPT_TYPE_INT,
         { .i64 = 0 }, 0, INT_MAX, F|V|A, "threads"},
         {"auto", "autodetect a suitable number of threads to use", 0, AV_OPT_TYPE_CONST, {.i64 = 0 }, .flags = F|V|A, .unit = "threads"},
@@ -55,6 +57,12 @@ static const AVOption filtergraph_options[] = {
         AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, F|V },
     {"aresample_swr_opts"   , "default aresample filter options"    , OFFSET(aresample_swr_opts)    ,
         AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, F|A },
+    { "max_queued_bytes", "soft limit for the size of the frames queued in the graph",
+        OFFSET(max_queued_bytes), AV_OPT_TYPE_INT64, { .i64 = 0 }, 0, INT64_MAX, F|V|A },
+    { "profiling", "measure the time spent in each filter", OFFSET(profiling),
+        AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, F|V|A },
+    { "shared_threads", "run the slice threads on the shared thread pool", OFFSET(shared_threads),
+        AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, F|V|A },
     { NULL },
 };
 
@@ -77,6 +85,37 @@ int ff_graph_thread_init(AVFilterGraph *graph)
     graph->nb_threads  = 1;
     return 0;
 }
+
+int ff_graph_pipeline_start(AVFilterGraph *graph)
+{
+    return 0;
+}
+
+void ff_graph_pipeline_stop(AVFilterGraph *graph)
+{
+}
+
+int ff_graph_pipeline_run_once(AVFilterGraph *graph)
+{
+    return AVERROR_BUG;
+}
+
+void ff_graph_pipeline_wake(AVFilterGraph *graph)
+{
+}
+
+uint8_t *ff_graph_pipeline_unlocked(AVFilterGraph *graph)
+{
+    return NULL;
+}
+
+void ff_filter_graph_api_enter(AVFilterGraph *graph, AVFilterContext *filter)
+{
+}
+
+void ff_filter_graph_api_leave(AVFilterGraph *graph, AVFilterContext *filter)
+{
+}
 #endif
 
 AVFilterGraph *avfilter_graph_alloc(void)
@@ -95,12 +134,34 @@ AVFilterGraph *avfilter_graph_alloc(void)
     av_opt_set_defaults(ret);
     ff_framequeue_global_init(&ret->internal->frame_queues);
 
+    if (ff_mutex_init(&ret->internal->lock, NULL)) {
+        av_freep(&ret->internal);
+        av_freep(&ret);
+        return NULL;
+    }
+    if (ff_mutex_init(&ret->internal->pool_lock, NULL)) {
+        ff_mutex_destroy(&ret->internal->lock);
+        av_freep(&ret->internal);
+        av_freep(&ret);
+        return NULL;
+    }
+
     return ret;
 }
 
 void ff_filter_graph_remove_filter(AVFilterGraph *graph, AVFilterContext *filter)
 {
+    AVFilterGraphInternal *gi = graph->internal;
     int i, j;
+
+    for (i = 0; i < gi->nb_heartbeat_sources; i++) {
+        if (gi->heartbeat_sources[i] == filter) {
+            memmove(&gi->heartbeat_sources[i], &gi->heartbeat_sources[i + 1],
+                    (gi->nb_heartbeat_sources - i - 1) * sizeof(*gi->heartbeat_sources));
+            gi->nb_heartbeat_sources--;
+            break;
+        }
+    }
     for (i = 0; i < graph->nb_filters; i++) {
         if (graph->filters[i] == filter) {
             FFSWAP(AVFilterContext*, graph->filters[i],
@@ -121,10 +182,17 @@ void avfilter_graph_free(AVFilterGraph **graph)
     if (!*graph)
         return;
 
+    ff_graph_pipeline_stop(*graph);
+
     while ((*graph)->nb_filters)
         avfilter_free((*graph)->filters[0]);
 
     ff_graph_thread_free(*graph);
+    for (int i = 0; i < (*graph)->internal->nb_cached_frames; i++)
+        av_frame_free(&(*graph)->internal->frame_cache[i]);
+    av_freep(&(*graph)->internal->heartbeat_sources);
+    ff_mutex_destroy(&(*graph)->internal->lock);
+    ff_mutex_destroy(&(*graph)->internal->pool_lock);
 
     av_freep(&(*graph)->sink_links);
 
@@ -397,7 +465,14 @@ static int formats_declared(AVFilterContext *f)
 
 /**
  * Perform one round of query_formats() and merging formats lists on the
- * filter graph.
+ * filters of the graph which are not done yet.
+ *
+ * A filter is done once its formats are declared and all its inputs are
+ * merged; that never changes again, so later rounds skip it. Conversion
+ * filters are done when they are inserted.
+ *
+ * @param pending   filters which are not done yet, in graph order;
+ *                  updated to remove the filters done in this round
  * @return  >=0 if all links formats lists could be queried and merged;
  *          AVERROR(EAGAIN) some progress was made in the queries or merging
  *          and a later call may succeed;
@@ -405,17 +480,19 @@ static int formats_declared(AVFilterContext *f)
  *          was made and the negotiation is stuck;
  *          a negative error code if some other error happened
  */
-static int query_formats(AVFilterGraph *graph, void *log_ctx)
+static int query_formats(AVFilterGraph *graph, AVFilterContext **pending,
+                         unsigned *nb_pending, void *log_ctx)
 {
-    int i, j, ret;
+    unsigned i, j, nb_left = 0;
+    int ret;
     int converter_count = 0;
     int count_queried = 0;        /* successful calls to query_formats() */
     int count_merged = 0;         /* successful merge of formats lists */
     int count_already_merged = 0; /* lists already merged */
     int count_delayed = 0;        /* lists that need to be merged later */
 
-    for (i = 0; i < graph->nb_filters; i++) {
-        AVFilterContext *f = graph->filters[i];
+    for (i = 0; i < *nb_pending; i++) {
+        AVFilterContext *f = pending[i];
         if (formats_declared(f))
             continue;
         if (f->filter->formats_state == FF_FILTER_FORMATS_QUERY_FUNC)
@@ -429,8 +506,9 @@ static int query_formats(AVFilterGraph *graph, void *log_ctx)
     }
 
     /* go through and merge as many format lists as possible */
-    for (i = 0; i < graph->nb_filters; i++) {
-        AVFilterContext *filter = graph->filters[i];
+    for (i = 0; i < *nb_pending; i++) {
+        AVFilterContext *filter = pending[i];
+        int delayed = count_delayed;
 
         for (j = 0; j < filter->nb_inputs; j++) {
             AVFilterLink *link = filter->inputs[j];
@@ -540,7 +618,11 @@ static int query_formats(AVFilterGraph *graph, void *log_ctx)
                 }
             }
         }
+
+        if (count_delayed != delayed || !formats_declared(filter))
+            pending[nb_left++] = filter;
     }
+    *nb_pending = nb_left;
 
     av_log(graph, AV_LOG_DEBUG, "query_formats: "
            "%d queried, %d merged, %d already done, %d delayed\n",
@@ -685,6 +767,121 @@ FF_ENABLE_DEPRECATION_WARNINGS
     return 0;
 }
 
+typedef struct WorklistLink {
+    AVFilterLink *link;
+    unsigned src, dst;          ///< indices of the filters in the graph
+} WorklistLink;
+
+/**
+ * Filters to visit in the iterative passes of reduce_formats() and
+ * pick_formats(). A filter only has to be visited again when one of the
+ * formats lists referenced by its links changed, which is found through the
+ * refs of the changed list; formats lists are shared by a whole connected
+ * region of the graph after merging, so the neighbours of a filter are not
+ * enough.
+ */
+typedef struct FormatsWorklist {
+    uint8_t *dirty;             ///< per filter, in graph order
+    unsigned nb_filters;
+    WorklistLink *links;        ///< sorted by address, to map refs to links
+    unsigned nb_links;
+} FormatsWorklist;
+
+static int cmp_worklist_link(const WorklistLink *a, const WorklistLink *b)
+{
+    return FFDIFFSIGN((uintptr_t)a->link, (uintptr_t)b->link);
+}
+
+/**
+ * @return the entry of the link containing ptr, NULL if there is none
+ */
+static WorklistLink *worklist_find(FormatsWorklist *wl, const void *ptr)
+{
+    unsigned lo = 0, hi = wl->nb_links;
+
+    while (lo < hi) {
+        unsigned mid = (lo + hi) >> 1;
+        if ((uintptr_t)wl->links[mid].link <= (uintptr_t)ptr)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo && (uintptr_t)ptr < (uintptr_t)(wl->links[lo - 1].link + 1))
+        return &wl->links[lo - 1];
+    return NULL;
+}
+
+static int worklist_init(FormatsWorklist *wl, AVFilterGraph *graph)
+{
+    unsigned i, j;
+
+    wl->nb_filters = graph->nb_filters;
+    wl->nb_links   = 0;
+    for (i = 0; i < graph->nb_filters; i++)
+        wl->nb_links += graph->filters[i]->nb_outputs;
+
+    wl->dirty = av_malloc(wl->nb_filters);
+    wl->links = av_malloc_array(wl->nb_links, sizeof(*wl->links));
+    if (!wl->dirty || (wl->nb_links && !wl->links)) {
+        av_freep(&wl->dirty);
+        av_freep(&wl->links);
+        return AVERROR(ENOMEM);
+    }
+
+    wl->nb_links = 0;
+    for (i = 0; i < graph->nb_filters; i++)
+        for (j = 0; j < graph->filters[i]->nb_outputs; j++)
+            wl->links[wl->nb_links++] = (WorklistLink) {
+                .link = graph->filters[i]->outputs[j],
+                .src  = i,
+            };
+    if (wl->nb_links)
+        AV_QSORT(wl->links, wl->nb_links, WorklistLink, cmp_worklist_link);
+    for (i = 0; i < graph->nb_filters; i++)
+        for (j = 0; j < graph->filters[i]->nb_inputs; j++)
+            worklist_find(wl, graph->filters[i]->inputs[j])->dst = i;
+
+    return 0;
+}
+
+static void worklist_uninit(FormatsWorklist *wl)
+{
+    av_freep(&wl->dirty);
+    av_freep(&wl->links);
+}
+
+/**
+ * Mark both filters of the link containing ptr as dirty, e.g. ptr may be
+ * a link or a formats list ref.
+ */
+static void worklist_mark_link(FormatsWorklist *wl, const void *ptr)
+{
+    const WorklistLink *l = worklist_find(wl, ptr);
+
+    if (l) {
+        wl->dirty[l->src] = wl->dirty[l->dst] = 1;
+    } else {
+        memset(wl->dirty, 1, wl->nb_filters);
+    }
+}
+
+/**
+ * Mark all the filters whose links reference list as dirty.
+ */
+#define WORKLIST_MARK_LIST(wl, list)                                   \
+do {                                                                   \
+    if (list)                                                          \
+        for (unsigned r = 0; r < (list)->refcount; r++)                \
+            worklist_mark_link(wl, (list)->refs[r]);                  \
+} while (0)
+
+static void worklist_mark_cfg(FormatsWorklist *wl, AVFilterFormatsConfig *cfg)
+{
+    WORKLIST_MARK_LIST(wl, cfg->formats);
+    WORKLIST_MARK_LIST(wl, cfg->samplerates);
+    WORKLIST_MARK_LIST(wl, cfg->channel_layouts);
+}
+
 #define REDUCE_FORMATS(fmt_type, list_type, list, var, nb, add_format) \
 do {                                                                   \
     for (i = 0; i < filter->nb_inputs; i++) {                          \
@@ -753,8 +950,9 @@ static int reduce_formats_on_filter(AVFilterContext *filter)
                 (KNOWN(fmt) || fmts->all_counts)) {
                 /* Turn the infinite list into a singleton */
                 fmts->all_layouts = fmts->all_counts  = 0;
-                if (ff_add_channel_layout(&outlink->incfg.channel_layouts, fmt) < 0)
-                    ret = 1;
+                if ((ret = ff_add_channel_layout(&outlink->incfg.channel_layouts, fmt)) < 0)
+                    return ret;
+                ret = 1;
                 break;
             }
 
@@ -774,17 +972,29 @@ static int reduce_formats_on_filter(AVFilterContext *filter)
     return ret;
 }
 
-static int reduce_formats(AVFilterGraph *graph)
+static int reduce_formats(AVFilterGraph *graph, FormatsWorklist *wl)
 {
-    int i, reduced, ret;
+    unsigned i, j;
+    int reduced, ret;
 
+    memset(wl->dirty, 1, wl->nb_filters);
     do {
         reduced = 0;
 
         for (i = 0; i < graph->nb_filters; i++) {
-            if ((ret = reduce_formats_on_filter(graph->filters[i])) < 0)
+            AVFilterContext *filter = graph->filters[i];
+
+            if (!wl->dirty[i])
+                continue;
+            wl->dirty[i] = 0;
+            if ((ret = reduce_formats_on_filter(filter)) < 0)
                 return ret;
-            reduced |= ret;
+            if (!ret)
+                continue;
+            /* only the lists of the outputs can have been reduced */
+            wl->dirty[i] = reduced = 1;
+            for (j = 0; j < filter->nb_outputs; j++)
+                worklist_mark_cfg(wl, &filter->outputs[j]->incfg);
         }
     } while (reduced);
 
@@ -1045,19 +1255,36 @@ static void swap_sample_fmts(AVFilterGraph *graph)
 
 }
 
-static int pick_formats(AVFilterGraph *graph)
+/**
+ * pick_format() with the filters affected by the choice marked as dirty:
+ * the ones referencing the lists of the link, which are reduced to the
+ * chosen format, and the ones of the link itself.
+ */
+static int pick_format_marked(FormatsWorklist *wl, AVFilterLink *link,
+                              AVFilterLink *ref)
+{
+    worklist_mark_cfg(wl, &link->incfg);
+    worklist_mark_link(wl, link);
+    return pick_format(link, ref);
+}
+
+static int pick_formats(AVFilterGraph *graph, FormatsWorklist *wl)
 {
     int i, j, ret;
     int change;
 
+    memset(wl->dirty, 1, wl->nb_filters);
     do{
         change = 0;
         for (i = 0; i < graph->nb_filters; i++) {
             AVFilterContext *filter = graph->filters[i];
+            if (!wl->dirty[i])
+                continue;
+            wl->dirty[i] = 0;
             if (filter->nb_inputs){
                 for (j = 0; j < filter->nb_inputs; j++){
                     if (filter->inputs[j]->incfg.formats && filter->inputs[j]->incfg.formats->nb_formats == 1) {
-                        if ((ret = pick_format(filter->inputs[j], NULL)) < 0)
+                        if ((ret = pick_format_marked(wl, filter->inputs[j], NULL)) < 0)
                             return ret;
                         change = 1;
                     }
@@ -1066,7 +1293,7 @@ static int pick_formats(AVFilterGraph *graph)
             if (filter->nb_outputs){
                 for (j = 0; j < filter->nb_outputs; j++){
                     if (filter->outputs[j]->incfg.formats && filter->outputs[j]->incfg.formats->nb_formats == 1) {
-                        if ((ret = pick_format(filter->outputs[j], NULL)) < 0)
+                        if ((ret = pick_format_marked(wl, filter->outputs[j], NULL)) < 0)
                             return ret;
                         change = 1;
                     }
@@ -1075,7 +1302,7 @@ static int pick_formats(AVFilterGraph *graph)
             if (filter->nb_inputs && filter->nb_outputs && filter->inputs[0]->format>=0) {
                 for (j = 0; j < filter->nb_outputs; j++) {
                     if (filter->outputs[j]->format<0) {
-                        if ((ret = pick_format(filter->outputs[j], filter->inputs[0])) < 0)
+                        if ((ret = pick_format_marked(wl, filter->outputs[j], filter->inputs[0])) < 0)
                             return ret;
                         change = 1;
                     }
@@ -1102,19 +1329,31 @@ static int pick_formats(AVFilterGraph *graph)
  */
 static int graph_config_formats(AVFilterGraph *graph, void *log_ctx)
 {
+    FormatsWorklist wl;
+    AVFilterContext **pending;
+    unsigned nb_pending = graph->nb_filters;
     int ret;
 
+    pending = av_memdup(graph->filters, nb_pending * sizeof(*pending));
+    if (!pending && nb_pending)
+        return AVERROR(ENOMEM);
+
     /* find supported formats from sub-filters, and merge along links */
-    while ((ret = query_formats(graph, log_ctx)) == AVERROR(EAGAIN))
+    while ((ret = query_formats(graph, pending, &nb_pending, log_ctx)) == AVERROR(EAGAIN))
         av_log(graph, AV_LOG_DEBUG, "query_formats not finished\n");
+    av_free(pending);
     if (ret < 0)
         return ret;
 
+    /* The graph does not change anymore from here on. */
+    if ((ret = worklist_init(&wl, graph)) < 0)
+        return ret;
+
     /* Once everything is merged, it's possible that we'll still have
      * multiple valid media format choices. We try to minimize the amount
      * of format conversion inside filters */
-    if ((ret = reduce_formats(graph)) < 0)
-        return ret;
+    if ((ret = reduce_formats(graph, &wl)) < 0)
+        goto end;
 
     /* for audio filters, ensure the best format, sample rate and channel layout
      * is selected */
@@ -1122,10 +1361,11 @@ static int graph_config_formats(AVFilterGraph *graph, void *log_ctx)
     swap_samplerates(graph);
     swap_channel_layouts(graph);
 
-    if ((ret = pick_formats(graph)) < 0)
-        return ret;
+    ret = pick_formats(graph, &wl);
 
-    return 0;
+end:
+    worklist_uninit(&wl);
+    return ret < 0 ? ret : 0;
 }
 
 static int graph_config_pointers(AVFilterGraph *graph, void *log_ctx)
@@ -1184,7 +1424,7 @@ int avfilter_graph_config(AVFilterGraph *graphctx, void *log_ctx)
     if ((ret = graph_config_pointers(graphctx, log_ctx)))
         return ret;
 
-    return 0;
+    return ff_graph_pipeline_start(graphctx);
 }
 
 int avfilter_graph_send_command(AVFilterGraph *graph, const char *target, const char *cmd, const char *arg, char *res, int res_len, int flags)
@@ -1206,7 +1446,9 @@ int avfilter_graph_send_command(AVFilterGraph *graph, const char *target, const
     for (i = 0; i < graph->nb_filters; i++) {
         AVFilterContext *filter = graph->filters[i];
         if (!strcmp(target, "all") || (filter->name && !strcmp(target, filter->name)) || !strcmp(target, filter->filter->name)) {
+            ff_filter_graph_api_enter(graph, filter);
             r = avfilter_process_command(filter, cmd, arg, res, res_len, flags);
+            ff_filter_graph_api_leave(graph, filter);
             if (r != AVERROR(ENOSYS)) {
                 if ((flags & AVFILTER_CMD_FLAG_ONE) || r < 0)
                     return r;
@@ -1217,13 +1459,10 @@ int avfilter_graph_send_command(AVFilterGraph *graph, const char *target, const
     return r;
 }
 
-int avfilter_graph_queue_command(AVFilterGraph *graph, const char *target, const char *command, const char *arg, int flags, double ts)
+static int queue_command(AVFilterGraph *graph, const char *target, const char *command, const char *arg, int flags, double ts)
 {
     int i;
 
-    if(!graph)
-        return 0;
-
     for (i = 0; i < graph->nb_filters; i++) {
         AVFilterContext *filter = graph->filters[i];
         if(filter && (!strcmp(target, "all") || !strcmp(target, filter->name) || !strcmp(target, filter->filter->name))){
@@ -1248,6 +1487,19 @@ int avfilter_graph_queue_command(AVFilterGraph *graph, const char *target, const
     return 0;
 }
 
+int avfilter_graph_queue_command(AVFilterGraph *graph, const char *target, const char *command, const char *arg, int flags, double ts)
+{
+    int ret;
+
+    if(!graph)
+        return 0;
+
+    ff_filter_graph_api_enter(graph, NULL);
+    ret = queue_command(graph, target, command, arg, flags, ts);
+    ff_filter_graph_api_leave(graph, NULL);
+    return ret;
+}
+
 static void heap_bubble_up(AVFilterGraph *graph,
                            AVFilterLink *link, int index)
 {
@@ -1297,7 +1549,7 @@ void ff_avfilter_graph_update_heap(AVFilterGraph *graph, AVFilterLink *link)
     heap_bubble_down(graph, link, link->age_index);
 }
 
-int avfilter_graph_request_oldest(AVFilterGraph *graph)
+static int request_oldest(AVFilterGraph *graph)
 {
     AVFilterLink *oldest = graph->sink_links[0];
     int64_t frame_count;
@@ -1312,7 +1564,9 @@ int avfilter_graph_request_oldest(AVFilterGraph *graph)
             if (r != AVERROR_EOF)
                 return r;
         } else {
+            ff_filter_graph_api_enter(graph, oldest->dst);
             r = ff_request_frame(oldest);
+            ff_filter_graph_api_leave(graph, oldest->dst);
         }
         if (r != AVERROR_EOF)
             break;
@@ -1329,6 +1583,7 @@ int avfilter_graph_request_oldest(AVFilterGraph *graph)
         return AVERROR_EOF;
     av_assert1(!oldest->dst->filter->activate);
     av_assert1(oldest->age_index >= 0);
+    ff_filter_graph_api_enter(graph, oldest->dst);
     frame_count = oldest->frame_count_out;
     while (frame_count == oldest->frame_count_out) {
         r = ff_filter_graph_run_once(graph);
@@ -1337,16 +1592,81 @@ int avfilter_graph_request_oldest(AVFilterGraph *graph)
             !oldest->status_in)
             ff_request_frame(oldest);
         else if (r < 0)
-            return r;
+            break;
     }
-    return 0;
+    ff_filter_graph_api_leave(graph, oldest->dst);
+    return r < 0 ? r : 0;
 }
 
-int ff_filter_graph_run_once(AVFilterGraph *graph)
+int avfilter_graph_request_oldest(AVFilterGraph *graph)
+{
+    int ret;
+
+    /* The sink links heap is updated while frames are consumed. */
+    ff_filter_graph_api_enter(graph, NULL);
+    ret = request_oldest(graph);
+    ff_filter_graph_api_leave(graph, NULL);
+    return ret;
+}
+
+size_t ff_filter_graph_queued_frames(AVFilterGraph *graph)
+{
+    size_t queued = 0;
+
+    for (unsigned i = 0; i < graph->nb_filters; i++) {
+        AVFilterContext *filter = graph->filters[i];
+
+        if (!filter->nb_outputs)
+            continue;
+        for (unsigned j = 0; j < filter->nb_inputs; j++)
+            queued += ff_framequeue_queued_frames(&filter->inputs[j]->fifo);
+    }
+    return queued;
+}
+
+AVFrame *ff_filter_graph_frame_alloc(AVFilterGraph *graph)
+{
+    AVFilterGraphInternal *gi = graph->internal;
+    AVFrame *frame = NULL;
+
+    if (gi->pipeline)
+        ff_mutex_lock(&gi->pool_lock);
+    if (gi->nb_cached_frames)
+        frame = gi->frame_cache[--gi->nb_cached_frames];
+    if (gi->pipeline)
+        ff_mutex_unlock(&gi->pool_lock);
+
+    return frame ? frame : av_frame_alloc();
+}
+
+void ff_filter_graph_frame_free(AVFilterGraph *graph, AVFrame **frame)
+{
+    AVFilterGraphInternal *gi = graph->internal;
+
+    if (!*frame)
+        return;
+    av_frame_unref(*frame);
+
+    if (gi->pipeline)
+        ff_mutex_lock(&gi->pool_lock);
+    if (gi->nb_cached_frames < FF_GRAPH_FRAME_CACHE_SIZE) {
+        gi->frame_cache[gi->nb_cached_frames++] = *frame;
+        *frame = NULL;
+    }
+    if (gi->pipeline)
+        ff_mutex_unlock(&gi->pool_lock);
+
+    av_frame_free(frame);
+}
+
+static int run_once(AVFilterGraph *graph)
 {
     AVFilterContext *filter;
     unsigned i;
 
+    if (graph->internal->pipeline)
+        return ff_graph_pipeline_run_once(graph);
+
     av_assert0(graph->nb_filters);
     filter = graph->filters[0];
     for (i = 1; i < graph->nb_filters; i++)
@@ -1356,3 +1676,13 @@ int ff_filter_graph_run_once(AVFilterGraph *graph)
         return AVERROR(EAGAIN);
     return ff_filter_activate(filter);
 }
+
+int ff_filter_graph_run_once(AVFilterGraph *graph)
+{
+    int ret = run_once(graph);
+
+    /* Requests held back by max_queued_bytes must not stall the graph. */
+    if (ret == AVERROR(EAGAIN) && ff_filter_graph_force_deferred_requests(graph))
+        return 0;
+    return ret;
+}
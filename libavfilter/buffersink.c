@@ -29,6 +29,7 @@
 #include "libavutil/common.h"
 #include "libavutil/internal.h"
 #include "libavutil/opt.h"
+#include "libavutil/samplefmt.h"
 
 #include "libavcodec/avcodec.h"
 
@@ -68,6 +69,9 @@ typedef struct BufferSinkContext {
     int subtitle_types_size;
 
     AVFrame *peeked_frame;
+
+    int (*get_buffer)(void *opaque, AVFrame *frame, int flags);
+    void *get_buffer_opaque;
 } BufferSinkContext;
 
 #define NB_ITEMS(list) (list ## _size / sizeof(*list))
@@ -102,8 +106,10 @@ int attribute_align_arg av_buffersink_get_frame(AVFilterContext *ctx, AVFrame *f
     return av_buffersink_get_frame_flags(ctx, frame, 0);
 }
 
-static int return_or_keep_frame(BufferSinkContext *buf, AVFrame *out, AVFrame *in, int flags)
+static int return_or_keep_frame(AVFilterContext *ctx, AVFrame *out, AVFrame *in, int flags)
 {
+    BufferSinkContext *buf = ctx->priv;
+
     if ((flags & AV_BUFFERSINK_FLAG_PEEK)) {
         buf->peeked_frame = in;
         return out ? av_frame_ref(out, in) : 0;
@@ -111,7 +117,8 @@ static int return_or_keep_frame(BufferSinkContext *buf, AVFrame *out, AVFrame *i
         av_assert1(out);
         buf->peeked_frame = NULL;
         av_frame_move_ref(out, in);
-        av_frame_free(&in);
+        /* the empty frame is reused by the buffer sources */
+        ff_filter_graph_frame_free(ctx->graph, &in);
         return 0;
     }
 }
@@ -125,7 +132,7 @@ static int get_frame_internal(AVFilterContext *ctx, AVFrame *frame, int flags, i
     int64_t pts;
 
     if (buf->peeked_frame)
-        return return_or_keep_frame(buf, frame, buf->peeked_frame, flags);
+        return return_or_keep_frame(ctx, frame, buf->peeked_frame, flags);
 
     while (1) {
         ret = samples ? ff_inlink_consume_samples(inlink, samples, samples, &cur_frame) :
@@ -133,8 +140,7 @@ static int get_frame_internal(AVFilterContext *ctx, AVFrame *frame, int flags, i
         if (ret < 0) {
             return ret;
         } else if (ret) {
-            /* TODO return the frame instead of copying it */
-            return return_or_keep_frame(buf, frame, cur_frame, flags);
+            return return_or_keep_frame(ctx, frame, cur_frame, flags);
         } else if (ff_inlink_acknowledge_status(inlink, &status, &pts)) {
             return status;
         } else if ((flags & AV_BUFFERSINK_FLAG_NO_REQUEST)) {
@@ -149,15 +155,25 @@ static int get_frame_internal(AVFilterContext *ctx, AVFrame *frame, int flags, i
     }
 }
 
+static int get_frame(AVFilterContext *ctx, AVFrame *frame, int flags, int samples)
+{
+    int ret;
+
+    ff_filter_graph_api_enter(ctx->graph, ctx);
+    ret = get_frame_internal(ctx, frame, flags, samples);
+    ff_filter_graph_api_leave(ctx->graph, ctx);
+    return ret;
+}
+
 int attribute_align_arg av_buffersink_get_frame_flags(AVFilterContext *ctx, AVFrame *frame, int flags)
 {
-    return get_frame_internal(ctx, frame, flags, ctx->inputs[0]->min_samples);
+    return get_frame(ctx, frame, flags, ctx->inputs[0]->min_samples);
 }
 
 int attribute_align_arg av_buffersink_get_samples(AVFilterContext *ctx,
                                                   AVFrame *frame, int nb_samples)
 {
-    return get_frame_internal(ctx, frame, 0, nb_samples);
+    return get_frame(ctx, frame, 0, nb_samples);
 }
 
 #if FF_API_BUFFERSINK_ALLOC
@@ -195,7 +211,7 @@ static int activate(AVFilterContext *ctx)
     BufferSinkContext *buf = ctx->priv;
 
     if (buf->warning_limit &&
-        ff_framequeue_queued_frames(&ctx->inputs[0]->fifo) >= buf->warning_limit) {
+        ff_inlink_queued_frames(ctx->inputs[0]) >= buf->warning_limit) {
         av_log(ctx, AV_LOG_WARNING,
                "%d buffers queued in %s, something may be wrong.\n",
                buf->warning_limit,
@@ -214,6 +230,84 @@ void av_buffersink_set_frame_size(AVFilterContext *ctx, unsigned frame_size)
     inlink->min_samples = inlink->max_samples = frame_size;
 }
 
+void av_buffersink_set_get_buffer(AVFilterContext *ctx,
+                                  int (*get_buffer)(void *opaque, AVFrame *frame,
+                                                    int flags),
+                                  void *opaque)
+{
+    BufferSinkContext *buf = ctx->priv;
+
+    av_assert0(ctx->filter->activate == activate &&
+               ctx->filter->inputs[0].type != AVMEDIA_TYPE_SUBTITLE);
+    buf->get_buffer        = get_buffer;
+    buf->get_buffer_opaque = opaque;
+}
+
+/* Returns NULL to let the graph allocate the frame from its own pool. */
+static AVFrame *get_app_buffer(AVFilterLink *inlink, AVFrame *frame)
+{
+    AVFilterContext *ctx = inlink->dst;
+    BufferSinkContext *buf = ctx->priv;
+    int ret;
+
+    frame->type   = inlink->type;
+    frame->format = inlink->format;
+    ret = buf->get_buffer(buf->get_buffer_opaque, frame, 0);
+    if (ret >= 0 && (!frame->buf[0] || !frame->extended_data[0])) {
+        av_frame_unref(frame);
+        ret = AVERROR(EINVAL);
+    }
+    if (ret < 0) {
+        av_log(ctx, AV_LOG_ERROR, "Could not allocate the frame with the "
+               "callback: %s, using the graph pool.\n", av_err2str(ret));
+        ff_filter_graph_frame_free(ctx->graph, &frame);
+        return NULL;
+    }
+    return frame;
+}
+
+static AVFrame *vsink_get_video_buffer(AVFilterLink *inlink, int w, int h)
+{
+    BufferSinkContext *buf = inlink->dst->priv;
+    AVFrame *frame;
+
+    if (!buf->get_buffer || inlink->hw_frames_ctx ||
+        !(frame = ff_filter_graph_frame_alloc(inlink->dst->graph)))
+        return NULL;
+    frame->width  = w;
+    frame->height = h;
+    if (!(frame = get_app_buffer(inlink, frame)))
+        return NULL;
+    frame->sample_aspect_ratio = inlink->sample_aspect_ratio;
+    return frame;
+}
+
+static AVFrame *asink_get_audio_buffer(AVFilterLink *inlink, int nb_samples)
+{
+    BufferSinkContext *buf = inlink->dst->priv;
+    AVFrame *frame;
+
+    if (!buf->get_buffer ||
+        !(frame = ff_filter_graph_frame_alloc(inlink->dst->graph)))
+        return NULL;
+    frame->nb_samples  = nb_samples;
+    frame->sample_rate = inlink->sample_rate;
+#if FF_API_OLD_CHANNEL_LAYOUT
+FF_DISABLE_DEPRECATION_WARNINGS
+    frame->channel_layout = inlink->channel_layout;
+FF_ENABLE_DEPRECATION_WARNINGS
+#endif
+    if (av_channel_layout_copy(&frame->ch_layout, &inlink->ch_layout) < 0) {
+        ff_filter_graph_frame_free(inlink->dst->graph, &frame);
+        return NULL;
+    }
+    if (!(frame = get_app_buffer(inlink, frame)))
+        return NULL;
+    av_samples_set_silence(frame->extended_data, 0, nb_samples,
+                           inlink->ch_layout.nb_channels, inlink->format);
+    return frame;
+}
+
 #define MAKE_AVFILTERLINK_ACCESSOR(type, field) \
 type av_buffersink_get_##field(const AVFilterContext *ctx) { \
     av_assert0(ctx->filter->activate == activate); \
@@ -438,6 +532,7 @@ static const AVFilterPad avfilter_vsink_buffer_inputs[] = {
     {
         .name = "default",
         .type = AVMEDIA_TYPE_VIDEO,
+        .get_buffer.video = vsink_get_video_buffer,
     },
 };
 
@@ -457,6 +552,7 @@ static const AVFilterPad avfilter_asink_abuffer_inputs[] = {
     {
         .name = "default",
         .type = AVMEDIA_TYPE_AUDIO,
+        .get_buffer.audio = asink_get_audio_buffer,
     },
 };
 
@@ -146,6 +146,32 @@ typedef struct AVSBufferSinkParams {
  */
 void av_buffersink_set_frame_size(AVFilterContext *ctx, unsigned frame_size);
 
+/**
+ * Set a callback allocating the buffers of the frames filtered for a video
+ * or audio buffer sink, e.g. from the frame pools of an encoder. The frames
+ * then reach the application without being copied, and their buffers return
+ * to the application pools when they are freed.
+ *
+ * The callback is called by the last filter of the graph allocating its
+ * output frames, with the type, format, width and height or nb_samples,
+ * ch_layout and sample_rate of frame set. It must set frame->buf and
+ * frame->data or frame->extended_data, with buffers at least as large and
+ * aligned as av_frame_get_buffer2() would allocate them, and return 0; or
+ * return a negative AVERROR code, in which case the graph allocates the
+ * frame itself. It is not called for hardware frames.
+ *
+ * This function must be called before the graph is configured. The callback
+ * may be called from any thread running the graph.
+ *
+ * @param ctx        a buffersink or abuffersink filter context
+ * @param get_buffer the callback; flags is currently always 0
+ * @param opaque     user data passed to the callback
+ */
+void av_buffersink_set_get_buffer(AVFilterContext *ctx,
+                                  int (*get_buffer)(void *opaque, AVFrame *frame,
+                                                    int flags),
+                                  void *opaque);
+
 /**
  * @defgroup lavfi_buffersink_accessors Buffer sink accessors
  * Get the properties of the stream
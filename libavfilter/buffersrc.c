@@ -38,9 +38,13 @@
 #include "buffersrc.h"
 #include "formats.h"
 #include "internal.h"
+#include "subtitles.h"
 #include "video.h"
 #include "libavcodec/avcodec.h"
 
+/* Timestamp step and duration of subtitle heartbeat frames, in AV_TIME_BASE */
+#define HEARTBEAT_STEP 10000
+
 typedef struct BufferSourceContext {
     const AVClass    *class;
     AVRational        time_base;     ///< time_base to set in the output link
@@ -66,10 +70,18 @@ typedef struct BufferSourceContext {
 
     /* subtitle only */
     enum AVSubtitleType subtitle_type;
+    int heartbeat;
+    int64_t heartbeat_lag;
+    int64_t last_pts;       ///< of the last frame sent, in the link time base
+    int64_t inputs_ts;      ///< latest timestamp of the other buffer sources, in AV_TIME_BASE
+
+    int64_t ts;             ///< of the last frame added, in AV_TIME_BASE
 
     int eof;
 } BufferSourceContext;
 
+extern const AVFilter ff_ssrc_sbuffer;
+
 #define CHECK_VIDEO_PARAM_CHANGE(s, c, width, height, format, pts)\
     if (c->w != width || c->h != height || c->pix_fmt != format) {\
         av_log(s, AV_LOG_INFO, "filter context - w: %d h: %d fmt: %d, incoming frame - w: %d h: %d fmt: %d pts_time: %s\n",\
@@ -172,11 +184,16 @@ int attribute_align_arg av_buffersrc_add_frame(AVFilterContext *ctx, AVFrame *fr
     return av_buffersrc_add_frame_flags(ctx, frame, 0);
 }
 
-static int push_frame(AVFilterGraph *graph)
+static int push_frame(AVFilterGraph *graph, int max_queued)
 {
     int ret;
 
     while (1) {
+        /* With pipeline threading, the workers process the frames in the
+           background, only bound the number of frames in flight. */
+        if (graph->internal->pipeline && max_queued >= 0 &&
+            ff_filter_graph_queued_frames(graph) <= max_queued)
+            break;
         ret = ff_filter_graph_run_once(graph);
         if (ret == AVERROR(EAGAIN))
             break;
@@ -186,7 +203,71 @@ static int push_frame(AVFilterGraph *graph)
     return 0;
 }
 
-int attribute_align_arg av_buffersrc_add_frame_flags(AVFilterContext *ctx, AVFrame *frame, int flags)
+/**
+ * Send an empty subtitle frame if the subtitles lag too far behind the
+ * other inputs of the graph, so that filters synchronizing them with these
+ * inputs do not have to wait for the next subtitle event.
+ */
+static int send_heartbeat(AVFilterContext *ctx)
+{
+    BufferSourceContext *s = ctx->priv;
+    AVFilterLink *outlink = ctx->outputs[0];
+    AVFrame *frame;
+    int64_t pts;
+
+    if (s->eof || s->inputs_ts == AV_NOPTS_VALUE)
+        return 0;
+    pts = av_rescale_q(s->inputs_ts, AV_TIME_BASE_Q, outlink->time_base);
+    /* Only the first heartbeat is sent as soon as the other inputs start. */
+    if (s->last_pts != AV_NOPTS_VALUE &&
+        pts - av_rescale_q(s->heartbeat_lag, AV_TIME_BASE_Q, outlink->time_base) <= s->last_pts)
+        return 0;
+
+    frame = ff_get_subtitles_buffer(outlink, outlink->format);
+    if (!frame)
+        return AVERROR(ENOMEM);
+
+    pts = FFMAX(pts, s->last_pts) +
+          av_rescale_q(HEARTBEAT_STEP, AV_TIME_BASE_Q, outlink->time_base);
+    frame->width  = s->w;
+    frame->height = s->h;
+    frame->pts    = pts;
+    frame->subtitle_timing.start_pts = av_rescale_q(pts, outlink->time_base, AV_TIME_BASE_Q);
+    frame->subtitle_timing.duration  = HEARTBEAT_STEP;
+    s->last_pts = pts;
+
+    av_log(ctx, AV_LOG_DEBUG, "heartbeat pts_time:%s\n",
+           av_ts2timestr(pts, &outlink->time_base));
+
+    s->nb_failed_requests = 0;
+    return ff_filter_frame(outlink, frame);
+}
+
+/**
+ * Pass the timestamp of a frame added to ctx to the subtitle sources of the
+ * graph with heartbeat enabled, and send heartbeats on the ones waited for.
+ */
+static int update_heartbeats(AVFilterContext *ctx, int64_t ts)
+{
+    AVFilterGraph *graph = ctx->graph;
+    AVFilterGraphInternal *gi = graph->internal;
+    int ret = 0;
+
+    for (unsigned i = 0; i < gi->nb_heartbeat_sources && ret >= 0; i++) {
+        AVFilterContext *sub = gi->heartbeat_sources[i];
+        BufferSourceContext *s = sub->priv;
+
+        ff_filter_graph_api_enter(graph, sub);
+        if (s->inputs_ts == AV_NOPTS_VALUE || ts > s->inputs_ts)
+            s->inputs_ts = ts;
+        if (sub->outputs[0]->frame_wanted_out)
+            ret = send_heartbeat(sub);
+        ff_filter_graph_api_leave(graph, sub);
+    }
+    return ret;
+}
+
+static int add_frame(AVFilterContext *ctx, AVFrame *frame, int flags)
 {
     BufferSourceContext *s = ctx->priv;
     AVFrame *copy;
@@ -243,7 +324,7 @@ FF_ENABLE_DEPRECATION_WARNINGS
 
     }
 
-    if (!(copy = av_frame_alloc()))
+    if (!(copy = ff_filter_graph_frame_alloc(ctx->graph)))
         return AVERROR(ENOMEM);
 
     if (refcounted && !(flags & AV_BUFFERSRC_FLAG_KEEP_REF)) {
@@ -251,7 +332,7 @@ FF_ENABLE_DEPRECATION_WARNINGS
     } else {
         ret = av_frame_ref(copy, frame);
         if (ret < 0) {
-            av_frame_free(&copy);
+            ff_filter_graph_frame_free(ctx->graph, &copy);
             return ret;
         }
     }
@@ -263,12 +344,30 @@ FF_DISABLE_DEPRECATION_WARNINGS
 FF_ENABLE_DEPRECATION_WARNINGS
 #endif
 
+    if (s->heartbeat) {
+        /* keep the timestamps monotonic after heartbeats */
+        if (s->last_pts != AV_NOPTS_VALUE && copy->pts != AV_NOPTS_VALUE &&
+            copy->pts <= s->last_pts)
+            copy->pts = s->last_pts + 1;
+        if (copy->pts != AV_NOPTS_VALUE)
+            s->last_pts = copy->pts;
+    } else if (copy->pts != AV_NOPTS_VALUE) {
+        s->ts = av_rescale_q(copy->pts, ctx->outputs[0]->time_base, AV_TIME_BASE_Q);
+    }
+
     ret = ff_filter_frame(ctx->outputs[0], copy);
     if (ret < 0)
         return ret;
 
+    if (ctx->graph->internal->nb_heartbeat_sources && !s->heartbeat &&
+        s->ts != AV_NOPTS_VALUE) {
+        ret = update_heartbeats(ctx, s->ts);
+        if (ret < 0)
+            return ret;
+    }
+
     if ((flags & AV_BUFFERSRC_FLAG_PUSH)) {
-        ret = push_frame(ctx->graph);
+        ret = push_frame(ctx->graph, ctx->graph->nb_threads - 1);
         if (ret < 0)
             return ret;
     }
@@ -276,19 +375,36 @@ FF_ENABLE_DEPRECATION_WARNINGS
     return 0;
 }
 
+int attribute_align_arg av_buffersrc_add_frame_flags(AVFilterContext *ctx, AVFrame *frame, int flags)
+{
+    int ret;
+
+    ff_filter_graph_api_enter(ctx->graph, ctx);
+    ret = add_frame(ctx, frame, flags);
+    ff_filter_graph_api_leave(ctx->graph, ctx);
+    return ret;
+}
+
 int av_buffersrc_close(AVFilterContext *ctx, int64_t pts, unsigned flags)
 {
     BufferSourceContext *s = ctx->priv;
+    int ret = 0;
 
+    ff_filter_graph_api_enter(ctx->graph, ctx);
     s->eof = 1;
     ff_avfilter_link_set_in_status(ctx->outputs[0], AVERROR_EOF, pts);
-    return (flags & AV_BUFFERSRC_FLAG_PUSH) ? push_frame(ctx->graph) : 0;
+    if (flags & AV_BUFFERSRC_FLAG_PUSH)
+        ret = push_frame(ctx->graph, -1);
+    ff_filter_graph_api_leave(ctx->graph, ctx);
+    return ret;
 }
 
 static av_cold int init_video(AVFilterContext *ctx)
 {
     BufferSourceContext *c = ctx->priv;
 
+    c->ts = AV_NOPTS_VALUE;
+
     if (c->pix_fmt == AV_PIX_FMT_NONE || !c->w || !c->h ||
         av_q2d(c->time_base) <= 0) {
         av_log(ctx, AV_LOG_ERROR, "Invalid parameters provided.\n");
@@ -310,7 +426,12 @@ static av_cold int init_video(AVFilterContext *ctx)
 
 unsigned av_buffersrc_get_nb_failed_requests(AVFilterContext *buffer_src)
 {
-    return ((BufferSourceContext *)buffer_src->priv)->nb_failed_requests;
+    unsigned ret;
+
+    ff_filter_graph_api_enter(buffer_src->graph, buffer_src);
+    ret = ((BufferSourceContext *)buffer_src->priv)->nb_failed_requests;
+    ff_filter_graph_api_leave(buffer_src->graph, buffer_src);
+    return ret;
 }
 
 #define OFFSET(x) offsetof(BufferSourceContext, x)
@@ -351,6 +472,8 @@ static const AVOption sbuffer_options[] = {
     { "subtitle_type", NULL, OFFSET(subtitle_type),        AV_OPT_TYPE_INT,      { .i64 = 0 }, 0, INT_MAX, S },
     { "width",         NULL, OFFSET(w),                    AV_OPT_TYPE_INT,      { .i64 = 0 }, 0, INT_MAX, V },
     { "height",        NULL, OFFSET(h),                    AV_OPT_TYPE_INT,      { .i64 = 0 }, 0, INT_MAX, V },
+    { "heartbeat",     "send empty frames when lagging behind the other inputs", OFFSET(heartbeat), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, S },
+    { "heartbeat_lag", "maximum lag behind the other inputs", OFFSET(heartbeat_lag), AV_OPT_TYPE_DURATION, { .i64 = 5000000 }, 0, INT64_MAX, S },
     { NULL },
 };
 
@@ -362,6 +485,8 @@ static av_cold int init_audio(AVFilterContext *ctx)
     char buf[128];
     int ret = 0;
 
+    s->ts = AV_NOPTS_VALUE;
+
     if (s->sample_fmt == AV_SAMPLE_FMT_NONE) {
         av_log(ctx, AV_LOG_ERROR, "Sample format was not set or was invalid\n");
         return AVERROR(EINVAL);
@@ -428,6 +553,21 @@ static av_cold int init_subtitle(AVFilterContext *ctx)
 {
     BufferSourceContext *c = ctx->priv;
 
+    c->ts        = AV_NOPTS_VALUE;
+    c->last_pts  = AV_NOPTS_VALUE;
+    c->inputs_ts = AV_NOPTS_VALUE;
+    if (c->heartbeat && ctx->graph) {
+        AVFilterGraphInternal *gi = ctx->graph->internal;
+        AVFilterContext **sources;
+
+        sources = av_realloc_array(gi->heartbeat_sources, gi->nb_heartbeat_sources + 1,
+                                   sizeof(*sources));
+        if (!sources)
+            return AVERROR(ENOMEM);
+        sources[gi->nb_heartbeat_sources++] = ctx;
+        gi->heartbeat_sources = sources;
+    }
+
     if (c->subtitle_type == AV_SUBTITLE_FMT_BITMAP)
         av_log(ctx, AV_LOG_VERBOSE, "graphical subtitles - w:%d h:%d tb:%d/%d\n",
                c->w, c->h, c->time_base.num, c->time_base.den);
@@ -527,6 +667,12 @@ static int request_frame(AVFilterLink *link)
 
     if (c->eof)
         return AVERROR_EOF;
+    if (c->heartbeat) {
+        int64_t last_pts = c->last_pts;
+        int ret = send_heartbeat(link->src);
+        if (ret < 0 || c->last_pts != last_pts)
+            return ret;
+    }
     c->nb_failed_requests++;
     return AVERROR(EAGAIN);
 }
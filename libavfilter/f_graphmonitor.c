@@ -78,6 +78,8 @@ enum {
     MODE_TIME_DELTA = 1 << 13,
     MODE_FC_DELTA = 1 << 14,
     MODE_SC_DELTA = 1 << 15,
+    MODE_QUEUE_BYTES = 1 << 16,
+    MODE_PEAK_QUEUE_BYTES = 1 << 17,
 };
 
 #define OFFSET(x) offsetof(GraphMonitorContext, x)
@@ -110,6 +112,8 @@ static const AVOption graphmonitor_options[] = {
         { "sample_count_in",  NULL, 0, AV_OPT_TYPE_CONST, {.i64=MODE_SCOUT},   0, 0, VF, "flags" },
         { "sample_count_out", NULL, 0, AV_OPT_TYPE_CONST, {.i64=MODE_SCIN},    0, 0, VF, "flags" },
         { "sample_count_delta",NULL,0, AV_OPT_TYPE_CONST, {.i64=MODE_SC_DELTA},0, 0, VF, "flags" },
+        { "queue_bytes",      NULL, 0, AV_OPT_TYPE_CONST, {.i64=MODE_QUEUE_BYTES},0,0,VF, "flags" },
+        { "peak_queue_bytes", NULL, 0, AV_OPT_TYPE_CONST, {.i64=MODE_PEAK_QUEUE_BYTES},0,0,VF,"flags" },
     { "rate", "set video rate", OFFSET(frame_rate), AV_OPT_TYPE_VIDEO_RATE, {.str = "25"}, 0, INT_MAX, VF },
     { "r",    "set video rate", OFFSET(frame_rate), AV_OPT_TYPE_VIDEO_RATE, {.str = "25"}, 0, INT_MAX, VF },
     { NULL }
@@ -255,6 +259,21 @@ static int draw_items(AVFilterContext *ctx, AVFrame *out,
         drawtext(out, xpos, ypos, buffer, frames > 0 ? frames >= 10 ? frames >= 50 ? s->red : s->yellow : s->green : s->white);
         xpos += strlen(buffer) * 8;
     }
+    if (s->flags & (MODE_QUEUE_BYTES | MODE_PEAK_QUEUE_BYTES)) {
+        AVFilterBufferStats stats;
+
+        ff_filter_get_buffer_stats(ctx, l, &stats);
+        if (s->flags & MODE_QUEUE_BYTES) {
+            snprintf(buffer, sizeof(buffer)-1, " | bytes: %"PRIu64, stats.queued_bytes);
+            drawtext(out, xpos, ypos, buffer, stats.deferred_requests ? s->red : s->white);
+            xpos += strlen(buffer) * 8;
+        }
+        if (s->flags & MODE_PEAK_QUEUE_BYTES) {
+            snprintf(buffer, sizeof(buffer)-1, " | peak: %"PRIu64, stats.peak_queued_bytes);
+            drawtext(out, xpos, ypos, buffer, s->white);
+            xpos += strlen(buffer) * 8;
+        }
+    }
     if (s->flags & MODE_FCIN) {
         snprintf(buffer, sizeof(buffer)-1, " | in: %"PRId64, l->frame_count_in);
         drawtext(out, xpos, ypos, buffer, s->white);
@@ -340,6 +359,18 @@ static int create_frame(AVFilterContext *ctx, int64_t pts)
 
     s->cache_index = 0;
 
+    if (s->flags & (MODE_QUEUE_BYTES | MODE_PEAK_QUEUE_BYTES)) {
+        AVFilterBufferStats stats;
+        char buffer[1024] = { 0 };
+
+        ff_filter_get_buffer_stats(ctx, NULL, &stats);
+        snprintf(buffer, sizeof(buffer)-1, "graph | frames: %"PRIu64" | bytes: %"PRIu64
+                 " | peak: %"PRIu64" | deferred: %u", stats.queued_frames,
+                 stats.queued_bytes, stats.peak_queued_bytes, stats.deferred_requests);
+        drawtext(out, 0, ypos, buffer, stats.deferred_requests ? s->red : s->white);
+        ypos += 15;
+    }
+
     for (int i = 0; i < ctx->graph->nb_filters; i++) {
         AVFilterContext *filter = ctx->graph->filters[i];
         char buffer[1024] = { 0 };
@@ -92,10 +92,45 @@ do {                                                                       \
     MERGE_REF(a, b, fmts, type, return AVERROR(ENOMEM););                  \
 } while (0)
 
+/**
+ * Set of pixel, sample or subtitle formats, used to intersect formats lists
+ * in linear instead of quadratic time.
+ */
+#define FORMAT_SET_SIZE FFMAX3((int)AV_PIX_FMT_NB, (int)AV_SAMPLE_FMT_NB, \
+                               (int)AV_SUBTITLE_FMT_NB)
+
+typedef struct FormatSet {
+    uint64_t bits[(FORMAT_SET_SIZE + 63) / 64];
+} FormatSet;
+
+static int format_set_has(const FormatSet *set, int fmt)
+{
+    return (unsigned)fmt < FORMAT_SET_SIZE &&
+           (set->bits[fmt >> 6] >> (fmt & 63) & 1);
+}
+
+/**
+ * Fill set with the formats of fmts.
+ *
+ * @return 0 if fmts contains a value which does not fit in a FormatSet
+ */
+static int format_set_fill(FormatSet *set, const AVFilterFormats *fmts)
+{
+    memset(set, 0, sizeof(*set));
+    for (unsigned i = 0; i < fmts->nb_formats; i++) {
+        unsigned fmt = fmts->formats[i];
+        if (fmt >= FORMAT_SET_SIZE)
+            return 0;
+        set->bits[fmt >> 6] |= 1ULL << (fmt & 63);
+    }
+    return 1;
+}
+
 static int merge_formats_internal(AVFilterFormats *a, AVFilterFormats *b,
                                   enum AVMediaType type, int check)
 {
-    int i, j;
+    FormatSet bset;
+    unsigned i, k = 0;
     int alpha1=0, alpha2=0;
     int chroma1=0, chroma2=0;
 
@@ -104,6 +139,10 @@ static int merge_formats_internal(AVFilterFormats *a, AVFilterFormats *b,
     if (a == b)
         return 1;
 
+    /* Only lists of valid formats can be merged. */
+    if (!format_set_fill(&bset, b))
+        return 0;
+
     /* Do not lose chroma or alpha in merging.
        It happens if both lists have formats with chroma (resp. alpha), but
        the only formats in common do not have it (e.g. YUV+gray vs.
@@ -111,25 +150,47 @@ static int merge_formats_internal(AVFilterFormats *a, AVFilterFormats *b,
        possibly causing a lossy conversion elsewhere in the graph.
        To avoid that, pretend that there are no common formats to force the
        insertion of a conversion filter. */
-    if (type == AVMEDIA_TYPE_VIDEO)
+    if (type == AVMEDIA_TYPE_VIDEO) {
+        int alpha_a = 0, alpha_b = 0, chroma_a = 0, chroma_b = 0;
+
+        for (i = 0; i < b->nb_formats; i++) {
+            const AVPixFmtDescriptor *const bdesc = av_pix_fmt_desc_get(b->formats[i]);
+            alpha_b  |= bdesc->flags & AV_PIX_FMT_FLAG_ALPHA;
+            chroma_b |= bdesc->nb_components > 1;
+        }
         for (i = 0; i < a->nb_formats; i++) {
             const AVPixFmtDescriptor *const adesc = av_pix_fmt_desc_get(a->formats[i]);
-            for (j = 0; j < b->nb_formats; j++) {
-                const AVPixFmtDescriptor *bdesc = av_pix_fmt_desc_get(b->formats[j]);
-                alpha2 |= adesc->flags & bdesc->flags & AV_PIX_FMT_FLAG_ALPHA;
-                chroma2|= adesc->nb_components > 1 && bdesc->nb_components > 1;
-                if (a->formats[i] == b->formats[j]) {
-                    alpha1 |= adesc->flags & AV_PIX_FMT_FLAG_ALPHA;
-                    chroma1|= adesc->nb_components > 1;
-                }
+            alpha_a  |= adesc->flags & AV_PIX_FMT_FLAG_ALPHA;
+            chroma_a |= adesc->nb_components > 1;
+            if (format_set_has(&bset, a->formats[i])) {
+                alpha1 |= adesc->flags & AV_PIX_FMT_FLAG_ALPHA;
+                chroma1|= adesc->nb_components > 1;
             }
         }
+        alpha2  = alpha_a  & alpha_b;
+        chroma2 = chroma_a & chroma_b;
+    }
 
     // If chroma or alpha can be lost through merging then do not merge
     if (alpha2 > alpha1 || chroma2 > chroma1)
         return 0;
 
-    MERGE_FORMATS(a, b, formats, nb_formats, AVFilterFormats, check, 0);
+    /* Keep the formats of a which are also in b, in the order of a. */
+    for (i = 0; i < a->nb_formats; i++) {
+        if (!format_set_has(&bset, a->formats[i]))
+            continue;
+        if (check)
+            return 1;
+        a->formats[k++] = a->formats[i];
+    }
+    /* Check that there was at least one common format.
+     * Notice that both a and b are unchanged if not. */
+    if (!k)
+        return 0;
+    av_assert2(!check);
+    a->nb_formats = k;
+
+    MERGE_REF(a, b, formats, AVFilterFormats, return AVERROR(ENOMEM););
 
     return 1;
 }
@@ -894,6 +955,7 @@ FF_ENABLE_DEPRECATION_WARNINGS
 
 static int check_list(void *log, const char *name, const AVFilterFormats *fmts)
 {
+    FormatSet set = { { 0 } };
     unsigned i, j;
 
     if (!fmts)
@@ -902,6 +964,19 @@ static int check_list(void *log, const char *name, const AVFilterFormats *fmts)
         av_log(log, AV_LOG_ERROR, "Empty %s list\n", name);
         return AVERROR(EINVAL);
     }
+    /* Pixel and sample formats fit in a FormatSet, sample rates do not. */
+    for (i = 0; i < fmts->nb_formats; i++) {
+        unsigned fmt = fmts->formats[i];
+        if (fmt >= FORMAT_SET_SIZE)
+            break;
+        if (format_set_has(&set, fmt)) {
+            av_log(log, AV_LOG_ERROR, "Duplicated %s\n", name);
+            return AVERROR(EINVAL);
+        }
+        set.bits[fmt >> 6] |= 1ULL << (fmt & 63);
+    }
+    if (i == fmts->nb_formats)
+        return 0;
     for (i = 0; i < fmts->nb_formats; i++) {
         for (j = i + 1; j < fmts->nb_formats; j++) {
             if (fmts->formats[i] == fmts->formats[j]) {
@@ -27,6 +27,12 @@
 #include "libavutil/mem.h"
 #include "libavutil/pixfmt.h"
 
+/* Subtitle bitmaps are pooled in buckets of power-of-two sizes between
+ * these two, larger ones are allocated directly. */
+#define SUB_BUCKET_MIN_BITS 12
+#define SUB_BUCKET_MAX_BITS 24
+#define SUB_BUCKETS (SUB_BUCKET_MAX_BITS - SUB_BUCKET_MIN_BITS + 1)
+
 struct FFFramePool {
 
     enum AVMediaType type;
@@ -40,6 +46,10 @@ struct FFFramePool {
     int channels;
     int nb_samples;
 
+    /* subtitle */
+    AVBufferRef* (*alloc)(size_t size);
+    AVBufferPool *bitmap_pools[SUB_BUCKETS];
+
     /* common */
     int format;
     int align;
@@ -149,6 +159,36 @@ fail:
     return NULL;
 }
 
+FFFramePool *ff_frame_pool_subtitle_init(AVBufferRef* (*alloc)(size_t size))
+{
+    FFFramePool *pool;
+
+    pool = av_mallocz(sizeof(FFFramePool));
+    if (!pool)
+        return NULL;
+
+    pool->type  = AVMEDIA_TYPE_SUBTITLE;
+    pool->alloc = alloc ? alloc : av_buffer_alloc;
+
+    /* Subtitle frames only carry a 1-byte buffer marking them as
+     * ref-counted, see av_frame_get_buffer2(). */
+    pool->pools[0] = av_buffer_pool_init(1, alloc);
+    if (!pool->pools[0])
+        goto fail;
+
+    for (int i = 0; i < SUB_BUCKETS; i++) {
+        pool->bitmap_pools[i] = av_buffer_pool_init(1 << (SUB_BUCKET_MIN_BITS + i), alloc);
+        if (!pool->bitmap_pools[i])
+            goto fail;
+    }
+
+    return pool;
+
+fail:
+    ff_frame_pool_uninit(&pool);
+    return NULL;
+}
+
 int ff_frame_pool_get_video_config(FFFramePool *pool,
                                    int *width,
                                    int *height,
@@ -187,6 +227,25 @@ int ff_frame_pool_get_audio_config(FFFramePool *pool,
     return 0;
 }
 
+AVBufferRef *ff_frame_pool_get_subtitle_bitmap(FFFramePool *pool, size_t size)
+{
+    AVBufferRef *buf;
+    int bucket = 0;
+
+    av_assert0(pool->type == AVMEDIA_TYPE_SUBTITLE);
+
+    if (size > 1 << SUB_BUCKET_MAX_BITS)
+        return pool->alloc(size);
+
+    while (size > 1 << (SUB_BUCKET_MIN_BITS + bucket))
+        bucket++;
+
+    buf = av_buffer_pool_get(pool->bitmap_pools[bucket]);
+    if (buf)
+        buf->size = size;
+    return buf;
+}
+
 AVFrame *ff_frame_pool_get(FFFramePool *pool)
 {
     int i;
@@ -269,6 +328,13 @@ FF_ENABLE_DEPRECATION_WARNINGS
             frame->extended_data[i + AV_NUM_DATA_POINTERS] = frame->extended_buf[i]->data;
         }
 
+        break;
+    case AVMEDIA_TYPE_SUBTITLE:
+        frame->type = AVMEDIA_TYPE_SUBTITLE;
+        frame->buf[0] = av_buffer_pool_get(pool->pools[0]);
+        if (!frame->buf[0])
+            goto fail;
+        frame->extended_data = frame->data;
         break;
     default:
         av_assert0(0);
@@ -290,6 +356,8 @@ void ff_frame_pool_uninit(FFFramePool **pool)
     for (i = 0; i < 4; i++) {
         av_buffer_pool_uninit(&(*pool)->pools[i]);
     }
+    for (i = 0; i < SUB_BUCKETS; i++)
+        av_buffer_pool_uninit(&(*pool)->bitmap_pools[i]);
 
     av_freep(pool);
 }
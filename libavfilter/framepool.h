@@ -68,6 +68,18 @@ FFFramePool *ff_frame_pool_audio_init(AVBufferRef* (*alloc)(size_t size),
                                       enum AVSampleFormat format,
                                       int align);
 
+/**
+ * Allocate and initialize a subtitle frame pool. Besides the frames, it
+ * provides bitmap buffers for subtitle areas, see
+ * ff_frame_pool_get_subtitle_bitmap().
+ *
+ * @param alloc a function that will be used to allocate new buffers when
+ * the pool is empty. May be NULL, then the default allocator will be used
+ * (av_buffer_alloc()).
+ * @return newly created subtitle frame pool on success, NULL on error.
+ */
+FFFramePool *ff_frame_pool_subtitle_init(AVBufferRef* (*alloc)(size_t size));
+
 /**
  * Deallocate the frame pool. It is safe to call this function while
  * some of the allocated frame are still in use.
@@ -115,5 +127,15 @@ int ff_frame_pool_get_audio_config(FFFramePool *pool,
  */
 AVFrame *ff_frame_pool_get(FFFramePool *pool);
 
+/**
+ * Get a buffer of at least size bytes for a subtitle area bitmap from a
+ * subtitle frame pool. The buffers are kept in buckets of power-of-two
+ * sizes, so that bitmaps of varying dimensions are recycled too. The
+ * contents are not initialized. This function may be called simultaneously
+ * from multiple threads.
+ *
+ * @return a new buffer of the given size on success, NULL on error.
+ */
+AVBufferRef *ff_frame_pool_get_subtitle_bitmap(FFFramePool *pool, size_t size);
 
 #endif /* AVFILTER_FRAMEPOOL_H */
@@ -19,6 +19,8 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include <string.h>
+
 #include "libavutil/avassert.h"
 #include "framequeue.h"
 
@@ -29,6 +31,28 @@ static inline FFFrameBucket *bucket(FFFrameQueue *fq, size_t idx)
 
 void ff_framequeue_global_init(FFFrameQueueGlobal *fqg)
 {
+    fqg->queued_bytes      = 0;
+    fqg->peak_queued_bytes = 0;
+}
+
+static size_t frame_bytes(const AVFrame *frame)
+{
+    size_t bytes = 0;
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(frame->buf) && frame->buf[i]; i++)
+        bytes += frame->buf[i]->size;
+    for (int i = 0; i < frame->nb_extended_buf; i++)
+        bytes += frame->extended_buf[i]->size;
+    for (unsigned i = 0; i < frame->num_subtitle_areas; i++) {
+        const AVSubtitleArea *area = frame->subtitle_areas[i];
+        for (int j = 0; j < FF_ARRAY_ELEMS(area->buf) && area->buf[j]; j++)
+            bytes += area->buf[j]->size;
+        if (area->text)
+            bytes += strlen(area->text);
+        if (area->ass)
+            bytes += strlen(area->ass);
+    }
+    return bytes;
 }
 
 static void check_consistency(FFFrameQueue *fq)
@@ -48,6 +72,7 @@ void ff_framequeue_init(FFFrameQueue *fq, FFFrameQueueGlobal *fqg)
 {
     fq->queue = &fq->first_bucket;
     fq->allocated = 1;
+    fq->global = fqg;
 }
 
 void ff_framequeue_free(FFFrameQueue *fq)
@@ -88,9 +113,17 @@ int ff_framequeue_add(FFFrameQueue *fq, AVFrame *frame)
     }
     b = bucket(fq, fq->queued);
     b->frame = frame;
+    b->bytes = frame_bytes(frame);
     fq->queued++;
     fq->total_frames_head++;
     fq->total_samples_head += frame->nb_samples;
+    fq->queued_bytes += b->bytes;
+    fq->peak_queued_bytes = FFMAX(fq->peak_queued_bytes, fq->queued_bytes);
+    if (fq->global) {
+        FFFrameQueueGlobal *fqg = fq->global;
+        fqg->queued_bytes += b->bytes;
+        fqg->peak_queued_bytes = FFMAX(fqg->peak_queued_bytes, fqg->queued_bytes);
+    }
     check_consistency(fq);
     return 0;
 }
@@ -108,6 +141,9 @@ AVFrame *ff_framequeue_take(FFFrameQueue *fq)
     fq->total_frames_tail++;
     fq->total_samples_tail += b->frame->nb_samples;
     fq->samples_skipped = 0;
+    fq->queued_bytes -= b->bytes;
+    if (fq->global)
+        fq->global->queued_bytes -= b->bytes;
     check_consistency(fq);
     return b->frame;
 }
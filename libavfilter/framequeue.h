@@ -33,6 +33,7 @@
 
 typedef struct FFFrameBucket {
     AVFrame *frame;
+    size_t bytes;               ///< size of the frame when it was added
 } FFFrameBucket;
 
 /**
@@ -41,10 +42,19 @@ typedef struct FFFrameBucket {
  * This structure is intended to allow implementing global control of the
  * frame queues, including memory consumption caps.
  *
- * It is currently empty.
+ * The size of a frame is the size of the buffers it references, so frames
+ * sharing buffers, e.g. after a split filter, are counted once per queue.
  */
 typedef struct FFFrameQueueGlobal {
-    char dummy; /* C does not allow empty structs */
+    /**
+     * Total size of the frames in all the attached queues.
+     */
+    uint64_t queued_bytes;
+
+    /**
+     * Highest value queued_bytes had.
+     */
+    uint64_t peak_queued_bytes;
 } FFFrameQueueGlobal;
 
 /**
@@ -105,6 +115,21 @@ typedef struct FFFrameQueue {
      */
     int samples_skipped;
 
+    /**
+     * Global structure the queue is attached to, may be NULL.
+     */
+    FFFrameQueueGlobal *global;
+
+    /**
+     * Total size of the queued frames.
+     */
+    uint64_t queued_bytes;
+
+    /**
+     * Highest value queued_bytes had.
+     */
+    uint64_t peak_queued_bytes;
+
 } FFFrameQueue;
 
 /**
@@ -114,6 +139,7 @@ void ff_framequeue_global_init(FFFrameQueueGlobal *fqg);
 
 /**
  * Init a frame queue and attach it to a global structure.
+ * fqg may be NULL, and must otherwise outlive the queue.
  */
 void ff_framequeue_init(FFFrameQueue *fq, FFFrameQueueGlobal *fqg);
 
@@ -156,6 +182,14 @@ static inline uint64_t ff_framequeue_queued_samples(const FFFrameQueue *fq)
     return fq->total_samples_head - fq->total_samples_tail;
 }
 
+/**
+ * Get the total size of the queued frames.
+ */
+static inline uint64_t ff_framequeue_queued_bytes(const FFFrameQueue *fq)
+{
+    return fq->queued_bytes;
+}
+
 /**
  * Update the statistics after a frame accessed using ff_framequeue_peek()
  * was modified.
@@ -25,6 +25,7 @@
  */
 
 #include "libavutil/internal.h"
+#include "libavutil/thread.h"
 #include "avfilter.h"
 #include "formats.h"
 #include "framequeue.h"
@@ -130,16 +131,71 @@ struct AVFilterPad {
     int (*config_props)(AVFilterLink *link);
 };
 
+#define FF_GRAPH_FRAME_CACHE_SIZE 16
+
 struct AVFilterGraphInternal {
     void *thread;
     avfilter_execute_func *thread_execute;
     FFFrameQueueGlobal frame_queues;
+    unsigned nb_deferred_requests; ///< links with frame_wanted_deferred set
+    int queued_bytes_warned;
+    /**
+     * Subtitle buffer sources sending heartbeats, which get the timestamps
+     * of the frames added to the other buffer sources.
+     */
+    AVFilterContext **heartbeat_sources;
+    unsigned nb_heartbeat_sources;
+
+    /**
+     * Empty frames released by the sinks, reused by the sources, protected
+     * by pool_lock.
+     */
+    AVFrame *frame_cache[FF_GRAPH_FRAME_CACHE_SIZE];
+    int nb_cached_frames;
+
+    /**
+     * Pipeline threading, set while worker threads activate the filters.
+     * The link and scheduling state of all filters is then protected by
+     * lock.
+     */
+    void *pipeline;
+    AVMutex lock;
+    AVMutex pool_lock;    ///< protects frame_pool of the links
+    unsigned nb_running;  ///< number of filters being activated
+    unsigned api_entered; ///< nesting level of public API calls
+    int pipeline_error;   ///< first error returned by a worker
 };
 
 struct AVFilterInternal {
     avfilter_execute_func *execute;
+
+    /* Processing statistics, protected by the graph lock. */
+    uint64_t activations;
+    int64_t wall_time;
+    int64_t cpu_time;
+
+    /* Pipeline threading state, protected by the graph lock. */
+    int running;   ///< the filter is being activated
+    int claimed;   ///< the filter is used through the public API
 };
 
+/**
+ * With pipeline threading, the frame pool of a link may be used from both
+ * of its ends at the same time, e.g. by the source filter allocating its
+ * output and by the destination filter merging audio samples.
+ */
+static inline void ff_link_pool_lock(AVFilterLink *link)
+{
+    if (link->graph && link->graph->internal->pipeline)
+        ff_mutex_lock(&link->graph->internal->pool_lock);
+}
+
+static inline void ff_link_pool_unlock(AVFilterLink *link)
+{
+    if (link->graph && link->graph->internal->pipeline)
+        ff_mutex_unlock(&link->graph->internal->pool_lock);
+}
+
 static av_always_inline int ff_filter_execute(AVFilterContext *ctx, avfilter_action_func *func,
                                               void *arg, int *ret, int nb_jobs)
 {
@@ -387,6 +443,52 @@ void ff_filter_graph_remove_filter(AVFilterGraph *graph, AVFilterContext *filter
  */
 int ff_filter_graph_run_once(AVFilterGraph *graph);
 
+/**
+ * Enter the graph from a public API function. With pipeline threading,
+ * this takes the graph lock and, if filter is not NULL, waits until the
+ * filter is not being activated and keeps the worker threads from
+ * activating it until the matching ff_filter_graph_api_leave(). Calls may
+ * be nested. Does nothing without pipeline threading.
+ */
+void ff_filter_graph_api_enter(AVFilterGraph *graph, AVFilterContext *filter);
+
+void ff_filter_graph_api_leave(AVFilterGraph *graph, AVFilterContext *filter);
+
+/**
+ * @return the number of frames queued on the inputs of all filters of graph
+ *         except the sinks
+ */
+size_t ff_filter_graph_queued_frames(AVFilterGraph *graph);
+
+/**
+ * Allocate an AVFrame, reusing a frame released with
+ * ff_filter_graph_frame_free() if possible.
+ */
+AVFrame *ff_filter_graph_frame_alloc(AVFilterGraph *graph);
+
+/**
+ * Free a frame, keeping the empty AVFrame for reuse by
+ * ff_filter_graph_frame_alloc(). This lets the frames circulate between the
+ * sinks and the sources of a graph without allocations.
+ */
+void ff_filter_graph_frame_free(AVFilterGraph *graph, AVFrame **frame);
+
+/**
+ * Issue the input requests held back because the graph exceeds its
+ * max_queued_bytes limit, if the graph cannot make progress otherwise, i.e.
+ * no filter is ready and no source is waiting for a frame.
+ *
+ * @return 1 if requests were issued, 0 otherwise
+ */
+int ff_filter_graph_force_deferred_requests(AVFilterGraph *graph);
+
+/**
+ * Get the buffer statistics of link, or of the whole graph of filter if
+ * link is NULL, from a filter callback.
+ */
+void ff_filter_get_buffer_stats(AVFilterContext *filter, AVFilterLink *link,
+                                AVFilterBufferStats *stats);
+
 /**
  * Get number of threads for current filter instance.
  * This number is always same or less than graph->nb_threads.
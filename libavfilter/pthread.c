@@ -23,10 +23,13 @@
 
 #include <stddef.h>
 
+#include "libavutil/cpu.h"
 #include "libavutil/error.h"
+#include "libavutil/log.h"
 #include "libavutil/macros.h"
 #include "libavutil/mem.h"
 #include "libavutil/slicethread.h"
+#include "libavutil/thread.h"
 
 #include "avfilter.h"
 #include "internal.h"
@@ -35,6 +38,7 @@
 typedef struct ThreadContext {
     AVFilterGraph *graph;
     AVSliceThread *thread;
+    AVMutex lock;
     avfilter_action_func *func;
 
     /* per-execute parameters */
@@ -54,6 +58,7 @@ static void worker_func(void *priv, int jobnr, int threadnr, int nb_jobs, int nb
 static void slice_thread_uninit(ThreadContext *c)
 {
     avpriv_slicethread_free(&c->thread);
+    ff_mutex_destroy(&c->lock);
 }
 
 static int thread_execute(AVFilterContext *ctx, avfilter_action_func *func,
@@ -63,18 +68,24 @@ static int thread_execute(AVFilterContext *ctx, avfilter_action_func *func,
 
     if (nb_jobs <= 0)
         return 0;
+    /* Filters activated by different pipeline threads share the workers. */
+    ff_mutex_lock(&c->lock);
     c->ctx         = ctx;
     c->arg         = arg;
     c->func        = func;
     c->rets        = ret;
 
     avpriv_slicethread_execute(c->thread, nb_jobs, 0);
+    ff_mutex_unlock(&c->lock);
     return 0;
 }
 
-static int thread_init_internal(ThreadContext *c, int nb_threads)
+static int thread_init_internal(ThreadContext *c, int nb_threads, int shared)
 {
-    nb_threads = avpriv_slicethread_create(&c->thread, c, worker_func, NULL, nb_threads);
+    if (shared)
+        nb_threads = avpriv_slicethread_create_shared(&c->thread, c, worker_func, nb_threads);
+    else
+        nb_threads = avpriv_slicethread_create(&c->thread, c, worker_func, NULL, nb_threads);
     if (nb_threads <= 1)
         avpriv_slicethread_free(&c->thread);
     return FFMAX(nb_threads, 1);
@@ -93,7 +104,8 @@ int ff_graph_thread_init(AVFilterGraph *graph)
     if (!graph->internal->thread)
         return AVERROR(ENOMEM);
 
-    ret = thread_init_internal(graph->internal->thread, graph->nb_threads);
+    ret = thread_init_internal(graph->internal->thread, graph->nb_threads,
+                               graph->shared_threads);
     if (ret <= 1) {
         av_freep(&graph->internal->thread);
         graph->thread_type = 0;
@@ -102,6 +114,13 @@ int ff_graph_thread_init(AVFilterGraph *graph)
     }
     graph->nb_threads = ret;
 
+    ret = ff_mutex_init(&((ThreadContext *)graph->internal->thread)->lock, NULL);
+    if (ret) {
+        slice_thread_uninit(graph->internal->thread);
+        av_freep(&graph->internal->thread);
+        return AVERROR(ret);
+    }
+
     graph->internal->thread_execute = thread_execute;
 
     return 0;
@@ -113,3 +132,213 @@ void ff_graph_thread_free(AVFilterGraph *graph)
         slice_thread_uninit(graph->internal->thread);
     av_freep(&graph->internal->thread);
 }
+
+typedef struct PipelineContext {
+    AVFilterGraph *graph;
+    pthread_t *workers;
+    int nb_workers;
+    /* for each worker and last for the caller thread, set while it runs a
+       filter callback without the graph lock; only used by that thread */
+    uint8_t *unlocked;
+    int quit;
+    /* broadcast whenever a filter becomes ready, an activation ends or the
+       caller releases a filter */
+    pthread_cond_t cond;
+} PipelineContext;
+
+/**
+ * Find the filter to activate next, with the same priorities as the serial
+ * ff_filter_graph_run_once(). The caller thread only activates the filters
+ * it uses through the public API, all the others are left to the workers.
+ */
+static AVFilterContext *pick_filter(AVFilterGraph *graph, int claimed)
+{
+    AVFilterContext *best = NULL;
+
+    for (unsigned i = 0; i < graph->nb_filters; i++) {
+        AVFilterContext *filter = graph->filters[i];
+
+        if (filter->ready && !filter->internal->running &&
+            !filter->internal->claimed == !claimed &&
+            (!best || filter->ready > best->ready))
+            best = filter;
+    }
+    return best;
+}
+
+static int activate_filter(AVFilterGraph *graph, AVFilterContext *filter)
+{
+    AVFilterGraphInternal *gi = graph->internal;
+    PipelineContext *p = gi->pipeline;
+    int ret;
+
+    filter->internal->running = 1;
+    gi->nb_running++;
+    ret = ff_filter_activate(filter);
+    gi->nb_running--;
+    filter->internal->running = 0;
+    pthread_cond_broadcast(&p->cond);
+    return ret;
+}
+
+static void *pipeline_worker(void *arg)
+{
+    PipelineContext *p = arg;
+    AVFilterGraph *graph = p->graph;
+    AVFilterGraphInternal *gi = graph->internal;
+
+    ff_mutex_lock(&gi->lock);
+    while (!p->quit) {
+        AVFilterContext *filter = pick_filter(graph, 0);
+        int ret;
+
+        if (!filter) {
+            pthread_cond_wait(&p->cond, &gi->lock);
+            continue;
+        }
+        ret = activate_filter(graph, filter);
+        /* EAGAIN only means that a source has no frame for a request */
+        if (ret < 0 && ret != AVERROR(EAGAIN) && !gi->pipeline_error) {
+            av_log(filter, AV_LOG_DEBUG, "Activation failed: %s\n", av_err2str(ret));
+            gi->pipeline_error = ret;
+        }
+    }
+    ff_mutex_unlock(&gi->lock);
+    return NULL;
+}
+
+int ff_graph_pipeline_run_once(AVFilterGraph *graph)
+{
+    AVFilterGraphInternal *gi = graph->internal;
+    PipelineContext *p = gi->pipeline;
+    AVFilterContext *filter;
+
+    if (gi->pipeline_error)
+        return gi->pipeline_error;
+    if ((filter = pick_filter(graph, 1)))
+        return activate_filter(graph, filter);
+    if (!gi->nb_running && !pick_filter(graph, 0))
+        return AVERROR(EAGAIN);
+    pthread_cond_wait(&p->cond, &gi->lock);
+    return 0;
+}
+
+int ff_graph_pipeline_start(AVFilterGraph *graph)
+{
+    AVFilterGraphInternal *gi = graph->internal;
+    PipelineContext *p;
+    int nb_workers, ret;
+
+    if (gi->pipeline || !(graph->thread_type & AVFILTER_THREAD_PIPELINE))
+        return 0;
+    nb_workers = FFMIN(graph->nb_threads ? graph->nb_threads : av_cpu_count(),
+                       graph->nb_filters);
+    if (nb_workers <= 1)
+        return 0;
+
+    p = av_mallocz(sizeof(*p));
+    if (!p)
+        return AVERROR(ENOMEM);
+    p->workers  = av_calloc(nb_workers, sizeof(*p->workers));
+    p->unlocked = av_calloc(nb_workers + 1, sizeof(*p->unlocked));
+    if (!p->workers || !p->unlocked) {
+        av_free(p->workers);
+        av_free(p->unlocked);
+        av_free(p);
+        return AVERROR(ENOMEM);
+    }
+    ret = pthread_cond_init(&p->cond, NULL);
+    if (ret) {
+        av_free(p->workers);
+        av_free(p->unlocked);
+        av_free(p);
+        return AVERROR(ret);
+    }
+    p->graph    = graph;
+    gi->pipeline = p;
+
+    /* The workers wait for the lock, so they only look for their own
+       thread in the list once it is complete. */
+    ff_mutex_lock(&gi->lock);
+    for (; p->nb_workers < nb_workers; p->nb_workers++) {
+        ret = pthread_create(&p->workers[p->nb_workers], NULL, pipeline_worker, p);
+        if (ret) {
+            ff_mutex_unlock(&gi->lock);
+            ff_graph_pipeline_stop(graph);
+            return AVERROR(ret);
+        }
+    }
+    ff_mutex_unlock(&gi->lock);
+    av_log(graph, AV_LOG_VERBOSE, "Using %d pipeline threads.\n", nb_workers);
+
+    return 0;
+}
+
+void ff_graph_pipeline_stop(AVFilterGraph *graph)
+{
+    AVFilterGraphInternal *gi = graph->internal;
+    PipelineContext *p = gi->pipeline;
+
+    if (!p)
+        return;
+
+    ff_mutex_lock(&gi->lock);
+    p->quit = 1;
+    pthread_cond_broadcast(&p->cond);
+    ff_mutex_unlock(&gi->lock);
+    for (int i = 0; i < p->nb_workers; i++)
+        pthread_join(p->workers[i], NULL);
+
+    gi->pipeline = NULL;
+    pthread_cond_destroy(&p->cond);
+    av_freep(&p->workers);
+    av_freep(&p->unlocked);
+    av_free(p);
+}
+
+uint8_t *ff_graph_pipeline_unlocked(AVFilterGraph *graph)
+{
+    PipelineContext *p = graph->internal->pipeline;
+    pthread_t self = pthread_self();
+
+    for (int i = 0; i < p->nb_workers; i++)
+        if (pthread_equal(p->workers[i], self))
+            return &p->unlocked[i];
+    return &p->unlocked[p->nb_workers];
+}
+
+void ff_graph_pipeline_wake(AVFilterGraph *graph)
+{
+    PipelineContext *p = graph->internal->pipeline;
+
+    pthread_cond_broadcast(&p->cond);
+}
+
+void ff_filter_graph_api_enter(AVFilterGraph *graph, AVFilterContext *filter)
+{
+    AVFilterGraphInternal *gi = graph->internal;
+    PipelineContext *p = gi->pipeline;
+
+    if (!p)
+        return;
+    if (!gi->api_entered++)
+        ff_mutex_lock(&gi->lock);
+    if (filter) {
+        while (filter->internal->running)
+            pthread_cond_wait(&p->cond, &gi->lock);
+        filter->internal->claimed++;
+    }
+}
+
+void ff_filter_graph_api_leave(AVFilterGraph *graph, AVFilterContext *filter)
+{
+    AVFilterGraphInternal *gi = graph->internal;
+    PipelineContext *p = gi->pipeline;
+
+    if (!p)
+        return;
+    if (filter && !--filter->internal->claimed)
+        pthread_cond_broadcast(&p->cond);
+    if (!--gi->api_entered)
+        ff_mutex_unlock(&gi->lock);
+}
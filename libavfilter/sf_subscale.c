@@ -28,6 +28,7 @@
 #include "drawutils.h"
 #include "internal.h"
 #include "scale_eval.h"
+#include "subtitles.h"
 #include "libavutil/eval.h"
 #include "libavutil/opt.h"
 #include "libswscale/swscale.h"
@@ -526,19 +527,22 @@ static int scale_area(AVFilterLink *link, AVSubtitleArea *area, const int target
     const int dst_linesize[2] = { dstW, 0 };
     uint8_t* tmp[2] = { 0, 0 };
 
-    AVBufferRef *tmp_buffer = av_buffer_allocz(tmp_linesize[0] * dstH);
-    if (!tmp_buffer)
-        return AVERROR(ENOMEM);
+    AVBufferRef *tmp_buffer;
 
     if (!s->sws)
         return 0;
 
+    tmp_buffer = ff_get_subtitles_bitmap_buffer(ctx->outputs[0], tmp_linesize[0] * dstH);
+    if (!tmp_buffer)
+        return AVERROR(ENOMEM);
+
     tmp[0] = tmp_buffer->data;
 
     s->sws = sws_getCachedContext(s->sws, area->w, area->h, AV_PIX_FMT_PAL8,
         dstW, dstH, AV_PIX_FMT_RGB32, SWS_BICUBIC, NULL, NULL, NULL);
     if (!s->sws) {
         av_log(NULL, AV_LOG_FATAL, "Cannot initialize the conversion context. dstW=%d dstH=%d\n", dstW, dstH);
+        av_buffer_unref(&tmp_buffer);
         return AVERROR(EINVAL);
     }
 
@@ -550,7 +554,7 @@ static int scale_area(AVFilterLink *link, AVSubtitleArea *area, const int target
     }
 
     // Alloc output buffer
-    dst_buffer = av_buffer_allocz(dst_linesize[0] * dstH);
+    dst_buffer = ff_get_subtitles_bitmap_buffer(ctx->outputs[0], dst_linesize[0] * dstH);
     if (!dst_buffer) {
         av_buffer_unref(&tmp_buffer);
         return AVERROR(ENOMEM);
@@ -566,11 +570,7 @@ static int scale_area(AVFilterLink *link, AVSubtitleArea *area, const int target
     }
 
     av_buffer_unref(&area->buf[0]);
-    ret = av_buffer_replace(&area->buf[0], dst_buffer);
-    if (ret < 0) {
-        av_buffer_unref(&dst_buffer);
-        return ret;
-    }
+    area->buf[0] = dst_buffer;
 
     area->w = dstW;
     area->h = dstH;
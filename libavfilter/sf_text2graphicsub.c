@@ -29,6 +29,7 @@
 #include "internal.h"
 #include "avfilter.h"
 #include "drawutils.h"
+#include "subtitles.h"
 #include "libavutil/opt.h"
 #include "libavutil/buffer.h"
 #include "libavutil/internal.h"
@@ -270,8 +271,9 @@ static void set_area_bounds(ASS_Image *image, AVSubtitleArea *area)
     area->linesize[0] = area->w;    //stride_max - x_min;
 }
 
-static void ass_image_to_area_palletization(Text2GraphicSubContext *context, ASS_Image *image, AVSubtitleArea *area)
+static int ass_image_to_area_palletization(AVFilterLink *outlink, ASS_Image *image, AVSubtitleArea *area)
 {
+    Text2GraphicSubContext *context = outlink->src->priv;
     size_t image_rgba_size;
     uint8_t *image_rgba;
 
@@ -281,6 +283,8 @@ static void ass_image_to_area_palletization(Text2GraphicSubContext *context, ASS
     // Create rgba image
     image_rgba_size = (area->linesize[0] * area->h) * 4 * sizeof(uint8_t);
     image_rgba = (uint8_t *)av_mallocz(image_rgba_size);
+    if (!image_rgba)
+        return AVERROR(ENOMEM);
     for (; image != NULL; image = image->next)
     {
         uint8_t rgba_color[] = {AR(image->color), AG(image->color), AB(image->color), AA(image->color)};
@@ -294,7 +298,11 @@ static void ass_image_to_area_palletization(Text2GraphicSubContext *context, ASS
     }
 
     area->nb_colors = context->num_colors;
-    area->buf[0] = av_buffer_alloc(image_rgba_size / 4);
+    area->buf[0] = ff_get_subtitles_bitmap_buffer(outlink, image_rgba_size / 4);
+    if (!area->buf[0]) {
+        av_free(image_rgba);
+        return AVERROR(ENOMEM);
+    }
 
     palettize_image(context->palettize_context,
                     area->w, area->h,
@@ -304,6 +312,8 @@ static void ass_image_to_area_palletization(Text2GraphicSubContext *context, ASS
 
     // Clean up
     av_free(image_rgba);
+
+    return 0;
 }
 
 static void process_header(const AVFilterContext *link, const AVFrame *frame)
@@ -530,7 +540,13 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *frame)
 
     // TODO: Split into multiple bitmaps
 
-    ass_image_to_area_palletization(context, image, area);
+    for (unsigned n = 0; n < FF_ARRAY_ELEMS(area->buf); n++)
+        av_buffer_unref(&area->buf[n]);
+    ret = ass_image_to_area_palletization(outlink, image, area);
+    if (ret < 0) {
+        av_frame_free(&frame);
+        return ret;
+    }
     area->type = AV_SUBTITLE_FMT_BITMAP;
 
     av_log(NULL, AV_LOG_DEBUG, "successfully rendered ass: %s\n", area->ass);
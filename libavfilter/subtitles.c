@@ -22,6 +22,7 @@
 
 #include "subtitles.h"
 #include "avfilter.h"
+#include "framepool.h"
 #include "internal.h"
 
 
@@ -30,25 +31,45 @@ AVFrame *ff_null_get_subtitles_buffer(AVFilterLink *link, int format)
     return ff_get_subtitles_buffer(link->dst->outputs[0], format);
 }
 
+static int init_subtitles_pool(AVFilterLink *link)
+{
+    if (!link->frame_pool) {
+        link->frame_pool = ff_frame_pool_subtitle_init(NULL);
+        if (!link->frame_pool)
+            return AVERROR(ENOMEM);
+    }
+    return 0;
+}
+
 AVFrame *ff_default_get_subtitles_buffer(AVFilterLink *link, int format)
 {
-    AVFrame *frame;
+    AVFrame *frame = NULL;
 
-    frame = av_frame_alloc();
+    ff_link_pool_lock(link);
+    if (init_subtitles_pool(link) >= 0)
+        frame = ff_frame_pool_get(link->frame_pool);
+    if (frame)
+        link->frame_count_alloc++;
+    ff_link_pool_unlock(link);
     if (!frame)
         return NULL;
 
     frame->format = format;
-    frame->type = AVMEDIA_TYPE_SUBTITLE;
-
-    if (av_frame_get_buffer2(frame, 0) < 0) {
-        av_frame_free(&frame);
-        return NULL;
-    }
 
     return frame;
 }
 
+AVBufferRef *ff_get_subtitles_bitmap_buffer(AVFilterLink *link, size_t size)
+{
+    AVBufferRef *buf = NULL;
+
+    ff_link_pool_lock(link);
+    if (init_subtitles_pool(link) >= 0)
+        buf = ff_frame_pool_get_subtitle_bitmap(link->frame_pool, size);
+    ff_link_pool_unlock(link);
+    return buf;
+}
+
 AVFrame *ff_get_subtitles_buffer(AVFilterLink *link, int format)
 {
     AVFrame *ret = NULL;
@@ -41,4 +41,15 @@ AVFrame *ff_null_get_subtitles_buffer(AVFilterLink *link, int format);
 */
 AVFrame *ff_get_subtitles_buffer(AVFilterLink *link, int format);
 
+/**
+ * Get a buffer for the bitmap of a subtitle area of a frame sent on link.
+ * The buffers are recycled through the frame pool of the link.
+ *
+ * @param link           the output link the frame will be sent on
+ * @param size           the size of the bitmap in bytes
+ * @return               A reference to an uninitialized buffer of the given
+ *                       size, or NULL on error.
+ */
+AVBufferRef *ff_get_subtitles_bitmap_buffer(AVFilterLink *link, size_t size);
+
 #endif /* AVFILTER_SUBTITLES_H */
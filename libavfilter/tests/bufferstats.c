@@ -0,0 +1,178 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Feed a split whose second output is never read and check the queued
+ * frame statistics, and that max_queued_bytes holds back the requests of
+ * split once the frames queued on that output exceed the limit.
+ */
+
+#include <stdio.h>
+
+#include "libavutil/error.h"
+#include "libavutil/frame.h"
+#include "libavutil/opt.h"
+#include "libavfilter/avfilter.h"
+#include "libavfilter/buffersink.h"
+#include "libavfilter/buffersrc.h"
+
+#define WIDTH  64
+#define HEIGHT 64
+#define FRAME_SIZE (WIDTH * HEIGHT)
+
+static AVFilterGraph *graph;
+static AVFilterContext *src0, *src1, *sink_a, *sink_b, *sink_c, *split;
+static int64_t next_pts;
+
+static int create_filter(AVFilterContext **ctx, const char *filter,
+                         const char *name, const char *args)
+{
+    return avfilter_graph_create_filter(ctx, avfilter_get_by_name(filter),
+                                        name, args, NULL, graph);
+}
+
+static int build_graph(int64_t max_queued_bytes)
+{
+    const char *src_args = "video_size=64x64:pix_fmt=gray:time_base=1/25";
+    int ret;
+
+    graph = avfilter_graph_alloc();
+    if (!graph)
+        return AVERROR(ENOMEM);
+    av_opt_set_int(graph, "max_queued_bytes", max_queued_bytes, 0);
+
+    if ((ret = create_filter(&src0,   "buffer",     "src0",   src_args)) < 0 ||
+        (ret = create_filter(&src1,   "buffer",     "src1",   src_args)) < 0 ||
+        (ret = create_filter(&split,  "split",      "split",  NULL))     < 0 ||
+        (ret = create_filter(&sink_a, "buffersink", "sink_a", NULL))     < 0 ||
+        (ret = create_filter(&sink_b, "buffersink", "sink_b", NULL))     < 0 ||
+        (ret = create_filter(&sink_c, "buffersink", "sink_c", NULL))     < 0)
+        return ret;
+
+    if ((ret = avfilter_link(src0,  0, split,  0)) < 0 ||
+        (ret = avfilter_link(split, 0, sink_a, 0)) < 0 ||
+        (ret = avfilter_link(split, 1, sink_b, 0)) < 0 ||
+        (ret = avfilter_link(src1,  0, sink_c, 0)) < 0)
+        return ret;
+
+    return avfilter_graph_config(graph, NULL);
+}
+
+/* Frames with a buffer of a known size, so the counts are the same on all
+   platforms. */
+static int push_frame(AVFilterContext *src)
+{
+    AVFrame *frame = av_frame_alloc();
+    int ret;
+
+    if (!frame)
+        return AVERROR(ENOMEM);
+    frame->buf[0] = av_buffer_allocz(FRAME_SIZE);
+    if (!frame->buf[0]) {
+        av_frame_free(&frame);
+        return AVERROR(ENOMEM);
+    }
+    frame->data[0]     = frame->buf[0]->data;
+    frame->linesize[0] = WIDTH;
+    frame->width       = WIDTH;
+    frame->height      = HEIGHT;
+    frame->format      = AV_PIX_FMT_GRAY8;
+    frame->pts         = next_pts++;
+
+    ret = av_buffersrc_add_frame_flags(src, frame, 0);
+    av_frame_free(&frame);
+    return ret;
+}
+
+static int pull_frame(AVFilterContext *sink)
+{
+    AVFrame *frame = av_frame_alloc();
+    int ret;
+
+    if (!frame)
+        return AVERROR(ENOMEM);
+    ret = av_buffersink_get_frame(sink, frame);
+    if (ret >= 0)
+        ret = frame->pts;
+    av_frame_free(&frame);
+    return ret;
+}
+
+static void print_stats(const char *step, int ret)
+{
+    AVFilterBufferStats g, in, out;
+
+    avfilter_graph_get_buffer_stats(graph, &g);
+    avfilter_link_get_buffer_stats(split->inputs[0], &in);
+    avfilter_link_get_buffer_stats(split->outputs[1], &out);
+
+    printf("%-8s ", step);
+    if (ret == AVERROR(EAGAIN))
+        printf("EAGAIN ");
+    else if (ret < 0)
+        printf("%-6d ", ret);
+    else
+        printf("pts=%-2d ", ret);
+    printf("graph: frames=%"PRIu64" bytes=%-5"PRIu64" peak=%-5"PRIu64" deferred=%u | "
+           "split:1: frames=%"PRIu64" bytes=%-5"PRIu64" peak=%-5"PRIu64" | "
+           "src0: deferred=%u failed=%u\n",
+           g.queued_frames, g.queued_bytes, g.peak_queued_bytes, g.deferred_requests,
+           out.queued_frames, out.queued_bytes, out.peak_queued_bytes,
+           in.deferred_requests, av_buffersrc_get_nb_failed_requests(src0));
+}
+
+int main(void)
+{
+    int ret, i;
+
+    if ((ret = build_graph(2 * FRAME_SIZE)) < 0) {
+        fprintf(stderr, "Could not build the graph: %s\n", av_err2str(ret));
+        return 1;
+    }
+
+    /* src1 waits for input, so the graph can still make progress. */
+    print_stats("pull c", pull_frame(sink_c));
+
+    for (i = 0; i < 3; i++) {
+        print_stats("pull a", pull_frame(sink_a));
+        if ((ret = push_frame(src0)) < 0)
+            goto end;
+        print_stats("pull a", pull_frame(sink_a));
+    }
+    /* The frames queued on split:1 exceed the limit: no request on src0. */
+    print_stats("pull a", pull_frame(sink_a));
+    /* Reading them issues the held back request. */
+    for (i = 0; i < 2; i++)
+        print_stats("pull b", pull_frame(sink_b));
+    print_stats("pull a", pull_frame(sink_a));
+
+    /* With no source waiting, the held back requests are issued anyway. */
+    if ((ret = push_frame(src1)) < 0)
+        goto end;
+    print_stats("pull c", pull_frame(sink_c));
+    for (i = 0; i < 2; i++) {
+        if ((ret = push_frame(src0)) < 0)
+            goto end;
+        print_stats("pull a", pull_frame(sink_a));
+    }
+    print_stats("pull a", pull_frame(sink_a));
+
+end:
+    avfilter_graph_free(&graph);
+    return ret < 0;
+}
@@ -0,0 +1,158 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Run frames through a small graph with and without the profiling option
+ * and print the processing statistics of its filters. Only the counters are
+ * printed, the times are just checked for consistency.
+ */
+
+#include <stdio.h>
+
+#include "libavutil/error.h"
+#include "libavutil/frame.h"
+#include "libavutil/mem.h"
+#include "libavutil/opt.h"
+#include "libavfilter/avfilter.h"
+#include "libavfilter/buffersink.h"
+#include "libavfilter/buffersrc.h"
+
+#define NB_FRAMES 10
+
+static int run_graph(int profiling)
+{
+    AVFilterGraph *graph;
+    AVFilterContext *src, *sinks[2];
+    AVFilterInOut *outputs = NULL, *inputs = NULL;
+    AVFilterStats *stats = NULL;
+    AVFrame *frame = NULL;
+    int ret, eof[2] = { 0 };
+
+    graph = avfilter_graph_alloc();
+    if (!graph)
+        return AVERROR(ENOMEM);
+    av_opt_set_int(graph, "profiling", profiling, 0);
+
+    ret = avfilter_graph_create_filter(&src, avfilter_get_by_name("buffer"), "src",
+                                       "video_size=64x64:pix_fmt=gray:time_base=1/25",
+                                       NULL, graph);
+    if (ret < 0)
+        goto end;
+    for (int i = 0; i < 2; i++) {
+        ret = avfilter_graph_create_filter(&sinks[i], avfilter_get_by_name("buffersink"),
+                                           i ? "sink_b" : "sink_a", NULL, NULL, graph);
+        if (ret < 0)
+            goto end;
+    }
+
+    outputs = avfilter_inout_alloc();
+    inputs  = avfilter_inout_alloc();
+    if (!outputs || !inputs || !(inputs->next = avfilter_inout_alloc())) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    outputs->name            = av_strdup("in");
+    outputs->filter_ctx      = src;
+    inputs->name             = av_strdup("a");
+    inputs->filter_ctx       = sinks[0];
+    inputs->next->name       = av_strdup("b");
+    inputs->next->filter_ctx = sinks[1];
+
+    ret = avfilter_graph_parse_ptr(graph, "[in]split=2[s0][s1];"
+                                          "[s0]hflip,select='not(mod(n,2))'[a];"
+                                          "[s1]vflip[b]", &inputs, &outputs, NULL);
+    if (ret < 0)
+        goto end;
+    if ((ret = avfilter_graph_config(graph, NULL)) < 0)
+        goto end;
+
+    for (int i = 0; i < NB_FRAMES; i++) {
+        if (!(frame = av_frame_alloc())) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        frame->type   = AVMEDIA_TYPE_VIDEO;
+        frame->width  = 64;
+        frame->height = 64;
+        frame->format = AV_PIX_FMT_GRAY8;
+        frame->pts    = i;
+        if ((ret = av_frame_get_buffer2(frame, 0)) < 0 ||
+            (ret = av_buffersrc_add_frame(src, frame)) < 0)
+            goto end;
+        av_frame_free(&frame);
+    }
+    if ((ret = av_buffersrc_add_frame(src, NULL)) < 0)
+        goto end;
+
+    if (!(frame = av_frame_alloc())) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    /* read both outputs in turn, as an application writing two streams */
+    for (int i = 0; !eof[0] || !eof[1]; i = !i) {
+        if (eof[i])
+            continue;
+        ret = av_buffersink_get_frame(sinks[i], frame);
+        if (ret == AVERROR_EOF)
+            eof[i] = 1;
+        else if (ret < 0)
+            goto end;
+        av_frame_unref(frame);
+    }
+
+    stats = av_calloc(graph->nb_filters, sizeof(*stats));
+    if (!stats) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    avfilter_graph_get_stats(graph, stats);
+
+    printf("profiling=%d\n", profiling);
+    for (unsigned i = 0; i < graph->nb_filters; i++) {
+        const AVFilterStats *st = &stats[i];
+        int times_ok = profiling ? st->wall_time >= 0 && st->cpu_time >= 0 :
+                                   !st->wall_time && !st->cpu_time;
+
+        printf("%-24s activations=%-3"PRIu64" in=%-3"PRIu64" out=%-3"PRIu64
+               " allocated=%-3"PRIu64" times %s\n", graph->filters[i]->name,
+               st->activations, st->frames_in, st->frames_out,
+               st->frames_allocated, times_ok ? "ok" : "wrong");
+    }
+    ret = 0;
+
+end:
+    av_free(stats);
+    av_frame_free(&frame);
+    avfilter_inout_free(&inputs);
+    avfilter_inout_free(&outputs);
+    avfilter_graph_free(&graph);
+    return ret;
+}
+
+int main(void)
+{
+    int ret;
+
+    for (int profiling = 0; profiling < 2; profiling++) {
+        if ((ret = run_graph(profiling)) < 0) {
+            fprintf(stderr, "Error running the graph: %s\n", av_err2str(ret));
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,348 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Check the heartbeat frames of subtitle buffer sources.
+ *
+ * First print the subtitle frames sent next to a video input for a few
+ * heartbeat_lag values, with an event added behind the heartbeats.
+ *
+ * Then overlay sparse bitmap subtitles on video: without heartbeats, the
+ * video waits for the next subtitle event; with them, it must not, and the
+ * output must be the same as when the application sends empty frames
+ * itself, as ffmpeg did before the heartbeat option. A smaller
+ * heartbeat_lag bounds the delay further; with 0.5 seconds a heartbeat
+ * clears the first event before its end, hence the different checksum.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/adler32.h"
+#include "libavutil/error.h"
+#include "libavutil/frame.h"
+#include "libavutil/mem.h"
+#include "libavutil/subfmt.h"
+#include "libavutil/timestamp.h"
+#include "libavfilter/avfilter.h"
+#include "libavfilter/buffersink.h"
+#include "libavfilter/buffersrc.h"
+
+#define WIDTH  64
+#define HEIGHT 64
+#define VIDEO_TB ((AVRational){ 1, 10 })
+#define SUB_TB   ((AVRational){ 1, 1000 })
+
+enum Mode {
+    MODE_NONE,      ///< no heartbeats
+    MODE_HEARTBEAT, ///< heartbeat option of sbuffer
+    MODE_KICKOFF,   ///< empty frames sent by the application
+};
+
+static const char *const mode_names[] = { "none", "heartbeat", "kickoff" };
+
+typedef struct SubEvent {
+    int64_t pts;        ///< in SUB_TB
+    int64_t duration;
+    int bitmap;         ///< 0 for an empty frame clearing the previous event
+} SubEvent;
+
+/* Sparse events, with more than the default lag of 5 seconds between the
+   second and the third. */
+static const SubEvent events[] = {
+    {  500, 1000, 1 },
+    { 1500,    0, 0 },
+    { 9000, 1000, 1 },
+    { 10000,   0, 0 },
+};
+
+static AVFrame *subtitle_frame(int64_t pts, int64_t duration, int bitmap)
+{
+    AVFrame *frame = av_frame_alloc();
+    AVSubtitleArea *area;
+
+    if (!frame)
+        return NULL;
+    frame->type   = AVMEDIA_TYPE_SUBTITLE;
+    frame->format = AV_SUBTITLE_FMT_BITMAP;
+    frame->width  = WIDTH;
+    frame->height = HEIGHT;
+    if (av_frame_get_buffer2(frame, 0) < 0)
+        goto fail;
+    frame->pts = pts;
+    frame->subtitle_timing.start_pts = av_rescale_q(pts, SUB_TB, AV_TIME_BASE_Q);
+    frame->subtitle_timing.duration  = av_rescale_q(duration, SUB_TB, AV_TIME_BASE_Q);
+    if (!bitmap)
+        return frame;
+
+    frame->subtitle_areas = av_calloc(1, sizeof(*frame->subtitle_areas));
+    if (!frame->subtitle_areas ||
+        !(frame->subtitle_areas[0] = area = av_mallocz(sizeof(*area))))
+        goto fail;
+    frame->num_subtitle_areas = 1;
+    area->type        = AV_SUBTITLE_FMT_BITMAP;
+    area->x           = 8;
+    area->y           = 40;
+    area->w           = 48;
+    area->h           = 16;
+    area->nb_colors   = 2;
+    area->pal[0]      = 0x00000000;
+    area->pal[1]      = 0xFFFFFF00;
+    area->linesize[0] = area->w;
+    area->buf[0]      = av_buffer_alloc(area->w * area->h);
+    if (!area->buf[0])
+        goto fail;
+    for (int y = 0; y < area->h; y++)
+        for (int x = 0; x < area->w; x++)
+            area->buf[0]->data[y * area->w + x] = (x / 4 + y / 4) & 1;
+    return frame;
+fail:
+    av_frame_free(&frame);
+    return NULL;
+}
+
+static AVFrame *video_frame(int64_t pts)
+{
+    AVFrame *frame = av_frame_alloc();
+
+    if (!frame)
+        return NULL;
+    frame->type   = AVMEDIA_TYPE_VIDEO;
+    frame->width  = WIDTH;
+    frame->height = HEIGHT;
+    frame->format = AV_PIX_FMT_YUV420P;
+    frame->pts    = pts;
+    if (av_frame_get_buffer2(frame, 0) < 0) {
+        av_frame_free(&frame);
+        return NULL;
+    }
+    for (int p = 0; p < 3; p++) {
+        int h = p ? HEIGHT / 2 : HEIGHT;
+        for (int y = 0; y < h; y++)
+            memset(frame->data[p] + y * frame->linesize[p],
+                   p ? 128 : (pts * 8 + y) & 0xFF, p ? WIDTH / 2 : WIDTH);
+    }
+    return frame;
+}
+
+static int add_frame(AVFilterContext *src, AVFrame *frame)
+{
+    int ret;
+
+    if (!frame)
+        return AVERROR(ENOMEM);
+    ret = av_buffersrc_add_frame(src, frame);
+    av_frame_free(&frame);
+    return ret;
+}
+
+static int create_sbuffer(AVFilterGraph *graph, AVFilterContext **ctx,
+                          int heartbeat, const char *lag)
+{
+    char args[256];
+
+    snprintf(args, sizeof(args), "subtitle_type=%d:width=%d:height=%d:"
+             "time_base=%d/%d:heartbeat=%d%s%s", AV_SUBTITLE_FMT_BITMAP,
+             WIDTH, HEIGHT, SUB_TB.num, SUB_TB.den, heartbeat,
+             lag ? ":heartbeat_lag=" : "", lag ? lag : "");
+    return avfilter_graph_create_filter(ctx, avfilter_get_by_name("sbuffer"),
+                                        "sub", args, NULL, graph);
+}
+
+static int create_buffer(AVFilterGraph *graph, AVFilterContext **ctx)
+{
+    char args[256];
+
+    snprintf(args, sizeof(args), "video_size=%dx%d:pix_fmt=%d:time_base=%d/%d",
+             WIDTH, HEIGHT, AV_PIX_FMT_YUV420P, VIDEO_TB.num, VIDEO_TB.den);
+    return avfilter_graph_create_filter(ctx, avfilter_get_by_name("buffer"),
+                                        "video", args, NULL, graph);
+}
+
+static int print_subtitles(AVFilterContext *sink, AVFrame *frame)
+{
+    int ret;
+
+    while ((ret = av_buffersink_get_frame(sink, frame)) >= 0) {
+        printf("  subtitle pts_time:%-6s areas:%u\n",
+               av_ts2timestr(frame->pts, &sink->inputs[0]->time_base),
+               frame->num_subtitle_areas);
+        av_frame_unref(frame);
+    }
+    return ret == AVERROR(EAGAIN) || ret == AVERROR_EOF ? 0 : ret;
+}
+
+/* Print the subtitle frames sent next to 3 seconds of video. */
+static int run_timeline(const char *lag)
+{
+    AVFilterGraph *graph = avfilter_graph_alloc();
+    AVFilterContext *video, *sub, *vsink, *ssink;
+    AVFrame *frame = av_frame_alloc();
+    int ret;
+
+    if (!graph || !frame) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    if ((ret = create_buffer(graph, &video)) < 0 ||
+        (ret = create_sbuffer(graph, &sub, 1, lag)) < 0 ||
+        (ret = avfilter_graph_create_filter(&vsink, avfilter_get_by_name("buffersink"),
+                                            "vsink", NULL, NULL, graph)) < 0 ||
+        (ret = avfilter_graph_create_filter(&ssink, avfilter_get_by_name("sbuffersink"),
+                                            "ssink", NULL, NULL, graph)) < 0 ||
+        (ret = avfilter_link(video, 0, vsink, 0)) < 0 ||
+        (ret = avfilter_link(sub, 0, ssink, 0)) < 0 ||
+        (ret = avfilter_graph_config(graph, NULL)) < 0)
+        goto end;
+
+    printf("heartbeat_lag=%s\n", lag ? lag : "default");
+    for (int64_t pts = 0; pts < 30; pts++) {
+        /* an event behind the last heartbeat is moved after it */
+        if (pts == 20) {
+            printf("  add event pts_time:1.5\n");
+            if ((ret = add_frame(sub, subtitle_frame(1500, 100, 1))) < 0)
+                goto end;
+        }
+        if ((ret = add_frame(video, video_frame(pts))) < 0 ||
+            (ret = print_subtitles(ssink, frame)) < 0)
+            goto end;
+        while (av_buffersink_get_frame(vsink, frame) >= 0)
+            av_frame_unref(frame);
+    }
+
+end:
+    av_frame_free(&frame);
+    avfilter_graph_free(&graph);
+    return ret;
+}
+
+/* ffmpeg before the heartbeat option: when a video packet is read, send an
+   empty subtitle frame if no subtitles were sent yet, or if they lag more
+   than 5 seconds behind and the buffer source failed requests. */
+static int send_kickoff(AVFilterContext *sub, int64_t video_pts, int64_t *last_pts)
+{
+    int64_t pts = av_rescale_q(video_pts, VIDEO_TB, SUB_TB);
+
+    if (*last_pts != AV_NOPTS_VALUE &&
+        (pts - 5000 <= *last_pts || !av_buffersrc_get_nb_failed_requests(sub)))
+        return 0;
+    pts = FFMAX(pts, *last_pts) + 10;
+    *last_pts = pts;
+    return add_frame(sub, subtitle_frame(pts, 10, 0));
+}
+
+static int read_output(AVFilterContext *sink, AVFrame *frame,
+                       uint32_t *checksum, int *nb_out)
+{
+    int ret;
+
+    while ((ret = av_buffersink_get_frame(sink, frame)) >= 0) {
+        for (int p = 0; p < 3; p++) {
+            int h = p ? HEIGHT / 2 : HEIGHT, w = p ? WIDTH / 2 : WIDTH;
+            for (int y = 0; y < h; y++)
+                *checksum = av_adler32_update(*checksum, frame->data[p] +
+                                              y * frame->linesize[p], w);
+        }
+        (*nb_out)++;
+        av_frame_unref(frame);
+    }
+    return ret == AVERROR(EAGAIN) || ret == AVERROR_EOF ? 0 : ret;
+}
+
+/* Overlay the events on 12 seconds of video and print how many frames the
+   output lagged behind the input at most, and a checksum of the output. */
+static int run_overlay(enum Mode mode, const char *lag)
+{
+    AVFilterGraph *graph = avfilter_graph_alloc();
+    AVFilterContext *video, *sub, *overlay, *sink;
+    AVFrame *frame = av_frame_alloc();
+    int64_t last_pts = AV_NOPTS_VALUE;
+    uint32_t checksum = 0;
+    int nb_in = 0, nb_out = 0, max_delay = 0, next_event = 0, ret;
+
+    if (!graph || !frame) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    if ((ret = create_buffer(graph, &video)) < 0 ||
+        (ret = create_sbuffer(graph, &sub, mode == MODE_HEARTBEAT, lag)) < 0 ||
+        (ret = avfilter_graph_create_filter(&overlay, avfilter_get_by_name("overlaygraphicsubs"),
+                                            "overlay", NULL, NULL, graph)) < 0 ||
+        (ret = avfilter_graph_create_filter(&sink, avfilter_get_by_name("buffersink"),
+                                            "sink", NULL, NULL, graph)) < 0 ||
+        (ret = avfilter_link(video, 0, overlay, 0)) < 0 ||
+        (ret = avfilter_link(sub, 0, overlay, 1)) < 0 ||
+        (ret = avfilter_link(overlay, 0, sink, 0)) < 0 ||
+        (ret = avfilter_graph_config(graph, NULL)) < 0)
+        goto end;
+
+    for (int64_t pts = 0; pts <= 120; pts++) {
+        /* add the events as a demuxer interleaving them would */
+        while (next_event < FF_ARRAY_ELEMS(events) &&
+               av_compare_ts(events[next_event].pts, SUB_TB, pts, VIDEO_TB) <= 0) {
+            const SubEvent *ev = &events[next_event++];
+            int64_t ev_pts = ev->pts;
+
+            /* keep the timestamps after the empty frames */
+            if (last_pts != AV_NOPTS_VALUE && ev_pts <= last_pts)
+                ev_pts = last_pts + 1;
+            last_pts = ev_pts;
+            if ((ret = add_frame(sub, subtitle_frame(ev_pts, ev->duration, ev->bitmap))) < 0)
+                goto end;
+        }
+        if (mode == MODE_KICKOFF && (ret = send_kickoff(sub, pts, &last_pts)) < 0)
+            goto end;
+        if ((ret = add_frame(video, video_frame(pts))) < 0)
+            goto end;
+        nb_in++;
+        if ((ret = read_output(sink, frame, &checksum, &nb_out)) < 0)
+            goto end;
+        max_delay = FFMAX(max_delay, nb_in - nb_out);
+    }
+    if ((ret = av_buffersrc_add_frame(video, NULL)) < 0 ||
+        (ret = av_buffersrc_add_frame(sub, NULL)) < 0 ||
+        (ret = read_output(sink, frame, &checksum, &nb_out)) < 0)
+        goto end;
+
+    printf("%-9s %-16s in:%d out:%d max delay:%-2d checksum:0x%08"PRIx32"\n",
+           mode_names[mode], mode == MODE_HEARTBEAT ? lag ? lag : "default" : "",
+           nb_in, nb_out, max_delay, checksum);
+
+end:
+    av_frame_free(&frame);
+    avfilter_graph_free(&graph);
+    return ret;
+}
+
+int main(void)
+{
+    static const char *const lags[] = { NULL, "0.5", "1" };
+    int ret = 0;
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(lags) && ret >= 0; i++)
+        ret = run_timeline(lags[i]);
+    for (enum Mode mode = MODE_NONE; mode <= MODE_KICKOFF && ret >= 0; mode++)
+        ret = run_overlay(mode, NULL);
+    for (int i = 1; i < FF_ARRAY_ELEMS(lags) && ret >= 0; i++)
+        ret = run_overlay(MODE_HEARTBEAT, lags[i]);
+    if (ret < 0) {
+        fprintf(stderr, "Error: %s\n", av_err2str(ret));
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,258 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Filter video and audio frames into buffer sinks allocating their frames
+ * from an application pool with av_buffersink_set_get_buffer(), and print
+ * where the output buffers come from, the number of frames allocated by the
+ * graph and a checksum of the output, which must not depend on the pool.
+ */
+
+#include <stdio.h>
+
+#include "libavutil/adler32.h"
+#include "libavutil/buffer.h"
+#include "libavutil/channel_layout.h"
+#include "libavutil/error.h"
+#include "libavutil/frame.h"
+#include "libavutil/macros.h"
+#include "libavutil/mem.h"
+#include "libavutil/samplefmt.h"
+#include "libavfilter/avfilter.h"
+#include "libavfilter/buffersink.h"
+#include "libavfilter/buffersrc.h"
+
+#define NB_FRAMES  8
+#define WIDTH      64
+#define HEIGHT     48
+#define NB_SAMPLES 1024
+#define POOL_SIZE  (1 << 16)
+
+enum Mode {
+    MODE_GRAPH,     ///< no callback
+    MODE_APP,       ///< the callback allocates from the application pool
+    MODE_FAIL,      ///< the callback fails
+};
+
+static const char *const mode_names[] = { "graph", "app", "failing" };
+
+typedef struct AppPool {
+    enum Mode mode;
+    AVBufferPool *pool;
+    int nb_calls;
+} AppPool;
+
+/* The buffers of the pool have the pool as opaque, to recognize them. */
+static AVBufferRef *pool_alloc(void *opaque, size_t size)
+{
+    uint8_t *data = av_malloc(size);
+    AVBufferRef *buf;
+
+    if (!data)
+        return NULL;
+    buf = av_buffer_create(data, size, av_buffer_default_free, opaque, 0);
+    if (!buf)
+        av_free(data);
+    return buf;
+}
+
+static int get_buffer(void *opaque, AVFrame *frame, int flags)
+{
+    AppPool *p = opaque;
+    int linesize, size;
+
+    p->nb_calls++;
+    if (p->mode == MODE_FAIL)
+        return AVERROR(ENOMEM);
+
+    if (frame->type == AVMEDIA_TYPE_VIDEO) {
+        linesize = FFALIGN(frame->width, 64);
+        size     = linesize * frame->height + 64;
+    } else {
+        size = av_samples_get_buffer_size(&linesize, frame->ch_layout.nb_channels,
+                                          frame->nb_samples, frame->format, 0);
+        if (size < 0)
+            return size;
+    }
+    if (size > POOL_SIZE)
+        return AVERROR(EINVAL);
+
+    frame->buf[0] = av_buffer_pool_get(p->pool);
+    if (!frame->buf[0])
+        return AVERROR(ENOMEM);
+    frame->data[0]     = frame->buf[0]->data;
+    frame->linesize[0] = linesize;
+    return 0;
+}
+
+static int push_frame(AVFilterContext *src, enum AVMediaType type, int n)
+{
+    AVFrame *frame = av_frame_alloc();
+    int ret;
+
+    if (!frame)
+        return AVERROR(ENOMEM);
+    frame->type = type;
+    if (type == AVMEDIA_TYPE_VIDEO) {
+        frame->width  = WIDTH;
+        frame->height = HEIGHT;
+        frame->format = AV_PIX_FMT_GRAY8;
+    } else {
+        frame->nb_samples  = NB_SAMPLES;
+        frame->sample_rate = 44100;
+        frame->format      = AV_SAMPLE_FMT_S16;
+        av_channel_layout_default(&frame->ch_layout, 1);
+    }
+    frame->pts = type == AVMEDIA_TYPE_VIDEO ? n : n * NB_SAMPLES;
+    if ((ret = av_frame_get_buffer2(frame, 0)) < 0)
+        goto end;
+
+    if (type == AVMEDIA_TYPE_VIDEO) {
+        for (int y = 0; y < HEIGHT; y++)
+            for (int x = 0; x < WIDTH; x++)
+                frame->data[0][y * frame->linesize[0] + x] = x + 3 * y + n;
+    } else {
+        int16_t *samples = (int16_t *)frame->data[0];
+        for (int i = 0; i < NB_SAMPLES; i++)
+            samples[i] = (i * 97 + n * 1000) % 20000 - 10000;
+    }
+    ret = av_buffersrc_add_frame(src, frame);
+end:
+    av_frame_free(&frame);
+    return ret;
+}
+
+static int run_graph(enum AVMediaType type, enum Mode mode)
+{
+    AppPool p = { .mode = mode };
+    AVFilterGraph *graph;
+    AVFilterContext *src, *sink;
+    AVFilterInOut *outputs = NULL, *inputs = NULL;
+    AVFilterStats *stats = NULL;
+    AVFrame *frame = NULL;
+    uint32_t checksum = 0;
+    uint64_t allocated = 0;
+    int video = type == AVMEDIA_TYPE_VIDEO;
+    int nb_out = 0, nb_app = 0, ret;
+
+    graph = avfilter_graph_alloc();
+    p.pool = av_buffer_pool_init2(POOL_SIZE, &p, pool_alloc, NULL);
+    if (!graph || !p.pool) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    ret = avfilter_graph_create_filter(&src, avfilter_get_by_name(video ? "buffer" : "abuffer"),
+                                       "src", video ?
+                                       "video_size=64x48:pix_fmt=gray:time_base=1/25" :
+                                       "sample_rate=44100:sample_fmt=s16:channel_layout=mono",
+                                       NULL, graph);
+    if (ret < 0)
+        goto end;
+    ret = avfilter_graph_create_filter(&sink, avfilter_get_by_name(video ? "buffersink" : "abuffersink"),
+                                       "sink", NULL, NULL, graph);
+    if (ret < 0)
+        goto end;
+    if (mode != MODE_GRAPH)
+        av_buffersink_set_get_buffer(sink, get_buffer, &p);
+
+    outputs = avfilter_inout_alloc();
+    inputs  = avfilter_inout_alloc();
+    if (!outputs || !inputs) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    outputs->name       = av_strdup("in");
+    outputs->filter_ctx = src;
+    inputs->name        = av_strdup("out");
+    inputs->filter_ctx  = sink;
+
+    /* null passes the allocation on to the sink */
+    ret = avfilter_graph_parse_ptr(graph, video ? "[in]hflip,null[out]" :
+                                                  "[in]aresample=22050,anull[out]",
+                                   &inputs, &outputs, NULL);
+    if (ret < 0 || (ret = avfilter_graph_config(graph, NULL)) < 0)
+        goto end;
+
+    if (!(frame = av_frame_alloc())) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    for (int i = 0; i <= NB_FRAMES; i++) {
+        if (i < NB_FRAMES)
+            ret = push_frame(src, type, i);
+        else
+            ret = av_buffersrc_add_frame(src, NULL);
+        if (ret < 0)
+            goto end;
+
+        while ((ret = av_buffersink_get_frame(sink, frame)) >= 0) {
+            if (video) {
+                for (int y = 0; y < frame->height; y++)
+                    checksum = av_adler32_update(checksum, frame->data[0] +
+                                                 y * frame->linesize[0], frame->width);
+            } else {
+                checksum = av_adler32_update(checksum, frame->data[0],
+                                             frame->nb_samples * 2);
+            }
+            nb_app += av_buffer_pool_buffer_get_opaque(frame->buf[0]) == &p;
+            nb_out++;
+            av_frame_unref(frame);
+        }
+        if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF)
+            goto end;
+    }
+
+    stats = av_calloc(graph->nb_filters, sizeof(*stats));
+    if (!stats) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    avfilter_graph_get_stats(graph, stats);
+    for (unsigned i = 0; i < graph->nb_filters; i++)
+        allocated += stats[i].frames_allocated;
+
+    printf("%s %-7s out:%d from app pool:%d callback calls:%d "
+           "allocated by graph:%"PRIu64" checksum:0x%08"PRIx32"\n",
+           video ? "video" : "audio", mode_names[mode], nb_out, nb_app,
+           p.nb_calls, allocated, checksum);
+    ret = 0;
+
+end:
+    av_free(stats);
+    av_frame_free(&frame);
+    avfilter_inout_free(&inputs);
+    avfilter_inout_free(&outputs);
+    avfilter_graph_free(&graph);
+    av_buffer_pool_uninit(&p.pool);
+    return ret;
+}
+
+int main(void)
+{
+    int ret = 0;
+
+    for (int video = 1; video >= 0 && ret >= 0; video--)
+        for (enum Mode mode = MODE_GRAPH; mode <= MODE_FAIL && ret >= 0; mode++)
+            ret = run_graph(video ? AVMEDIA_TYPE_VIDEO : AVMEDIA_TYPE_AUDIO, mode);
+    if (ret < 0) {
+        fprintf(stderr, "Error: %s\n", av_err2str(ret));
+        return 1;
+    }
+    return 0;
+}
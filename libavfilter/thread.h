@@ -25,4 +25,39 @@ int ff_graph_thread_init(AVFilterGraph *graph);
 
 void ff_graph_thread_free(AVFilterGraph *graph);
 
+/**
+ * Start the pipeline worker threads if AVFILTER_THREAD_PIPELINE is enabled
+ * for graph. Called at the end of avfilter_graph_config().
+ */
+int ff_graph_pipeline_start(AVFilterGraph *graph);
+
+/**
+ * Stop the pipeline worker threads, waiting for running activations.
+ */
+void ff_graph_pipeline_stop(AVFilterGraph *graph);
+
+/**
+ * ff_filter_graph_run_once() with pipeline threading: activate a ready
+ * filter claimed by the caller, or wait until an activation by a worker
+ * ends. Must be called with the graph lock held.
+ *
+ * @return AVERROR(EAGAIN) if there is nothing left to do
+ */
+int ff_graph_pipeline_run_once(AVFilterGraph *graph);
+
+/**
+ * Wake up the threads waiting for the graph state to change. Must be called
+ * with the graph lock held.
+ */
+void ff_graph_pipeline_wake(AVFilterGraph *graph);
+
+/**
+ * Get the flag telling whether the calling thread runs a filter callback
+ * without the graph lock, and so has to take it back to use the graph.
+ * Pipeline threading must be running. The flag is only accessed by the
+ * calling thread, the application thread using the graph through the
+ * public API counting as one.
+ */
+uint8_t *ff_graph_pipeline_unlocked(AVFilterGraph *graph);
+
 #endif /* AVFILTER_THREAD_H */
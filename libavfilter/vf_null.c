@@ -30,6 +30,7 @@ static const AVFilterPad avfilter_vf_null_inputs[] = {
     {
         .name = "default",
         .type = AVMEDIA_TYPE_VIDEO,
+        .get_buffer.video = ff_null_get_video_buffer,
     },
 };
 
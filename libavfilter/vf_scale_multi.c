@@ -0,0 +1,369 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Scale the input video to several sizes in one pass, e.g. for the
+ * renditions of an adaptive bitrate ladder.
+ */
+
+#include "libavutil/avstring.h"
+#include "libavutil/internal.h"
+#include "libavutil/mem.h"
+#include "libavutil/opt.h"
+#include "libavutil/parseutils.h"
+#include "libavutil/pixdesc.h"
+#include "libswscale/swscale.h"
+
+#include "avfilter.h"
+#include "filters.h"
+#include "formats.h"
+#include "internal.h"
+#include "video.h"
+
+typedef struct ScaleMultiOutput {
+    int w, h;
+    /**
+     * Index of the output this one is scaled from with cascade enabled,
+     * -1 to scale from the input.
+     */
+    int parent;
+    struct SwsContext *sws;
+} ScaleMultiOutput;
+
+typedef struct ScaleMultiContext {
+    const AVClass *class;
+    char *sizes_str;
+    char *flags_str;
+    int cascade;
+
+    ScaleMultiOutput *outputs;
+    int nb_outputs;
+    int flags;
+
+    AVFrame **frames;
+    /* contexts and frames of the outputs scaled from the input */
+    struct SwsContext **direct_sws;
+    AVFrame **direct_frames;
+} ScaleMultiContext;
+
+static int query_formats(AVFilterContext *ctx)
+{
+    const AVPixFmtDescriptor *desc = NULL;
+    AVFilterFormats *formats = NULL;
+    int ret;
+
+    /* The outputs keep the pixel format of the input. */
+    while ((desc = av_pix_fmt_desc_next(desc))) {
+        enum AVPixelFormat pix_fmt = av_pix_fmt_desc_get_id(desc);
+
+        if (sws_isSupportedInput(pix_fmt) && sws_isSupportedOutput(pix_fmt) &&
+            (ret = ff_add_format(&formats, pix_fmt)) < 0)
+            return ret;
+    }
+    return ff_set_common_formats(ctx, formats);
+}
+
+/**
+ * Pick the output to scale output i from: the smallest earlier output which
+ * is at most twice as large in each dimension, so that a single scaling
+ * step does not lose more detail than scaling from the input.
+ */
+static int cascade_parent(ScaleMultiContext *s, int i)
+{
+    const ScaleMultiOutput *out = &s->outputs[i];
+    int parent = -1;
+
+    for (int j = 0; j < i; j++) {
+        const ScaleMultiOutput *p = &s->outputs[j];
+
+        if (p->w < out->w || p->h < out->h ||
+            p->w > 2 * out->w || p->h > 2 * out->h)
+            continue;
+        if (parent < 0 || p->w * p->h < s->outputs[parent].w * s->outputs[parent].h)
+            parent = j;
+    }
+    return parent;
+}
+
+static int config_output(AVFilterLink *outlink)
+{
+    AVFilterContext *ctx = outlink->src;
+    AVFilterLink *inlink = ctx->inputs[0];
+    ScaleMultiContext *s = ctx->priv;
+    int idx = FF_OUTLINK_IDX(outlink);
+    ScaleMultiOutput *out = &s->outputs[idx];
+    struct SwsContext *sws;
+    int src_w = inlink->w, src_h = inlink->h;
+
+    out->parent = s->cascade ? cascade_parent(s, idx) : -1;
+    if (out->parent >= 0) {
+        src_w = s->outputs[out->parent].w;
+        src_h = s->outputs[out->parent].h;
+    }
+
+    sws_freeContext(out->sws);
+    out->sws = sws = sws_alloc_context();
+    if (!sws)
+        return AVERROR(ENOMEM);
+
+    av_opt_set_int(sws, "srcw", src_w, 0);
+    av_opt_set_int(sws, "srch", src_h, 0);
+    av_opt_set_int(sws, "src_format", inlink->format, 0);
+    av_opt_set_int(sws, "dstw", out->w, 0);
+    av_opt_set_int(sws, "dsth", out->h, 0);
+    av_opt_set_int(sws, "dst_format", inlink->format, 0);
+    av_opt_set_int(sws, "sws_flags", s->flags, 0);
+    av_opt_set_int(sws, "threads", ff_filter_get_nb_threads(ctx), 0);
+    av_opt_set_int(sws, "shared_threads", ctx->graph->shared_threads, 0);
+    /* Same MPEG-2 chroma position convention as the scale filter. */
+    if (inlink->format == AV_PIX_FMT_YUV420P) {
+        av_opt_set_int(sws, "src_v_chr_pos", 128, 0);
+        av_opt_set_int(sws, "dst_v_chr_pos", 128, 0);
+    }
+
+    outlink->w = out->w;
+    outlink->h = out->h;
+    if (inlink->sample_aspect_ratio.num)
+        outlink->sample_aspect_ratio = av_mul_q((AVRational){ out->h * inlink->w,
+                                                              out->w * inlink->h },
+                                                inlink->sample_aspect_ratio);
+    else
+        outlink->sample_aspect_ratio = inlink->sample_aspect_ratio;
+
+    av_log(ctx, AV_LOG_VERBOSE, "output%d: w:%d h:%d from %s\n", idx,
+           out->w, out->h, out->parent < 0 ? "input" : "cascade");
+
+    return sws_init_context(sws, NULL, NULL);
+}
+
+static av_cold int init(AVFilterContext *ctx)
+{
+    ScaleMultiContext *s = ctx->priv;
+    char *sizes, *next, *size;
+    int ret;
+
+    if (s->flags_str && *s->flags_str) {
+        const AVClass *class = sws_get_class();
+        const AVOption    *o = av_opt_find(&class, "sws_flags", NULL, 0,
+                                           AV_OPT_SEARCH_FAKE_OBJ);
+        ret = av_opt_eval_flags(&class, o, s->flags_str, &s->flags);
+        if (ret < 0)
+            return ret;
+    }
+
+    sizes = av_strdup(s->sizes_str);
+    if (!sizes)
+        return AVERROR(ENOMEM);
+    for (size = av_strtok(sizes, "|", &next); size; size = av_strtok(NULL, "|", &next)) {
+        ScaleMultiOutput *out;
+        AVFilterPad pad = { 0 };
+
+        out = av_dynarray2_add((void **)&s->outputs, &s->nb_outputs,
+                               sizeof(*s->outputs), NULL);
+        if (!out) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        memset(out, 0, sizeof(*out));
+        ret = av_parse_video_size(&out->w, &out->h, size);
+        if (ret < 0) {
+            av_log(ctx, AV_LOG_ERROR, "Invalid size '%s'\n", size);
+            goto end;
+        }
+
+        pad.type         = AVMEDIA_TYPE_VIDEO;
+        pad.config_props = config_output;
+        pad.name = av_asprintf("output%d", s->nb_outputs - 1);
+        if (!pad.name) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        if ((ret = ff_append_outpad_free_name(ctx, &pad)) < 0)
+            goto end;
+    }
+    if (!s->nb_outputs) {
+        av_log(ctx, AV_LOG_ERROR, "No output size given\n");
+        ret = AVERROR(EINVAL);
+        goto end;
+    }
+
+    s->frames        = av_calloc(s->nb_outputs, sizeof(*s->frames));
+    s->direct_sws    = av_calloc(s->nb_outputs, sizeof(*s->direct_sws));
+    s->direct_frames = av_calloc(s->nb_outputs, sizeof(*s->direct_frames));
+    if (!s->frames || !s->direct_sws || !s->direct_frames)
+        ret = AVERROR(ENOMEM);
+
+end:
+    av_free(sizes);
+    return ret;
+}
+
+static av_cold void uninit(AVFilterContext *ctx)
+{
+    ScaleMultiContext *s = ctx->priv;
+
+    for (int i = 0; i < s->nb_outputs; i++)
+        sws_freeContext(s->outputs[i].sws);
+    av_freep(&s->outputs);
+    av_freep(&s->frames);
+    av_freep(&s->direct_sws);
+    av_freep(&s->direct_frames);
+}
+
+static int scale_frame(AVFilterContext *ctx, AVFrame *in)
+{
+    ScaleMultiContext *s = ctx->priv;
+    AVFrame **frames = s->frames;
+    int nb_direct = 0, ret = 0;
+
+    /* Outputs which are closed are not produced, unless another output is
+       scaled from them. */
+    for (int i = s->nb_outputs - 1; i >= 0; i--) {
+        AVFilterLink *outlink = ctx->outputs[i];
+        int needed = !ff_outlink_get_status(outlink);
+
+        for (int j = i + 1; j < s->nb_outputs && !needed; j++)
+            needed = frames[j] && s->outputs[j].parent == i;
+        if (!needed)
+            continue;
+
+        frames[i] = ff_get_video_buffer(outlink, outlink->w, outlink->h);
+        if (!frames[i]) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        ret = av_frame_copy_props(frames[i], in);
+        if (ret < 0)
+            goto end;
+        av_reduce(&frames[i]->sample_aspect_ratio.num, &frames[i]->sample_aspect_ratio.den,
+                  (int64_t)in->sample_aspect_ratio.num * outlink->h * in->width,
+                  (int64_t)in->sample_aspect_ratio.den * outlink->w * in->height,
+                  INT_MAX);
+    }
+
+    for (int i = 0; i < s->nb_outputs; i++) {
+        if (frames[i] && s->outputs[i].parent < 0) {
+            s->direct_sws[nb_direct]    = s->outputs[i].sws;
+            s->direct_frames[nb_direct] = frames[i];
+            nb_direct++;
+        }
+    }
+    if (nb_direct) {
+        ret = sws_scale_frame_multi(s->direct_sws, s->direct_frames, nb_direct, in);
+        if (ret < 0)
+            goto end;
+    }
+
+    for (int i = 0; i < s->nb_outputs; i++) {
+        if (!frames[i] || s->outputs[i].parent < 0)
+            continue;
+        ret = sws_scale_frame(s->outputs[i].sws, frames[i], frames[s->outputs[i].parent]);
+        if (ret < 0)
+            goto end;
+    }
+
+    for (int i = 0; i < s->nb_outputs; i++) {
+        if (!frames[i] || ff_outlink_get_status(ctx->outputs[i]))
+            continue;
+        ret = ff_filter_frame(ctx->outputs[i], frames[i]);
+        frames[i] = NULL;
+        if (ret < 0)
+            break;
+    }
+
+end:
+    for (int i = 0; i < s->nb_outputs; i++)
+        av_frame_free(&frames[i]);
+    av_frame_free(&in);
+    return ret;
+}
+
+static int activate(AVFilterContext *ctx)
+{
+    AVFilterLink *inlink = ctx->inputs[0];
+    AVFrame *in;
+    int status, ret;
+    int64_t pts;
+
+    for (int i = 0; i < ctx->nb_outputs; i++) {
+        FF_FILTER_FORWARD_STATUS_BACK_ALL(ctx->outputs[i], ctx);
+    }
+
+    ret = ff_inlink_consume_frame(inlink, &in);
+    if (ret < 0)
+        return ret;
+    if (ret > 0) {
+        ret = scale_frame(ctx, in);
+        if (ret < 0)
+            return ret;
+    }
+
+    if (ff_inlink_acknowledge_status(inlink, &status, &pts)) {
+        for (int i = 0; i < ctx->nb_outputs; i++) {
+            if (ff_outlink_get_status(ctx->outputs[i]))
+                continue;
+            ff_outlink_set_status(ctx->outputs[i], status, pts);
+        }
+        return 0;
+    }
+
+    for (int i = 0; i < ctx->nb_outputs; i++) {
+        if (ff_outlink_get_status(ctx->outputs[i]))
+            continue;
+
+        if (ff_outlink_frame_wanted(ctx->outputs[i])) {
+            ff_inlink_request_frame(inlink);
+            return 0;
+        }
+    }
+
+    return FFERROR_NOT_READY;
+}
+
+#define OFFSET(x) offsetof(ScaleMultiContext, x)
+#define FLAGS AV_OPT_FLAG_VIDEO_PARAM | AV_OPT_FLAG_FILTERING_PARAM
+static const AVOption scale_multi_options[] = {
+    { "sizes",   "set the '|'-separated output sizes", OFFSET(sizes_str), AV_OPT_TYPE_STRING, { .str = NULL },    0, 0, FLAGS },
+    { "flags",   "set libswscale flags",   OFFSET(flags_str), AV_OPT_TYPE_STRING, { .str = "bicubic" }, 0, 0, FLAGS },
+    { "cascade", "scale smaller outputs from larger ones", OFFSET(cascade), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, FLAGS },
+    { NULL }
+};
+
+AVFILTER_DEFINE_CLASS(scale_multi);
+
+static const AVFilterPad avfilter_vf_scale_multi_inputs[] = {
+    {
+        .name = "default",
+        .type = AVMEDIA_TYPE_VIDEO,
+    },
+};
+
+const AVFilter ff_vf_scale_multi = {
+    .name          = "scale_multi",
+    .description   = NULL_IF_CONFIG_SMALL("Scale the input video to several sizes."),
+    .priv_size     = sizeof(ScaleMultiContext),
+    .priv_class    = &scale_multi_class,
+    .init          = init,
+    .uninit        = uninit,
+    .activate      = activate,
+    FILTER_INPUTS(avfilter_vf_scale_multi_inputs),
+    .outputs       = NULL,
+    FILTER_QUERY_FUNC(query_formats),
+    .flags         = AVFILTER_FLAG_DYNAMIC_OUTPUTS,
+};
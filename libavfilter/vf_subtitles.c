@@ -59,6 +59,15 @@ typedef struct AssContext {
     int original_w, original_h;
     int shaping;
     FFDrawContext draw;
+#if CONFIG_SUBTITLES_FILTER
+    int64_t lookahead;
+    AVFormatContext *fmt;      ///< subtitles file, open while events are read lazily
+    AVCodecContext *dec_ctx;
+    AVPacket *pkt;
+    AVFrame *sub;
+    int sid;
+    int64_t read_time_ms;      ///< start time of the last event read
+#endif
 } AssContext;
 
 #define OFFSET(x) offsetof(AssContext, x)
@@ -125,6 +134,12 @@ static av_cold void uninit(AVFilterContext *ctx)
 {
     AssContext *ass = ctx->priv;
 
+#if CONFIG_SUBTITLES_FILTER
+    avcodec_free_context(&ass->dec_ctx);
+    avformat_close_input(&ass->fmt);
+    av_packet_free(&ass->pkt);
+    av_frame_free(&ass->sub);
+#endif
     if (ass->track)
         ass_free_track(ass->track);
     if (ass->renderer)
@@ -179,6 +194,97 @@ static void overlay_ass_image(AssContext *ass, AVFrame *picref,
     }
 }
 
+#if CONFIG_SUBTITLES_FILTER
+static int decode(AVCodecContext *avctx, AVFrame *frame, int *got_frame, AVPacket *pkt)
+{
+    int ret;
+
+    *got_frame = 0;
+
+    if (pkt) {
+        ret = avcodec_send_packet(avctx, pkt);
+        // In particular, we don't expect AVERROR(EAGAIN), because we read all
+        // decoded frames with avcodec_receive_frame() until done.
+        if (ret < 0 && ret != AVERROR_EOF)
+            return ret;
+    }
+
+    ret = avcodec_receive_frame(avctx, frame);
+    if (ret < 0 && ret != AVERROR(EAGAIN))
+        return ret;
+    if (ret >= 0)
+        *got_frame = 1;
+
+    return 0;
+}
+
+/**
+ * Decode the subtitles file and push the events into the renderer (libass)
+ * until an event starting after until_ms has been read. The file is closed
+ * once it is fully read.
+ */
+static int read_events(AVFilterContext *ctx, int64_t until_ms)
+{
+    AssContext *ass = ctx->priv;
+    AVStream *st = ass->fmt->streams[ass->sid];
+
+    while (ass->read_time_ms <= until_ms) {
+        int i, got_subtitle, ret;
+
+        if (av_read_frame(ass->fmt, ass->pkt) < 0) {
+            avcodec_free_context(&ass->dec_ctx);
+            avformat_close_input(&ass->fmt);
+            return 0;
+        }
+        if (ass->pkt->stream_index != ass->sid) {
+            av_packet_unref(ass->pkt);
+            continue;
+        }
+        if (ass->pkt->pts != AV_NOPTS_VALUE)
+            ass->read_time_ms = av_rescale_q(ass->pkt->pts, st->time_base,
+                                             av_make_q(1, 1000));
+
+        ret = decode(ass->dec_ctx, ass->sub, &got_subtitle, ass->pkt);
+        av_packet_unref(ass->pkt);
+        if (ret < 0) {
+            av_log(ctx, AV_LOG_WARNING, "Error decoding: %s (ignored)\n",
+                   av_err2str(ret));
+        } else if (got_subtitle) {
+            const int64_t start_time = av_rescale_q(ass->sub->subtitle_timing.start_pts, AV_TIME_BASE_Q, av_make_q(1, 1000));
+            const int64_t duration   = av_rescale_q(ass->sub->subtitle_timing.duration, AV_TIME_BASE_Q, av_make_q(1, 1000));
+            for (i = 0; i < ass->sub->num_subtitle_areas; i++) {
+                char *ass_line = ass->sub->subtitle_areas[i]->ass;
+                if (!ass_line)
+                    continue;
+                ass_process_chunk(ass->track, ass_line, strlen(ass_line),
+                                  start_time, duration);
+            }
+        }
+        av_frame_unref(ass->sub);
+    }
+
+    return 0;
+}
+
+/**
+ * Drop the events which ended before time_ms, assuming the video
+ * timestamps do not go back.
+ */
+static void expire_events(AssContext *ass, int64_t time_ms)
+{
+    ASS_Track *track = ass->track;
+    int i, j;
+
+    for (i = j = 0; i < track->n_events; i++) {
+        if (track->events[i].Start + track->events[i].Duration < time_ms)
+            ass_free_event(track, i);
+        else
+            track->events[j++] = track->events[i];
+    }
+    track->n_events = j;
+}
+#endif
+
 static int filter_frame(AVFilterLink *inlink, AVFrame *picref)
 {
     AVFilterContext *ctx = inlink->dst;
@@ -186,8 +292,20 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *picref)
     AssContext *ass = ctx->priv;
     int detect_change = 0;
     double time_ms = picref->pts * av_q2d(inlink->time_base) * 1000;
-    ASS_Image *image = ass_render_frame(ass->renderer, ass->track,
-                                        time_ms, &detect_change);
+    ASS_Image *image;
+
+#if CONFIG_SUBTITLES_FILTER
+    if (ass->fmt) {
+        int ret = read_events(ctx, time_ms + ass->lookahead / 1000);
+        if (ret < 0) {
+            av_frame_free(&picref);
+            return ret;
+        }
+        expire_events(ass, time_ms);
+    }
+#endif
+
+    image = ass_render_frame(ass->renderer, ass->track, time_ms, &detect_change);
 
     if (detect_change)
         av_log(ctx, AV_LOG_DEBUG, "Change happened at time ms:%f\n", time_ms);
@@ -269,6 +387,7 @@ static const AVOption subtitles_options[] = {
     {"stream_index", "set stream index",             OFFSET(stream_index), AV_OPT_TYPE_INT,    { .i64 = -1 }, -1,       INT_MAX,  FLAGS},
     {"si",           "set stream index",             OFFSET(stream_index), AV_OPT_TYPE_INT,    { .i64 = -1 }, -1,       INT_MAX,  FLAGS},
     {"force_style",  "force subtitle style",         OFFSET(force_style),  AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, FLAGS},
+    {"lookahead",    "read the subtitles lazily, this far ahead of the video", OFFSET(lookahead), AV_OPT_TYPE_DURATION, { .i64 = 0 }, 0, INT64_MAX, FLAGS},
     {NULL},
 };
 
@@ -302,29 +421,6 @@ static int attachment_is_font(AVStream * st)
     return 0;
 }
 
-static int decode(AVCodecContext *avctx, AVFrame *frame, int *got_frame, AVPacket *pkt)
-{
-    int ret;
-
-    *got_frame = 0;
-
-    if (pkt) {
-        ret = avcodec_send_packet(avctx, pkt);
-        // In particular, we don't expect AVERROR(EAGAIN), because we read all
-        // decoded frames with avcodec_receive_frame() until done.
-        if (ret < 0 && ret != AVERROR_EOF)
-            return ret;
-    }
-
-    ret = avcodec_receive_frame(avctx, frame);
-    if (ret < 0 && ret != AVERROR(EAGAIN))
-        return ret;
-    if (ret >= 0)
-        *got_frame = 1;
-
-    return 0;
-}
-
 AVFILTER_DEFINE_CLASS(subtitles);
 
 static enum AVSubtitleType get_subtitle_format(const AVCodecDescriptor *codec_descriptor)
@@ -348,7 +444,6 @@ static av_cold int init_subtitles(AVFilterContext *ctx)
     const AVCodec *dec;
     const AVCodecDescriptor *dec_desc;
     AVStream *st;
-    AVPacket pkt;
     AssContext *ass = ctx->priv;
     enum AVSubtitleType subtitle_format;
 
@@ -490,39 +585,32 @@ static av_cold int init_subtitles(AVFilterContext *ctx)
         ass_set_style_overrides(ass->library, list);
         av_free(list);
     }
-    /* Decode subtitles and push them into the renderer (libass) */
     if (dec_ctx->subtitle_header)
         ass_process_codec_private(ass->track,
                                   dec_ctx->subtitle_header,
                                   dec_ctx->subtitle_header_size);
-    while (av_read_frame(fmt, &pkt) >= 0) {
-        int i, got_subtitle;
-        AVFrame *sub = av_frame_alloc();
-        if (!sub) {
-            ret = AVERROR(ENOMEM);
-            goto end;
-        }
 
-        if (pkt.stream_index == sid) {
-            ret = decode(dec_ctx, sub, &got_subtitle, &pkt);
-            if (ret < 0) {
-                av_log(ctx, AV_LOG_WARNING, "Error decoding: %s (ignored)\n",
-                       av_err2str(ret));
-            } else if (got_subtitle) {
-                const int64_t start_time = av_rescale_q(sub->subtitle_timing.start_pts, AV_TIME_BASE_Q, av_make_q(1, 1000));
-                const int64_t duration   = av_rescale_q(sub->subtitle_timing.duration, AV_TIME_BASE_Q, av_make_q(1, 1000));
-                for (i = 0; i < sub->num_subtitle_areas; i++) {
-                    char *ass_line = sub->subtitle_areas[i]->ass;
-                    if (!ass_line)
-                        continue;
-                    ass_process_chunk(ass->track, ass_line, strlen(ass_line),
-                                      start_time, duration);
-                }
-            }
-        }
-        av_packet_unref(&pkt);
-        av_frame_free(&sub);
+    for (j = 0; j < fmt->nb_streams; j++)
+        if (j != sid)
+            fmt->streams[j]->discard = AVDISCARD_ALL;
+
+    ass->pkt = av_packet_alloc();
+    ass->sub = av_frame_alloc();
+    if (!ass->pkt || !ass->sub) {
+        ret = AVERROR(ENOMEM);
+        goto end;
     }
+    ass->fmt          = fmt;
+    ass->dec_ctx      = dec_ctx;
+    ass->sid          = sid;
+    ass->read_time_ms = INT64_MIN;
+    fmt     = NULL;
+    dec_ctx = NULL;
+
+    /* Without lookahead, push all the events into the renderer (libass) now,
+       otherwise they are read while the video frames are filtered. */
+    if (!ass->lookahead)
+        ret = read_events(ctx, INT64_MAX);
 
 end:
     av_dict_free(&codec_opts);
@@ -61,16 +61,17 @@ AVFrame *ff_default_get_video_buffer2(AVFilterLink *link, int w, int h, int alig
         return frame;
     }
 
+    ff_link_pool_lock(link);
     if (!link->frame_pool) {
         link->frame_pool = ff_frame_pool_video_init(av_buffer_allocz, w, h,
                                                     link->format, align);
         if (!link->frame_pool)
-            return NULL;
+            goto fail;
     } else {
         if (ff_frame_pool_get_video_config(link->frame_pool,
                                            &pool_width, &pool_height,
                                            &pool_format, &pool_align) < 0) {
-            return NULL;
+            goto fail;
         }
 
         if (pool_width != w || pool_height != h ||
@@ -80,11 +81,15 @@ AVFrame *ff_default_get_video_buffer2(AVFilterLink *link, int w, int h, int alig
             link->frame_pool = ff_frame_pool_video_init(av_buffer_allocz, w, h,
                                                         link->format, align);
             if (!link->frame_pool)
-                return NULL;
+                goto fail;
         }
     }
 
     frame = ff_frame_pool_get(link->frame_pool);
+    if (frame)
+        link->frame_count_alloc++;
+fail:
+    ff_link_pool_unlock(link);
     if (!frame)
         return NULL;
 
@@ -39,6 +39,7 @@
 #include "libavutil/time_internal.h"
 
 #include "libavcodec/avcodec.h"
+#include "libavcodec/packet_internal.h"
 
 #include "av1.h"
 #include "avc.h"
@@ -60,6 +61,7 @@ typedef enum {
     SEGMENT_TYPE_AUTO = 0,
     SEGMENT_TYPE_MP4,
     SEGMENT_TYPE_WEBM,
+    SEGMENT_TYPE_WEBVTT,
     SEGMENT_TYPE_NB
 } SegmentType;
 
@@ -143,6 +145,7 @@ typedef struct OutputStream {
     int64_t gop_size;
     AVRational sar;
     int coding_dependency;
+    PacketList cues;  /* cues of the current WebVTT segment */
 } OutputStream;
 
 typedef struct DASHContext {
@@ -212,6 +215,8 @@ static struct codec_string {
     { AV_CODEC_ID_VORBIS, "vorbis" },
     { AV_CODEC_ID_OPUS, "opus" },
     { AV_CODEC_ID_FLAC, "flac" },
+    { AV_CODEC_ID_WEBVTT, "wvtt" },
+    { AV_CODEC_ID_TTML, "stpp" },
     { 0, NULL }
 };
 
@@ -222,6 +227,7 @@ static struct format_string {
     { SEGMENT_TYPE_AUTO, "auto" },
     { SEGMENT_TYPE_MP4, "mp4" },
     { SEGMENT_TYPE_WEBM, "webm" },
+    { SEGMENT_TYPE_WEBVTT, "webvtt" },
     { 0, NULL }
 };
 
@@ -277,6 +283,7 @@ static const char *get_extension_str(SegmentType type, int single_file)
 
     case SEGMENT_TYPE_MP4:  return single_file ? "mp4" : "m4s";
     case SEGMENT_TYPE_WEBM: return "webm";
+    case SEGMENT_TYPE_WEBVTT: return "vtt";
     default: return NULL;
     }
 }
@@ -292,6 +299,13 @@ static int handle_io_open_error(AVFormatContext *s, int err, char *url) {
 
 static inline SegmentType select_segment_type(SegmentType segment_type, enum AVCodecID codec_id)
 {
+    // WebVTT goes into plain WebVTT segments unless mp4 is requested
+    // explicitly, TTML is only supported in mp4.
+    if (codec_id == AV_CODEC_ID_WEBVTT)
+        return segment_type == SEGMENT_TYPE_MP4 ? SEGMENT_TYPE_MP4 : SEGMENT_TYPE_WEBVTT;
+    if (codec_id == AV_CODEC_ID_TTML)
+        return SEGMENT_TYPE_MP4;
+
     if (segment_type == SEGMENT_TYPE_AUTO) {
         if (codec_id == AV_CODEC_ID_OPUS || codec_id == AV_CODEC_ID_VORBIS ||
             codec_id == AV_CODEC_ID_VP8 || codec_id == AV_CODEC_ID_VP9) {
@@ -307,11 +321,20 @@ static inline SegmentType select_segment_type(SegmentType segment_type, enum AVC
 static int init_segment_types(AVFormatContext *s)
 {
     DASHContext *c = s->priv_data;
-    int has_mp4_streams = 0;
+    int has_mp4_streams = 0, has_subtitle_only = 1;
     for (int i = 0; i < s->nb_streams; ++i) {
         OutputStream *os = &c->streams[i];
+        AVCodecParameters *par = s->streams[i]->codecpar;
         SegmentType segment_type = select_segment_type(
-            c->segment_type_option, s->streams[i]->codecpar->codec_id);
+            c->segment_type_option, par->codec_id);
+        if (par->codec_type == AVMEDIA_TYPE_SUBTITLE &&
+            par->codec_id != AV_CODEC_ID_WEBVTT &&
+            par->codec_id != AV_CODEC_ID_TTML) {
+            av_log(s, AV_LOG_ERROR, "Subtitle codec %s of stream %d is not supported, "
+                   "use webvtt or ttml\n", avcodec_get_name(par->codec_id), i);
+            return AVERROR(EINVAL);
+        }
+        has_subtitle_only &= par->codec_type == AVMEDIA_TYPE_SUBTITLE;
         os->segment_type = segment_type;
         os->format_name = get_format_str(segment_type);
         if (!os->format_name) {
@@ -327,6 +350,13 @@ static int init_segment_types(AVFormatContext *s)
         has_mp4_streams |= segment_type == SEGMENT_TYPE_MP4;
     }
 
+    // Subtitle segments follow the segments of the other streams
+    if (has_subtitle_only) {
+        av_log(s, AV_LOG_ERROR, "Subtitle streams need an audio or video stream "
+               "to define the segments\n");
+        return AVERROR(EINVAL);
+    }
+
     if (c->hls_playlist && !has_mp4_streams) {
          av_log(s, AV_LOG_WARNING, "No mp4 streams, disabling HLS manifest generation\n");
          c->hls_playlist = 0;
@@ -449,6 +479,7 @@ static void set_codec_str(AVFormatContext *s, AVCodecParameters *par,
 static int flush_dynbuf(DASHContext *c, OutputStream *os, int *range_length)
 {
     uint8_t *buffer;
+    int ret;
 
     if (!os->ctx->pb) {
         return AVERROR(EINVAL);
@@ -468,7 +499,13 @@ static int flush_dynbuf(DASHContext *c, OutputStream *os, int *range_length)
         av_free(buffer);
 
         // re-open buffer
-        return avio_open_dyn_buf(&os->ctx->pb);
+        ret = avio_open_dyn_buf(&os->ctx->pb);
+        if (ret < 0)
+            return ret;
+        // every WebVTT segment is a complete file
+        if (os->segment_type == SEGMENT_TYPE_WEBVTT)
+            avio_write(os->ctx->pb, "WEBVTT\n", 7);
+        return 0;
     } else {
         *range_length = avio_tell(os->ctx->pb) - os->pos;
         return 0;
@@ -524,7 +561,8 @@ static void write_hls_media_playlist(OutputStream *os, AVFormatContext *s,
     get_start_index_number(os, c, &start_index, &start_number);
 
     if (!c->hls_playlist || start_index >= os->nb_segments ||
-        os->segment_type != SEGMENT_TYPE_MP4)
+        os->segment_type != SEGMENT_TYPE_MP4 ||
+        os->ctx->streams[0]->codecpar->codec_type == AVMEDIA_TYPE_SUBTITLE)
         return;
 
     get_hls_playlist_name(filename_hls, sizeof(filename_hls),
@@ -637,6 +675,7 @@ static void dash_free(AVFormatContext *s)
         av_freep(&os->single_file_name);
         av_freep(&os->init_seg_name);
         av_freep(&os->media_seg_name);
+        avpriv_packet_list_free(&os->cues);
     }
     av_freep(&c->streams);
 
@@ -663,7 +702,10 @@ static void output_segment_list(OutputStream *os, AVIOContext *out, AVFormatCont
         if (c->streaming && os->availability_time_offset && !final)
             avio_printf(out, "availabilityTimeComplete=\"false\" ");
 
-        avio_printf(out, "initialization=\"%s\" media=\"%s\" startNumber=\"%d\"", os->init_seg_name, os->media_seg_name, c->use_timeline ? start_number : 1);
+        // WebVTT segments are self-contained
+        if (os->segment_type != SEGMENT_TYPE_WEBVTT)
+            avio_printf(out, "initialization=\"%s\" ", os->init_seg_name);
+        avio_printf(out, "media=\"%s\" startNumber=\"%d\"", os->media_seg_name, c->use_timeline ? start_number : 1);
         if (c->presentation_time_offset)
             avio_printf(out, " presentationTimeOffset=\"%"PRId64"\"", c->presentation_time_offset);
         avio_printf(out, ">\n");
@@ -692,6 +734,9 @@ static void output_segment_list(OutputStream *os, AVIOContext *out, AVFormatCont
             avio_printf(out, "\t\t\t\t\t</SegmentTimeline>\n");
         }
         avio_printf(out, "\t\t\t\t</SegmentTemplate>\n");
+    } else if (c->single_file && os->segment_type == SEGMENT_TYPE_WEBVTT) {
+        // a single WebVTT file is a sidecar file without any segments
+        avio_printf(out, "\t\t\t\t<BaseURL>%s</BaseURL>\n", os->initfile);
     } else if (c->single_file) {
         avio_printf(out, "\t\t\t\t<BaseURL>%s</BaseURL>\n", os->initfile);
         avio_printf(out, "\t\t\t\t<SegmentList timescale=\"%d\" duration=\"%"PRId64"\" startNumber=\"%d\">\n", AV_TIME_BASE, FFMIN(os->seg_duration, os->last_duration), start_number);
@@ -706,7 +751,8 @@ static void output_segment_list(OutputStream *os, AVIOContext *out, AVFormatCont
         avio_printf(out, "\t\t\t\t</SegmentList>\n");
     } else {
         avio_printf(out, "\t\t\t\t<SegmentList timescale=\"%d\" duration=\"%"PRId64"\" startNumber=\"%d\">\n", AV_TIME_BASE, FFMIN(os->seg_duration, os->last_duration), start_number);
-        avio_printf(out, "\t\t\t\t\t<Initialization sourceURL=\"%s\" />\n", os->initfile);
+        if (os->segment_type != SEGMENT_TYPE_WEBVTT)
+            avio_printf(out, "\t\t\t\t\t<Initialization sourceURL=\"%s\" />\n", os->initfile);
         for (i = start_index; i < os->nb_segments; i++) {
             Segment *seg = os->segments[i];
             avio_printf(out, "\t\t\t\t\t<SegmentURL media=\"%s\" />\n", seg->file);
@@ -799,10 +845,17 @@ static int write_adaptation_set(AVFormatContext *s, AVIOContext *out, int as_ind
     DASHContext *c = s->priv_data;
     AdaptationSet *as = &c->as[as_index];
     AVDictionaryEntry *lang, *role;
+    const char *content_type;
     int i;
 
+    switch (as->media_type) {
+    case AVMEDIA_TYPE_VIDEO:    content_type = "video"; break;
+    case AVMEDIA_TYPE_SUBTITLE: content_type = "text";  break;
+    default:                    content_type = "audio"; break;
+    }
+
     avio_printf(out, "\t\t<AdaptationSet id=\"%d\" contentType=\"%s\" startWithSAP=\"1\" segmentAlignment=\"true\" bitstreamSwitching=\"true\"",
-                as->id, as->media_type == AVMEDIA_TYPE_VIDEO ? "video" : "audio");
+                as->id, content_type);
     if (as->media_type == AVMEDIA_TYPE_VIDEO && as->max_frame_rate.num && !as->ambiguous_frame_rate && av_cmp_q(as->min_frame_rate, as->max_frame_rate) < 0)
         avio_printf(out, " maxFrameRate=\"%d/%d\"", as->max_frame_rate.num, as->max_frame_rate.den);
     else if (as->media_type == AVMEDIA_TYPE_VIDEO && as->max_frame_rate.num && !as->ambiguous_frame_rate && !av_cmp_q(as->min_frame_rate, as->max_frame_rate))
@@ -859,6 +912,13 @@ static int write_adaptation_set(AVFormatContext *s, AVIOContext *out, int as_ind
             if (!os->coding_dependency)
                 avio_printf(out, " codingDependency=\"false\"");
             avio_printf(out, ">\n");
+        } else if (as->media_type == AVMEDIA_TYPE_SUBTITLE) {
+            if (os->segment_type == SEGMENT_TYPE_WEBVTT)
+                avio_printf(out, "\t\t\t<Representation id=\"%d\" mimeType=\"text/vtt\"%s>\n",
+                    i, bandwidth_str);
+            else
+                avio_printf(out, "\t\t\t<Representation id=\"%d\" mimeType=\"application/mp4\" codecs=\"%s\"%s>\n",
+                    i, os->codec_str, bandwidth_str);
         } else {
             avio_printf(out, "\t\t\t<Representation id=\"%d\" mimeType=\"audio/%s\" codecs=\"%s\"%s audioSamplingRate=\"%d\">\n",
                 i, os->format_name, os->codec_str, bandwidth_str, s->streams[i]->codecpar->sample_rate);
@@ -1066,9 +1126,10 @@ static int parse_adaptation_sets(AVFormatContext *s)
             snprintf(idx_str, sizeof(idx_str), "%.*s", n, p);
             p += n;
 
-            // if value is "a" or "v", map all streams of that type
-            if (as->media_type == AVMEDIA_TYPE_UNKNOWN && (idx_str[0] == 'v' || idx_str[0] == 'a')) {
-                enum AVMediaType type = (idx_str[0] == 'v') ? AVMEDIA_TYPE_VIDEO : AVMEDIA_TYPE_AUDIO;
+            // if value is "a", "v" or "s", map all streams of that type
+            if (as->media_type == AVMEDIA_TYPE_UNKNOWN && (idx_str[0] == 'v' || idx_str[0] == 'a' || idx_str[0] == 's')) {
+                enum AVMediaType type = (idx_str[0] == 'v') ? AVMEDIA_TYPE_VIDEO :
+                                        (idx_str[0] == 'a') ? AVMEDIA_TYPE_AUDIO : AVMEDIA_TYPE_SUBTITLE;
                 av_log(s, AV_LOG_DEBUG, "Map all streams of type %s\n", idx_str);
 
                 for (i = 0; i < s->nb_streams; i++) {
@@ -1496,7 +1557,7 @@ static int dash_init(AVFormatContext *s)
         char filename[1024];
 
         os->bit_rate = s->streams[i]->codecpar->bit_rate;
-        if (!os->bit_rate) {
+        if (!os->bit_rate && s->streams[i]->codecpar->codec_type != AVMEDIA_TYPE_SUBTITLE) {
             int level = s->strict_std_compliance >= FF_COMPLIANCE_STRICT ?
                         AV_LOG_ERROR : AV_LOG_WARNING;
             av_log(s, level, "No bit rate set for stream %d\n", i);
@@ -1559,6 +1620,9 @@ static int dash_init(AVFormatContext *s)
         avcodec_parameters_copy(st->codecpar, s->streams[i]->codecpar);
         st->sample_aspect_ratio = s->streams[i]->sample_aspect_ratio;
         st->time_base = s->streams[i]->time_base;
+        // the WebVTT muxer only sets its time base when writing the header
+        if (os->segment_type == SEGMENT_TYPE_WEBVTT)
+            st->time_base = (AVRational){ 1, 1000 };
         st->avg_frame_rate = s->streams[i]->avg_frame_rate;
         ctx->avoid_negative_ts = s->avoid_negative_ts;
         ctx->flags = s->flags;
@@ -1579,7 +1643,7 @@ static int dash_init(AVFormatContext *s)
             if (os->single_file_name)
                 ff_dash_fill_tmpl_params(os->initfile, sizeof(os->initfile), os->single_file_name, i, 0, os->bit_rate, 0);
             else
-                snprintf(os->initfile, sizeof(os->initfile), "%s-stream%d.%s", basename, i, os->format_name);
+                snprintf(os->initfile, sizeof(os->initfile), "%s-stream%d.%s", basename, i, os->extension_name);
         } else {
             ff_dash_fill_tmpl_params(os->initfile, sizeof(os->initfile), os->init_seg_name, i, 0, os->bit_rate, 0);
         }
@@ -1588,7 +1652,8 @@ static int dash_init(AVFormatContext *s)
         if (!c->single_file) {
             if ((ret = avio_open_dyn_buf(&ctx->pb)) < 0)
                 return ret;
-            ret = s->io_open(s, &os->out, filename, AVIO_FLAG_WRITE, &opts);
+            if (os->segment_type != SEGMENT_TYPE_WEBVTT)
+                ret = s->io_open(s, &os->out, filename, AVIO_FLAG_WRITE, &opts);
         } else {
             ctx->url = av_strdup(filename);
             ret = avio_open2(&ctx->pb, filename, AVIO_FLAG_WRITE, NULL, &opts);
@@ -1608,6 +1673,9 @@ static int dash_init(AVFormatContext *s)
         os->seg_duration = as->seg_duration;
         os->frag_duration = as->frag_duration;
         os->frag_type = as->frag_type;
+        // Subtitle samples are only complete at the end of the segment
+        if (st->codecpar->codec_type == AVMEDIA_TYPE_SUBTITLE)
+            os->frag_type = FRAG_TYPE_NONE;
 
         c->max_segment_duration = FFMAX(c->max_segment_duration, as->seg_duration);
 
@@ -1652,7 +1720,7 @@ static int dash_init(AVFormatContext *s)
                 av_dict_set_int(&opts, "frag_duration", os->frag_duration, 0);
             if (c->write_prft)
                 av_dict_set(&opts, "write_prft", "wallclock", 0);
-        } else {
+        } else if (os->segment_type == SEGMENT_TYPE_WEBM) {
             av_dict_set_int(&opts, "cluster_time_limit", c->seg_duration / 1000, 0);
             av_dict_set_int(&opts, "cluster_size_limit", 5 * 1024 * 1024, 0); // set a large cluster size limit
             av_dict_set_int(&opts, "dash", 1, 0);
@@ -1744,7 +1812,11 @@ static int dash_write_header(AVFormatContext *s)
         // Flush init segment
         // Only for WebM segment, since for mp4 delay_moov is set and
         // the init segment is thus flushed after the first packets.
-        if (os->segment_type == SEGMENT_TYPE_WEBM &&
+        // Subtitles in mp4 are an exception, their samples are only
+        // written when the fragment is flushed.
+        if ((os->segment_type == SEGMENT_TYPE_WEBM ||
+             (os->segment_type == SEGMENT_TYPE_MP4 &&
+              s->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_SUBTITLE)) &&
             (ret = flush_init_segment(s, os)) < 0)
             return ret;
     }
@@ -1910,6 +1982,98 @@ static inline void dashenc_delete_media_segments(AVFormatContext *s, OutputStrea
     memmove(os->segments, os->segments + remove_count, os->nb_segments * sizeof(*os->segments));
 }
 
+static int dash_write_packet(AVFormatContext *s, AVPacket *pkt);
+
+/*
+ * Subtitle segments end where the segments of the stream triggering the
+ * flush end. Write an empty packet at that time, so that a segment is
+ * written even if no cue falls into it, and the mp4 muxer completes its
+ * samples up to there. Cues lasting longer are continued in the next
+ * segment by the mp4 muxer.
+ */
+static int write_subtitle_segment_end(AVFormatContext *s, int index, int stream)
+{
+    DASHContext *c = s->priv_data;
+    OutputStream *os = &c->streams[index];
+    AVStream *st = s->streams[index];
+    int64_t end = AV_NOPTS_VALUE;
+    AVPacket *pkt;
+    int ret;
+
+    if (stream >= 0) {
+        end = av_rescale_q(c->streams[stream].last_pts,
+                           s->streams[stream]->time_base, st->time_base);
+    } else {
+        for (int i = 0; i < s->nb_streams; i++) {
+            if (s->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_SUBTITLE ||
+                c->streams[i].max_pts == AV_NOPTS_VALUE)
+                continue;
+            end = FFMAX(end, av_rescale_q(c->streams[i].max_pts,
+                                          s->streams[i]->time_base,
+                                          st->time_base));
+        }
+    }
+    if (end == AV_NOPTS_VALUE || (os->max_pts != AV_NOPTS_VALUE &&
+        end <= (os->packets_written ? os->start_pts : os->max_pts)))
+        return 0;
+
+    pkt = av_packet_alloc();
+    if (!pkt)
+        return AVERROR(ENOMEM);
+    pkt->pts = pkt->dts = end;
+    pkt->stream_index = index;
+    ret = dash_write_packet(s, pkt);
+    av_packet_free(&pkt);
+    if (ret < 0)
+        return ret;
+
+    os->max_pts = end;
+
+    // Keep the cues lasting beyond the end of the segment, to repeat
+    // them in the next one.
+    if (os->segment_type == SEGMENT_TYPE_WEBVTT) {
+        PacketList cues = os->cues;
+        os->cues = (PacketList){ 0 };
+        pkt = av_packet_alloc();
+        if (!pkt)
+            ret = AVERROR(ENOMEM);
+        while (ret >= 0 && !avpriv_packet_list_get(&cues, pkt)) {
+            if (pkt->pts + pkt->duration > end)
+                ret = avpriv_packet_list_put(&os->cues, pkt, NULL, 0);
+            av_packet_unref(pkt);
+        }
+        avpriv_packet_list_free(&cues);
+        av_packet_free(&pkt);
+    }
+
+    return ret;
+}
+
+static int repeat_subtitle_cues(AVFormatContext *s, int index)
+{
+    DASHContext *c = s->priv_data;
+    OutputStream *os = &c->streams[index];
+    PacketList cues = os->cues;
+    AVPacket *pkt;
+    int ret = 0;
+
+    if (!cues.head)
+        return 0;
+
+    pkt = av_packet_alloc();
+    if (!pkt)
+        return AVERROR(ENOMEM);
+    os->cues = (PacketList){ 0 };
+    while (ret >= 0 && !avpriv_packet_list_get(&cues, pkt)) {
+        ret = dash_write_packet(s, pkt);
+        av_packet_unref(pkt);
+    }
+    avpriv_packet_list_free(&cues);
+    av_packet_free(&pkt);
+
+    return ret;
+}
+
 static int dash_flush(AVFormatContext *s, int final, int stream)
 {
     DASHContext *c = s->priv_data;
@@ -1940,24 +2104,38 @@ static int dash_flush(AVFormatContext *s, int final, int stream)
         int range_length, index_length = 0;
         int64_t duration;
 
-        if (!os->packets_written)
-            continue;
-
         // Flush the single stream that got a keyframe right now.
         // Flush all audio streams as well, in sync with video keyframes,
         // but not the other video streams.
+        // Subtitle streams are flushed with the video streams, or with
+        // the audio streams if there is no video.
         if (stream >= 0 && i != stream) {
-            if (s->streams[stream]->codecpar->codec_type != AVMEDIA_TYPE_VIDEO &&
-                s->streams[i]->codecpar->codec_type != AVMEDIA_TYPE_VIDEO)
-                continue;
-            if (s->streams[i]->codecpar->codec_type != AVMEDIA_TYPE_AUDIO)
-                continue;
-            // Make sure we don't flush audio streams multiple times, when
-            // all video streams are flushed one at a time.
-            if (c->has_video && os->segment_index > cur_flush_segment_index)
-                continue;
+            if (s->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_SUBTITLE) {
+                if (c->has_video &&
+                    s->streams[stream]->codecpar->codec_type != AVMEDIA_TYPE_VIDEO)
+                    continue;
+                if (os->segment_index > cur_flush_segment_index)
+                    continue;
+            } else {
+                if (s->streams[stream]->codecpar->codec_type != AVMEDIA_TYPE_VIDEO &&
+                    s->streams[i]->codecpar->codec_type != AVMEDIA_TYPE_VIDEO)
+                    continue;
+                if (s->streams[i]->codecpar->codec_type != AVMEDIA_TYPE_AUDIO)
+                    continue;
+                // Make sure we don't flush audio streams multiple times, when
+                // all video streams are flushed one at a time.
+                if (c->has_video && os->segment_index > cur_flush_segment_index)
+                    continue;
+            }
         }
 
+        if (st->codecpar->codec_type == AVMEDIA_TYPE_SUBTITLE &&
+            (ret = write_subtitle_segment_end(s, i, stream)) < 0)
+            break;
+
+        if (!os->packets_written)
+            continue;
+
         if (c->single_file)
             snprintf(os->full_path, sizeof(os->full_path), "%s%s", c->dirname, os->initfile);
 
@@ -1994,6 +2172,9 @@ static int dash_flush(AVFormatContext *s, int final, int stream)
         av_log(s, AV_LOG_VERBOSE, "Representation %d media segment %d written to: %s\n", i, os->segment_index, os->full_path);
 
         os->pos += range_length;
+
+        if (!final && (ret = repeat_subtitle_cues(s, i)) < 0)
+            break;
     }
 
     if (c->window_size) {
@@ -2070,6 +2251,45 @@ static int dash_parse_prft(DASHContext *c, AVPacket *pkt)
     return 0;
 }
 
+/*
+ * Start the first subtitle segment together with the other streams, and
+ * let the mp4 muxer start the track there as well.
+ */
+static int start_subtitle_stream(AVFormatContext *s, AVPacket *pkt)
+{
+    DASHContext *c = s->priv_data;
+    OutputStream *os = &c->streams[pkt->stream_index];
+    AVStream *st = s->streams[pkt->stream_index];
+    int64_t start = pkt->pts;
+    AVPacket *start_pkt;
+    int ret;
+
+    // Negative start times of the other streams (e.g. encoder delay) are
+    // of no use for subtitles.
+    for (int i = 0; i < s->nb_streams; i++) {
+        if (s->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_SUBTITLE ||
+            c->streams[i].first_pts == AV_NOPTS_VALUE)
+            continue;
+        start = FFMIN(start, FFMAX(av_rescale_q(c->streams[i].first_pts,
+                                                s->streams[i]->time_base,
+                                                st->time_base), 0));
+    }
+    os->max_pts = start;
+
+    if (os->segment_type != SEGMENT_TYPE_MP4)
+        return 0;
+
+    start_pkt = av_packet_alloc();
+    if (!start_pkt)
+        return AVERROR(ENOMEM);
+    start_pkt->pts = start_pkt->dts = start;
+    start_pkt->stream_index = pkt->stream_index;
+    ret = ff_write_chained(os->ctx, 0, start_pkt, s, 0);
+    av_packet_free(&start_pkt);
+
+    return ret;
+}
+
 static int dash_write_packet(AVFormatContext *s, AVPacket *pkt)
 {
     DASHContext *c = s->priv_data;
@@ -2083,25 +2303,45 @@ static int dash_write_packet(AVFormatContext *s, AVPacket *pkt)
     if (ret < 0)
         return ret;
 
+    if (st->codecpar->codec_type == AVMEDIA_TYPE_SUBTITLE) {
+        int64_t seg_start;
+
+        if (os->max_pts == AV_NOPTS_VALUE &&
+            (ret = start_subtitle_stream(s, pkt)) < 0)
+            return ret;
+
+        // Cut cues starting before the current segment
+        seg_start = os->packets_written ? os->start_pts : os->max_pts;
+        if (pkt->pts < seg_start) {
+            if (pkt->pts + pkt->duration <= seg_start)
+                return 0;
+            pkt->duration -= seg_start - pkt->pts;
+            pkt->pts = pkt->dts = seg_start;
+        }
+    }
+
     // Fill in a heuristic guess of the packet duration, if none is available.
     // The mp4 muxer will do something similar (for the last packet in a fragment)
     // if nothing is set (setting it for the other packets doesn't hurt).
     // By setting a nonzero duration here, we can be sure that the mp4 muxer won't
     // invoke its heuristic (this doesn't have to be identical to that algorithm),
     // so that we know the exact timestamps of fragments.
-    if (!pkt->duration && os->last_dts != AV_NOPTS_VALUE)
+    // Subtitle durations are not related to the next packet.
+    if (!pkt->duration && os->last_dts != AV_NOPTS_VALUE &&
+        st->codecpar->codec_type != AVMEDIA_TYPE_SUBTITLE)
         pkt->duration = pkt->dts - os->last_dts;
     os->last_dts = pkt->dts;
 
     // If forcing the stream to start at 0, the mp4 muxer will set the start
     // timestamps to 0. Do the same here, to avoid mismatches in duration/timestamps.
     if (os->first_pts == AV_NOPTS_VALUE &&
-        s->avoid_negative_ts == AVFMT_AVOID_NEG_TS_MAKE_ZERO) {
+        s->avoid_negative_ts == AVFMT_AVOID_NEG_TS_MAKE_ZERO &&
+        st->codecpar->codec_type != AVMEDIA_TYPE_SUBTITLE) {
         pkt->pts -= pkt->dts;
         pkt->dts  = 0;
     }
 
-    if (c->write_prft) {
+    if (c->write_prft && st->codecpar->codec_type != AVMEDIA_TYPE_SUBTITLE) {
         ret = dash_parse_prft(c, pkt);
         if (ret < 0)
             return ret;
@@ -2163,7 +2403,9 @@ static int dash_write_packet(AVFormatContext *s, AVPacket *pkt)
         os->coding_dependency |= os->parser->pict_type != AV_PICTURE_TYPE_I;
     }
 
+    // Subtitle segments are ended together with the other streams
     if (pkt->flags & AV_PKT_FLAG_KEY && os->packets_written &&
+        st->codecpar->codec_type != AVMEDIA_TYPE_SUBTITLE &&
         av_compare_ts(elapsed_duration, st->time_base,
                       seg_end_duration, AV_TIME_BASE_Q) >= 0) {
         if (!c->has_video || st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
@@ -2234,15 +2476,27 @@ static int dash_write_packet(AVFormatContext *s, AVPacket *pkt)
         c->max_gop_size = FFMAX(c->max_gop_size, os->gop_size);
     }
 
-    if ((ret = ff_write_chained(os->ctx, 0, pkt, s, 0)) < 0)
+    // Empty packets only mark the end of a subtitle segment, there is
+    // nothing to write to a WebVTT file for them. Cues are kept to repeat
+    // them in the next segment if they last longer.
+    if (os->segment_type == SEGMENT_TYPE_WEBVTT) {
+        if (pkt->size) {
+            if ((ret = ff_write_chained(os->ctx, 0, pkt, s, 0)) < 0)
+                return ret;
+            if (!c->single_file &&
+                (ret = avpriv_packet_list_put(&os->cues, pkt, av_packet_ref, 0)) < 0)
+                return ret;
+        }
+    } else if ((ret = ff_write_chained(os->ctx, 0, pkt, s, 0)) < 0) {
         return ret;
+    }
 
     os->packets_written++;
     os->total_pkt_size += pkt->size;
     os->total_pkt_duration += pkt->duration;
     os->last_flags = pkt->flags;
 
-    if (!os->init_range_length)
+    if (!os->init_range_length && os->segment_type != SEGMENT_TYPE_WEBVTT)
         flush_init_segment(s, os);
 
     //open the output context when the first frame of a segment is ready
@@ -2319,7 +2573,8 @@ static int dash_write_trailer(AVFormatContext *s)
         for (i = 0; i < s->nb_streams; ++i) {
             OutputStream *os = &c->streams[i];
             dashenc_delete_media_segments(s, os, os->nb_segments);
-            dashenc_delete_segment_file(s, os->initfile);
+            if (os->segment_type != SEGMENT_TYPE_WEBVTT || c->single_file)
+                dashenc_delete_segment_file(s, os->initfile);
             if (c->hls_playlist && os->segment_type == SEGMENT_TYPE_MP4) {
                 char filename[1024];
                 get_hls_playlist_name(filename, sizeof(filename), c->dirname, i);
@@ -2390,7 +2645,7 @@ static const AVOption options[] = {
     { "index_correction", "Enable/Disable segment index correction logic", OFFSET(index_correction), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, E },
     { "format_options","set list of options for the container format (mp4/webm) used for dash", OFFSET(format_options), AV_OPT_TYPE_DICT, {.str = NULL},  0, 0, E},
     { "global_sidx", "Write global SIDX atom. Applicable only for single file, mp4 output, non-streaming mode", OFFSET(global_sidx), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, E },
-    { "dash_segment_type", "set dash segment files type", OFFSET(segment_type_option), AV_OPT_TYPE_INT, {.i64 = SEGMENT_TYPE_AUTO }, 0, SEGMENT_TYPE_NB - 1, E, "segment_type"},
+    { "dash_segment_type", "set dash segment files type", OFFSET(segment_type_option), AV_OPT_TYPE_INT, {.i64 = SEGMENT_TYPE_AUTO }, 0, SEGMENT_TYPE_WEBM, E, "segment_type"},
     { "auto", "select segment file format based on codec", 0, AV_OPT_TYPE_CONST, {.i64 = SEGMENT_TYPE_AUTO }, 0, UINT_MAX,   E, "segment_type"},
     { "mp4", "make segment file in ISOBMFF format", 0, AV_OPT_TYPE_CONST, {.i64 = SEGMENT_TYPE_MP4 }, 0, UINT_MAX,   E, "segment_type"},
     { "webm", "make segment file in WebM format", 0, AV_OPT_TYPE_CONST, {.i64 = SEGMENT_TYPE_WEBM }, 0, UINT_MAX,   E, "segment_type"},
@@ -24,7 +24,9 @@
 #include "libavutil/avstring.h"
 #include "libavutil/file_open.h"
 #include "libavutil/internal.h"
+#include "libavutil/mem.h"
 #include "libavutil/opt.h"
+#include "libavutil/thread.h"
 #include "avio.h"
 #if HAVE_DIRENT_H
 #include <dirent.h>
@@ -38,6 +40,9 @@
 #endif
 #include <sys/stat.h>
 #include <stdlib.h>
+#if CONFIG_LIBURING
+#include <liburing.h>
+#endif
 #include "os_support.h"
 #include "url.h"
 
@@ -70,6 +75,10 @@
 
 /* standard file protocol */
 
+#define HAVE_READAHEAD (HAVE_THREADS && HAVE_PREAD)
+
+typedef struct ReadAhead ReadAhead;
+
 typedef struct FileContext {
     const AVClass *class;
     int fd;
@@ -77,6 +86,10 @@ typedef struct FileContext {
     int blocksize;
     int follow;
     int seekable;
+    int readahead;
+    int readahead_size;
+    int readahead_uring;
+    ReadAhead *ra;
 #if HAVE_DIRENT_H
     DIR *dir;
 #endif
@@ -87,6 +100,9 @@ static const AVOption file_options[] = {
     { "blocksize", "set I/O operation maximum block size", offsetof(FileContext, blocksize), AV_OPT_TYPE_INT, { .i64 = INT_MAX }, 1, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM },
     { "follow", "Follow a file as it is being written", offsetof(FileContext, follow), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
     { "seekable", "Sets if the file is seekable", offsetof(FileContext, seekable), AV_OPT_TYPE_INT, { .i64 = -1 }, -1, 0, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_ENCODING_PARAM },
+    { "readahead", "number of blocks read asynchronously ahead of the read position", offsetof(FileContext, readahead), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 64, AV_OPT_FLAG_DECODING_PARAM },
+    { "readahead_size", "size of the read-ahead blocks", offsetof(FileContext, readahead_size), AV_OPT_TYPE_INT, { .i64 = 1 << 20 }, 4096, 1 << 28, AV_OPT_FLAG_DECODING_PARAM },
+    { "readahead_uring", "use io_uring for read-ahead if available", offsetof(FileContext, readahead_uring), AV_OPT_TYPE_BOOL, { .i64 = 1 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
     { NULL }
 };
 
@@ -109,11 +125,382 @@ static const AVClass pipe_class = {
     .version    = LIBAVUTIL_VERSION_INT,
 };
 
+#if HAVE_READAHEAD
+/*
+ * Read-ahead keeps up to nb_blocks consecutive blocks of the file in flight
+ * or ready, starting with the block containing the read position. They are
+ * read either through io_uring or by a few threads using pread(), which
+ * take the queued blocks in file order.
+ */
+
+#define READAHEAD_MAX_THREADS 4
+
+enum BlockState {
+    BLOCK_FREE,
+    BLOCK_QUEUED,   ///< submitted to io_uring or waiting for a thread
+    BLOCK_RUNNING,  ///< being read by a thread
+    BLOCK_DONE,
+};
+
+typedef struct ReadAheadBlock {
+    int64_t pos;
+    uint8_t *data;
+    int size;       ///< bytes read or AVERROR code, once done
+    enum BlockState state;
+} ReadAheadBlock;
+
+struct ReadAhead {
+    int fd;
+    ReadAheadBlock *blocks;
+    int nb_blocks;
+    int block_size;
+    int head;           ///< block containing pos
+    int nb_used;        ///< non-free blocks, starting at head
+    int64_t pos;        ///< read position
+    int64_t next_pos;   ///< file offset of the next block to queue
+
+    int use_uring;
+#if CONFIG_LIBURING
+    struct io_uring ring;
+    int uring_error;    ///< io_uring failed, no read can be waited for
+#endif
+
+    pthread_t *threads;
+    int nb_threads;
+    pthread_mutex_t mutex;
+    pthread_cond_t work_cond;
+    pthread_cond_t done_cond;
+    int abort;
+};
+
+static void *readahead_worker(void *arg)
+{
+    ReadAhead *ra = arg;
+
+    pthread_mutex_lock(&ra->mutex);
+    while (!ra->abort) {
+        ReadAheadBlock *b = NULL;
+        ssize_t ret;
+
+        /* take the queued block closest to the read position */
+        for (int i = 0; i < ra->nb_blocks; i++)
+            if (ra->blocks[i].state == BLOCK_QUEUED &&
+                (!b || ra->blocks[i].pos < b->pos))
+                b = &ra->blocks[i];
+        if (!b) {
+            pthread_cond_wait(&ra->work_cond, &ra->mutex);
+            continue;
+        }
+        b->state = BLOCK_RUNNING;
+        pthread_mutex_unlock(&ra->mutex);
+
+        do {
+            ret = pread(ra->fd, b->data, ra->block_size, b->pos);
+        } while (ret < 0 && errno == EINTR);
+
+        pthread_mutex_lock(&ra->mutex);
+        b->size  = ret < 0 ? AVERROR(errno) : ret;
+        b->state = BLOCK_DONE;
+        pthread_cond_broadcast(&ra->done_cond);
+    }
+    pthread_mutex_unlock(&ra->mutex);
+    return NULL;
+}
+
+static ReadAheadBlock *readahead_block(ReadAhead *ra, int i)
+{
+    return &ra->blocks[(ra->head + i) % ra->nb_blocks];
+}
+
+#if CONFIG_LIBURING
+/* Wait for one io_uring completion, submitting the pending reads first. */
+static int readahead_reap(ReadAhead *ra)
+{
+    struct io_uring_cqe *cqe;
+    ReadAheadBlock *b;
+    int ret;
+
+    /* left over by a failed or short io_uring_submit() */
+    if (io_uring_sq_ready(&ra->ring)) {
+        ret = io_uring_submit(&ra->ring);
+        if (ret < 0)
+            return ret;
+    }
+    do {
+        ret = io_uring_wait_cqe(&ra->ring, &cqe);
+    } while (ret == -EINTR);
+    if (ret < 0)
+        return ret;
+    b = io_uring_cqe_get_data(cqe);
+    if (b) { /* NULL for cancel requests */
+        b->size  = cqe->res == -ECANCELED ? 0 : cqe->res;
+        b->state = BLOCK_DONE;
+    }
+    io_uring_cqe_seen(&ra->ring, cqe);
+    return 0;
+}
+#endif
+
+/* Queue reads for all free blocks. */
+static void readahead_fill(ReadAhead *ra)
+{
+#if CONFIG_LIBURING
+    int submit = 0;
+#endif
+
+    if (!ra->use_uring)
+        pthread_mutex_lock(&ra->mutex);
+    while (ra->nb_used < ra->nb_blocks) {
+        ReadAheadBlock *b = readahead_block(ra, ra->nb_used);
+#if CONFIG_LIBURING
+        if (ra->use_uring) {
+            struct io_uring_sqe *sqe = io_uring_get_sqe(&ra->ring);
+            if (!sqe)
+                break;
+            io_uring_prep_read(sqe, ra->fd, b->data, ra->block_size, ra->next_pos);
+            io_uring_sqe_set_data(sqe, b);
+            submit = 1;
+        }
+#endif
+        b->pos   = ra->next_pos;
+        b->state = BLOCK_QUEUED;
+        ra->next_pos += ra->block_size;
+        ra->nb_used++;
+    }
+#if CONFIG_LIBURING
+    if (submit)
+        io_uring_submit(&ra->ring);
+#endif
+    if (!ra->use_uring) {
+        pthread_cond_broadcast(&ra->work_cond);
+        pthread_mutex_unlock(&ra->mutex);
+    }
+}
+
+/* Wait until the read of block i is done. */
+static void readahead_wait(ReadAhead *ra, int i)
+{
+    ReadAheadBlock *b = readahead_block(ra, i);
+
+#if CONFIG_LIBURING
+    if (ra->use_uring) {
+        while (b->state != BLOCK_DONE) {
+            int ret = ra->uring_error ? ra->uring_error : readahead_reap(ra);
+            if (ret < 0) {
+                ra->uring_error = ret;
+                b->size  = ret;
+                b->state = BLOCK_DONE;
+            }
+        }
+        return;
+    }
+#endif
+    pthread_mutex_lock(&ra->mutex);
+    while (b->state != BLOCK_DONE)
+        pthread_cond_wait(&ra->done_cond, &ra->mutex);
+    pthread_mutex_unlock(&ra->mutex);
+}
+
+/* Free the block at head, cancelling its read if possible. */
+static void readahead_release(ReadAhead *ra)
+{
+    ReadAheadBlock *b = readahead_block(ra, 0);
+
+#if CONFIG_LIBURING
+    if (ra->use_uring) {
+        if (b->state == BLOCK_QUEUED) {
+            struct io_uring_sqe *sqe = io_uring_get_sqe(&ra->ring);
+            if (sqe) {
+                io_uring_prep_cancel(sqe, b, 0);
+                io_uring_sqe_set_data(sqe, NULL);
+                io_uring_submit(&ra->ring);
+            }
+        }
+        readahead_wait(ra, 0);
+        b->state = BLOCK_FREE;
+    } else
+#endif
+    {
+        pthread_mutex_lock(&ra->mutex);
+        /* reads not yet picked up by a thread are simply dropped */
+        while (b->state == BLOCK_RUNNING)
+            pthread_cond_wait(&ra->done_cond, &ra->mutex);
+        b->state = BLOCK_FREE;
+        pthread_mutex_unlock(&ra->mutex);
+    }
+    ra->head = (ra->head + 1) % ra->nb_blocks;
+    ra->nb_used--;
+}
+
+/* Drop all blocks and restart reading ahead from pos. */
+static void readahead_reset(ReadAhead *ra, int64_t pos)
+{
+    while (ra->nb_used)
+        readahead_release(ra);
+    ra->pos = ra->next_pos = pos;
+}
+
+static int readahead_read(ReadAhead *ra, unsigned char *buf, int size)
+{
+    ReadAheadBlock *b;
+    int64_t offset;
+
+#if CONFIG_LIBURING
+    /* the blocks may still be written to by reads never reaped */
+    if (ra->uring_error)
+        return ra->uring_error;
+#endif
+    readahead_fill(ra);
+    readahead_wait(ra, 0);
+    b = readahead_block(ra, 0);
+    if (b->size < 0) {
+        int err = b->size;
+        readahead_reset(ra, ra->pos);
+        return err;
+    }
+
+    offset = ra->pos - b->pos;
+    if (offset >= b->size) {
+        /* short block: end of file, or a partial read to be retried */
+        int eof = !b->size;
+        readahead_reset(ra, ra->pos);
+        return eof ? AVERROR_EOF : readahead_read(ra, buf, size);
+    }
+
+    size = FFMIN(size, b->size - offset);
+    memcpy(buf, b->data + offset, size);
+    ra->pos += size;
+    if (ra->pos == b->pos + ra->block_size)
+        readahead_release(ra);
+    return size;
+}
+
+/* Reuse the blocks at and after pos, drop all others. */
+static void readahead_seek(ReadAhead *ra, int64_t pos)
+{
+    if (!ra->nb_used || pos < readahead_block(ra, 0)->pos || pos >= ra->next_pos) {
+        readahead_reset(ra, pos);
+        return;
+    }
+    while (pos >= readahead_block(ra, 0)->pos + ra->block_size)
+        readahead_release(ra);
+    ra->pos = pos;
+}
+
+static void readahead_free(ReadAhead **pra)
+{
+    ReadAhead *ra = *pra;
+
+    if (!ra)
+        return;
+    if (ra->nb_blocks)
+        readahead_reset(ra, 0);
+#if CONFIG_LIBURING
+    if (ra->use_uring)
+        io_uring_queue_exit(&ra->ring);
+#endif
+    if (ra->nb_threads) {
+        pthread_mutex_lock(&ra->mutex);
+        ra->abort = 1;
+        pthread_cond_broadcast(&ra->work_cond);
+        pthread_mutex_unlock(&ra->mutex);
+        for (int i = 0; i < ra->nb_threads; i++)
+            pthread_join(ra->threads[i], NULL);
+        pthread_cond_destroy(&ra->done_cond);
+        pthread_cond_destroy(&ra->work_cond);
+        pthread_mutex_destroy(&ra->mutex);
+    }
+    for (int i = 0; i < ra->nb_blocks; i++)
+        av_free(ra->blocks[i].data);
+    av_free(ra->blocks);
+    av_free(ra->threads);
+    av_freep(pra);
+}
+
+static int readahead_init(URLContext *h)
+{
+    FileContext *c = h->priv_data;
+    ReadAhead *ra;
+    int ret;
+
+    ra = c->ra = av_mallocz(sizeof(*ra));
+    if (!ra)
+        return AVERROR(ENOMEM);
+    ra->fd         = c->fd;
+    ra->block_size = c->readahead_size;
+    ra->pos = ra->next_pos = lseek(c->fd, 0, SEEK_CUR);
+    if (ra->pos < 0)
+        ra->pos = ra->next_pos = 0;
+
+    ra->blocks = av_calloc(c->readahead, sizeof(*ra->blocks));
+    if (!ra->blocks)
+        goto fail;
+    for (; ra->nb_blocks < c->readahead; ra->nb_blocks++) {
+        ra->blocks[ra->nb_blocks].data = av_malloc(ra->block_size);
+        if (!ra->blocks[ra->nb_blocks].data)
+            goto fail;
+    }
+
+#if CONFIG_LIBURING
+    if (c->readahead_uring) {
+        ret = io_uring_queue_init(2 * ra->nb_blocks, &ra->ring, 0);
+        if (ret >= 0) {
+            ra->use_uring = 1;
+            av_log(h, AV_LOG_VERBOSE, "Reading ahead %d blocks with io_uring\n", ra->nb_blocks);
+            return 0;
+        }
+        av_log(h, AV_LOG_WARNING, "io_uring_queue_init() failed: %s, using threads\n",
+               av_err2str(ret));
+    }
+#endif
+
+    ra->threads = av_calloc(READAHEAD_MAX_THREADS, sizeof(*ra->threads));
+    if (!ra->threads)
+        goto fail;
+    if ((ret = pthread_mutex_init(&ra->mutex, NULL)))
+        goto fail_errno;
+    if ((ret = pthread_cond_init(&ra->work_cond, NULL))) {
+        pthread_mutex_destroy(&ra->mutex);
+        goto fail_errno;
+    }
+    if ((ret = pthread_cond_init(&ra->done_cond, NULL))) {
+        pthread_cond_destroy(&ra->work_cond);
+        pthread_mutex_destroy(&ra->mutex);
+        goto fail_errno;
+    }
+    for (; ra->nb_threads < FFMIN(ra->nb_blocks, READAHEAD_MAX_THREADS); ra->nb_threads++) {
+        ret = pthread_create(&ra->threads[ra->nb_threads], NULL, readahead_worker, ra);
+        if (ret) {
+            if (ra->nb_threads)
+                break;
+            pthread_cond_destroy(&ra->done_cond);
+            pthread_cond_destroy(&ra->work_cond);
+            pthread_mutex_destroy(&ra->mutex);
+            goto fail_errno;
+        }
+    }
+    av_log(h, AV_LOG_VERBOSE, "Reading ahead %d blocks with %d threads\n",
+           ra->nb_blocks, ra->nb_threads);
+    return 0;
+
+fail_errno:
+    readahead_free(&c->ra);
+    return AVERROR(ret);
+fail:
+    readahead_free(&c->ra);
+    return AVERROR(ENOMEM);
+}
+#endif /* HAVE_READAHEAD */
+
 static int file_read(URLContext *h, unsigned char *buf, int size)
 {
     FileContext *c = h->priv_data;
     int ret;
     size = FFMIN(size, c->blocksize);
+#if HAVE_READAHEAD
+    if (c->ra)
+        return readahead_read(c->ra, buf, size);
+#endif
     ret = read(c->fd, buf, size);
     if (ret == 0 && c->follow)
         return AVERROR(EAGAIN);
@@ -242,6 +629,17 @@ static int file_open(URLContext *h, const char *filename, int flags)
     if (c->seekable >= 0)
         h->is_streamed = !c->seekable;
 
+#if HAVE_READAHEAD
+    if (c->readahead && !(flags & AVIO_FLAG_WRITE) && !c->follow &&
+        !h->is_streamed) {
+        int ret = readahead_init(h);
+        if (ret < 0) {
+            close(fd);
+            return ret;
+        }
+    }
+#endif
+
     return 0;
 }
 
@@ -257,6 +655,23 @@ static int64_t file_seek(URLContext *h, int64_t pos, int whence)
         return ret < 0 ? AVERROR(errno) : (S_ISFIFO(st.st_mode) ? 0 : st.st_size);
     }
 
+#if HAVE_READAHEAD
+    if (c->ra) {
+        if (whence == SEEK_CUR) {
+            pos += c->ra->pos;
+        } else if (whence == SEEK_END) {
+            struct stat st;
+            if (fstat(c->fd, &st) < 0)
+                return AVERROR(errno);
+            pos += st.st_size;
+        }
+        if (pos < 0)
+            return AVERROR(EINVAL);
+        readahead_seek(c->ra, pos);
+        return pos;
+    }
+#endif
+
     ret = lseek(c->fd, pos, whence);
 
     return ret < 0 ? AVERROR(errno) : ret;
@@ -265,7 +680,12 @@ static int64_t file_seek(URLContext *h, int64_t pos, int whence)
 static int file_close(URLContext *h)
 {
     FileContext *c = h->priv_data;
-    int ret = close(c->fd);
+    int ret;
+
+#if HAVE_READAHEAD
+    readahead_free(&c->ra);
+#endif
+    ret = close(c->fd);
     return (ret == -1) ? AVERROR(errno) : 0;
 }
 
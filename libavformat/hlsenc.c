@@ -38,8 +38,10 @@
 #include "libavutil/avstring.h"
 #include "libavutil/bprint.h"
 #include "libavutil/intreadwrite.h"
+#include "libavutil/mem.h"
 #include "libavutil/opt.h"
 #include "libavutil/log.h"
+#include "libavutil/thread.h"
 #include "libavutil/time.h"
 #include "libavutil/time_internal.h"
 
@@ -55,6 +57,7 @@
 #include "internal.h"
 #include "mux.h"
 #include "os_support.h"
+#include "subsplit.h"
 
 typedef enum {
     HLS_START_SEQUENCE_AS_START_NUMBER = 0,
@@ -132,6 +135,7 @@ typedef struct VariantStream {
 
     AVFormatContext *avf;
     AVFormatContext *vtt_avf;
+    int vtt_started;    ///< a WebVTT header was written
 
     int has_video;
     int has_subtitle;
@@ -185,6 +189,8 @@ typedef struct VariantStream {
     const char *sgroup;   /* subtitle group name */
     const char *ccgroup;  /* closed caption group name */
     const char *varname;  /* variant name */
+
+    SubSplitContext subsplit;
 } VariantStream;
 
 typedef struct ClosedCaptionsStream {
@@ -193,6 +199,25 @@ typedef struct ClosedCaptionsStream {
     const char *language;   /* closed captions language */
 } ClosedCaptionsStream;
 
+/**
+ * An output written to memory by the muxer and uploaded in the background,
+ * or a rename or deletion of a local file done after the uploads queued
+ * before it, see the io_threads option.
+ */
+typedef struct HLSUpload {
+    struct HLSUpload *next;
+    AVFormatContext *avf;   ///< context whose io_open() is used
+    AVIOContext *pb;        ///< dynamic buffer, until the output is closed
+    char *url;
+    char *new_url;          ///< rename the local file url to this
+    int unlink;             ///< delete the local file url
+    AVDictionary *options;
+    uint8_t *data;
+    int size;
+    int ordered;            ///< started after all earlier uploads are done
+    int64_t seq;
+} HLSUpload;
+
 typedef struct HLSContext {
     const AVClass *class;  // Class for private options.
     int64_t start_sequence;
@@ -218,6 +243,7 @@ typedef struct HLSContext {
     char *baseurl;
     char *vtt_format_options_str;
     char *subtitle_filename;
+    int subtitle_split;     // enum SubSplitMode
     AVDictionary *format_options;
 
     int encrypt;
@@ -257,6 +283,23 @@ typedef struct HLSContext {
     char *headers;
     int has_default_key; /* has DEFAULT field of var_stream_map */
     int has_video_m3u8; /* has video stream m3u8 list */
+
+    int io_threads;
+    HLSUpload **io_open_uploads; /* outputs currently written by the muxer */
+    int nb_io_open_uploads;
+#if HAVE_THREADS
+    pthread_t *io_workers;
+    int nb_io_workers;
+    pthread_mutex_t io_mutex;
+    pthread_cond_t io_cond;
+    HLSUpload *io_queue;
+    HLSUpload **io_queue_tail;
+    int64_t io_seq;          /* sequence number of the next queued upload */
+    int64_t *io_running_seq; /* upload run by each worker, INT64_MAX if none */
+    int io_worker_idx;
+    int io_abort;
+    int io_error;            /* first failed upload */
+#endif
 } HLSContext;
 
 static int strftime_expand(const char *fmt, char **dest)
@@ -282,12 +325,312 @@ static int strftime_expand(const char *fmt, char **dest)
     return r;
 }
 
+static void upload_free(HLSUpload **pup)
+{
+    HLSUpload *up = *pup;
+
+    if (!up)
+        return;
+    ffio_free_dyn_buf(&up->pb);
+    av_free(up->url);
+    av_free(up->new_url);
+    av_dict_free(&up->options);
+    av_free(up->data);
+    av_freep(pup);
+}
+
+#if HAVE_THREADS
+static int upload_run(HLSContext *hls, HLSUpload *up)
+{
+    int ret;
+
+    /* failing renames and deletions are not fatal, as when synchronous */
+    if (up->new_url) {
+        ff_rename(up->url, up->new_url, hls);
+        return 0;
+    }
+    if (up->unlink) {
+        if (unlink(up->url) < 0)
+            av_log(hls, AV_LOG_ERROR, "failed to delete old segment %s: %s\n",
+                   up->url, av_err2str(AVERROR(errno)));
+        return 0;
+    }
+
+    for (int attempt = 0; ; attempt++) {
+        AVDictionary *options = NULL;
+        AVIOContext *pb = NULL;
+
+        ret = av_dict_copy(&options, up->options, 0);
+        if (ret >= 0)
+            ret = up->avf->io_open(up->avf, &pb, up->url, AVIO_FLAG_WRITE, &options);
+        av_dict_free(&options);
+        if (ret >= 0) {
+            int err;
+            avio_write(pb, up->data, up->size);
+            avio_flush(pb);
+            ret = pb->error;
+            err = ff_format_io_close(up->avf, &pb);
+            if (ret >= 0)
+                ret = err;
+        }
+        if (ret >= 0 || attempt)
+            break;
+        av_log(hls, AV_LOG_WARNING, "upload of '%s' failed, will retry with a new http session.\n",
+               up->url);
+    }
+    if (ret < 0)
+        av_log(hls, hls->ignore_io_errors ? AV_LOG_WARNING : AV_LOG_ERROR,
+               "Failed to upload '%s': %s\n", up->url, av_err2str(ret));
+    return ret;
+}
+
+/**
+ * Take the next upload that may start. Playlists may reference any output
+ * queued before them and deletions must not race with the upload of the
+ * same file, so these are ordered: they start once all earlier uploads are
+ * done, and hold back later ordered ones. Other outputs start in queue order.
+ */
+static HLSUpload *upload_next(HLSContext *hls)
+{
+    int64_t oldest_running = INT64_MAX;
+    HLSUpload **pup;
+
+    for (int i = 0; i < hls->io_threads; i++)
+        oldest_running = FFMIN(oldest_running, hls->io_running_seq[i]);
+
+    for (pup = &hls->io_queue; *pup; pup = &(*pup)->next) {
+        HLSUpload *up = *pup;
+        if (up->ordered && (pup != &hls->io_queue || oldest_running < up->seq))
+            continue;
+        *pup = up->next;
+        if (!*pup)
+            hls->io_queue_tail = pup;
+        return up;
+    }
+    return NULL;
+}
+
+static void *upload_worker(void *arg)
+{
+    HLSContext *hls = arg;
+    int idx;
+
+    pthread_mutex_lock(&hls->io_mutex);
+    idx = hls->io_worker_idx++;
+    while (!hls->io_abort) {
+        HLSUpload *up = upload_next(hls);
+        int ret;
+
+        if (!up) {
+            pthread_cond_wait(&hls->io_cond, &hls->io_mutex);
+            continue;
+        }
+        hls->io_running_seq[idx] = up->seq;
+        pthread_mutex_unlock(&hls->io_mutex);
+
+        ret = upload_run(hls, up);
+        upload_free(&up);
+
+        pthread_mutex_lock(&hls->io_mutex);
+        if (ret < 0 && !hls->ignore_io_errors && !hls->io_error)
+            hls->io_error = ret;
+        hls->io_running_seq[idx] = INT64_MAX;
+        pthread_cond_broadcast(&hls->io_cond);
+    }
+    pthread_mutex_unlock(&hls->io_mutex);
+    return NULL;
+}
+
+static int upload_queue_init(HLSContext *hls)
+{
+    int ret;
+
+    hls->io_workers     = av_calloc(hls->io_threads, sizeof(*hls->io_workers));
+    hls->io_running_seq = av_malloc_array(hls->io_threads, sizeof(*hls->io_running_seq));
+    if (!hls->io_workers || !hls->io_running_seq)
+        return AVERROR(ENOMEM);
+    for (int i = 0; i < hls->io_threads; i++)
+        hls->io_running_seq[i] = INT64_MAX;
+    if ((ret = pthread_mutex_init(&hls->io_mutex, NULL)))
+        return AVERROR(ret);
+    if ((ret = pthread_cond_init(&hls->io_cond, NULL))) {
+        pthread_mutex_destroy(&hls->io_mutex);
+        return AVERROR(ret);
+    }
+    hls->io_queue_tail = &hls->io_queue;
+    for (; hls->nb_io_workers < hls->io_threads; hls->nb_io_workers++) {
+        ret = pthread_create(&hls->io_workers[hls->nb_io_workers], NULL, upload_worker, hls);
+        if (ret)
+            return AVERROR(ret);
+    }
+    return 0;
+}
+
+static void upload_submit(HLSContext *hls, HLSUpload *up)
+{
+    pthread_mutex_lock(&hls->io_mutex);
+    if (hls->io_abort) {
+        upload_free(&up);
+    } else {
+        up->seq = hls->io_seq++;
+        *hls->io_queue_tail = up;
+        hls->io_queue_tail = &up->next;
+    }
+    pthread_cond_broadcast(&hls->io_cond);
+    pthread_mutex_unlock(&hls->io_mutex);
+}
+
+/* Return the error of the first failed upload, waiting for all queued ones if flush is set. */
+static int upload_queue_error(HLSContext *hls, int flush)
+{
+    int ret;
+
+    if (!hls->nb_io_workers)
+        return 0;
+    pthread_mutex_lock(&hls->io_mutex);
+    while (flush && !hls->io_abort) {
+        int running = 0;
+        for (int i = 0; i < hls->io_threads; i++)
+            running |= hls->io_running_seq[i] != INT64_MAX;
+        if (!running && !hls->io_queue)
+            break;
+        pthread_cond_wait(&hls->io_cond, &hls->io_mutex);
+    }
+    ret = hls->io_error;
+    pthread_mutex_unlock(&hls->io_mutex);
+    return ret;
+}
+
+static void upload_queue_uninit(HLSContext *hls)
+{
+    if (!hls->io_workers)
+        return;
+    if (hls->nb_io_workers) {
+        pthread_mutex_lock(&hls->io_mutex);
+        hls->io_abort = 1;
+        pthread_cond_broadcast(&hls->io_cond);
+        pthread_mutex_unlock(&hls->io_mutex);
+        for (int i = 0; i < hls->nb_io_workers; i++)
+            pthread_join(hls->io_workers[i], NULL);
+    }
+    if (hls->io_queue_tail) {
+        pthread_cond_destroy(&hls->io_cond);
+        pthread_mutex_destroy(&hls->io_mutex);
+    }
+    while (hls->io_queue) {
+        HLSUpload *up = hls->io_queue;
+        hls->io_queue = up->next;
+        upload_free(&up);
+    }
+    av_freep(&hls->io_workers);
+    av_freep(&hls->io_running_seq);
+}
+#else
+static int upload_queue_init(HLSContext *hls)
+{
+    return AVERROR(ENOSYS);
+}
+
+static void upload_submit(HLSContext *hls, HLSUpload *up)
+{
+    upload_free(&up);
+}
+
+static int upload_queue_error(HLSContext *hls, int flush)
+{
+    return 0;
+}
+
+static void upload_queue_uninit(HLSContext *hls)
+{
+}
+#endif
+
+/* Write an output to memory, to be uploaded once it is closed. */
+static int upload_open(AVFormatContext *s, AVIOContext **pb, const char *url,
+                       AVDictionary **options)
+{
+    HLSContext *hls = s->priv_data;
+    HLSUpload *up = av_mallocz(sizeof(*up));
+    int ret = AVERROR(ENOMEM);
+
+    if (!up)
+        return ret;
+    up->avf = s;
+    if (!(up->url = av_strdup(url)) ||
+        (ret = av_dict_copy(&up->options, *options, 0)) < 0 ||
+        (ret = avio_open_dyn_buf(&up->pb)) < 0 ||
+        (ret = av_dynarray_add_nofree(&hls->io_open_uploads,
+                                      &hls->nb_io_open_uploads, up)) < 0) {
+        upload_free(&up);
+        return ret;
+    }
+    *pb = up->pb;
+    return 0;
+}
+
+/* Detach the upload written to pb from the muxer, if pb is one. */
+static HLSUpload *upload_take(HLSContext *hls, AVIOContext *pb)
+{
+    for (int i = 0; pb && i < hls->nb_io_open_uploads; i++) {
+        HLSUpload *up = hls->io_open_uploads[i];
+        if (up->pb == pb) {
+            hls->io_open_uploads[i] = hls->io_open_uploads[--hls->nb_io_open_uploads];
+            return up;
+        }
+    }
+    return NULL;
+}
+
+static int upload_close(HLSContext *hls, HLSUpload *up, int ordered)
+{
+    up->size = avio_close_dyn_buf(up->pb, &up->data);
+    up->pb = NULL;
+    if (up->size < 0) {
+        int ret = up->size;
+        upload_free(&up);
+        return ret;
+    }
+    up->ordered = ordered;
+    upload_submit(hls, up);
+    return 0;
+}
+
+/* Queue the rename (if new_url is set) or deletion of a local file. */
+static int upload_file_op(HLSContext *hls, AVFormatContext *avf,
+                          const char *url, const char *new_url)
+{
+    HLSUpload *up = av_mallocz(sizeof(*up));
+
+    if (!up || !(up->url = av_strdup(url)) ||
+        (new_url && !(up->new_url = av_strdup(new_url)))) {
+        upload_free(&up);
+        return AVERROR(ENOMEM);
+    }
+    up->avf     = avf;
+    up->unlink  = !new_url;
+    up->ordered = 1;
+    upload_submit(hls, up);
+    return 0;
+}
+
+static int hls_rename(AVFormatContext *s, const char *oldpath, const char *newpath)
+{
+    HLSContext *hls = s->priv_data;
+
+    if (hls->io_threads)
+        return upload_file_op(hls, s, oldpath, newpath);
+    return ff_rename(oldpath, newpath, s);
+}
+
 static int hlsenc_io_open(AVFormatContext *s, AVIOContext **pb, const char *filename,
                           AVDictionary **options)
 {
     HLSContext *hls = s->priv_data;
     int http_base_proto = filename ? ff_is_http_proto(filename) : 0;
     int err = AVERROR_MUXER_NOT_FOUND;
+    if (hls->io_threads)
+        return upload_open(s, pb, filename, options);
     if (!*pb || !http_base_proto || !hls->http_persistent) {
         err = s->io_open(s, pb, filename, AVIO_FLAG_WRITE, options);
 #if CONFIG_HTTP_PROTOCOL
@@ -303,13 +646,18 @@ static int hlsenc_io_open(AVFormatContext *s, AVIOContext **pb, const char *file
     return err;
 }
 
-static int hlsenc_io_close(AVFormatContext *s, AVIOContext **pb, char *filename)
+static int io_close(AVFormatContext *s, AVIOContext **pb, char *filename, int playlist)
 {
     HLSContext *hls = s->priv_data;
     int http_base_proto = filename ? ff_is_http_proto(filename) : 0;
+    HLSUpload *up;
     int ret = 0;
     if (!*pb)
         return ret;
+    if ((up = upload_take(hls, *pb))) {
+        *pb = NULL;
+        return upload_close(hls, up, playlist);
+    }
     if (!http_base_proto || !hls->http_persistent || hls->key_info_file || hls->encrypt) {
         ff_format_io_close(s, pb);
 #if CONFIG_HTTP_PROTOCOL
@@ -323,6 +671,30 @@ static int hlsenc_io_close(AVFormatContext *s, AVIOContext **pb, char *filename)
     return ret;
 }
 
+static int hlsenc_io_close(AVFormatContext *s, AVIOContext **pb, char *filename)
+{
+    return io_close(s, pb, filename, 0);
+}
+
+static int hlsenc_io_close_playlist(AVFormatContext *s, AVIOContext **pb, char *filename)
+{
+    return io_close(s, pb, filename, 1);
+}
+
+/* Close pb without uploading it, after a failure. */
+static void hlsenc_io_discard(AVFormatContext *s, AVIOContext **pb)
+{
+    HLSContext *hls = s->priv_data;
+    HLSUpload *up = upload_take(hls, *pb);
+
+    if (up) {
+        *pb = NULL;
+        upload_free(&up);
+    } else {
+        ff_format_io_close(s, pb);
+    }
+}
+
 static void set_http_options(AVFormatContext *s, AVDictionary **options, HLSContext *c)
 {
     int http_base_proto = ff_is_http_proto(s->url);
@@ -573,11 +945,26 @@ static int hls_delete_file(HLSContext *hls, AVFormatContext *avf,
         int ret;
         set_http_options(avf, &opt, hls);
         av_dict_set(&opt, "method", "DELETE", 0);
+        if (hls->io_threads) {
+            HLSUpload *up = av_mallocz(sizeof(*up));
+            if (!up || !(up->url = av_strdup(path))) {
+                av_dict_free(&opt);
+                upload_free(&up);
+                return AVERROR(ENOMEM);
+            }
+            up->avf     = avf;
+            up->options = opt;
+            up->ordered = 1;
+            upload_submit(hls, up);
+            return 0;
+        }
         ret = avf->io_open(avf, &out, path, AVIO_FLAG_WRITE, &opt);
         av_dict_free(&opt);
         if (ret < 0)
             return hls->ignore_io_errors ? 1 : ret;
         ff_format_io_close(avf, &out);
+    } else if (hls->io_threads) {
+        return upload_file_op(hls, avf, path, NULL);
     } else if (unlink(path) < 0) {
         av_log(hls, AV_LOG_ERROR, "failed to delete old segment %s: %s\n",
                path, strerror(errno));
@@ -1051,10 +1438,11 @@ static int sls_flag_check_duration_size(HLSContext *hls, VariantStream *vs)
     return ret;
 }
 
-static void sls_flag_file_rename(HLSContext *hls, VariantStream *vs, char *old_filename) {
+static void sls_flag_file_rename(AVFormatContext *s, VariantStream *vs, char *old_filename) {
+    HLSContext *hls = s->priv_data;
     if ((hls->flags & (HLS_SECOND_LEVEL_SEGMENT_SIZE | HLS_SECOND_LEVEL_SEGMENT_DURATION)) &&
         strlen(vs->current_segment_final_filename_fmt)) {
-        ff_rename(old_filename, vs->avf->url, hls);
+        hls_rename(s, old_filename, vs->avf->url);
     }
 }
 
@@ -1324,7 +1712,7 @@ static int hls_rename_temp_file(AVFormatContext *s, AVFormatContext *oc)
     if (!final_filename)
         return AVERROR(ENOMEM);
     final_filename[len-4] = '\0';
-    ret = ff_rename(oc->url, final_filename, s);
+    ret = hls_rename(s, oc->url, final_filename);
     oc->url[len-4] = '\0';
     av_freep(&final_filename);
     return ret;
@@ -1525,9 +1913,9 @@ static int create_master_playlist(AVFormatContext *s,
 fail:
     if (ret >=0)
         hls->master_m3u8_created = 1;
-    hlsenc_io_close(s, &hls->m3u8_out, temp_filename);
+    hlsenc_io_close_playlist(s, &hls->m3u8_out, temp_filename);
     if (use_temp_file)
-        ff_rename(temp_filename, hls->master_m3u8_url, s);
+        hls_rename(s, temp_filename, hls->master_m3u8_url);
 
     return ret;
 }
@@ -1658,15 +2046,15 @@ static int hls_window(AVFormatContext *s, int last, VariantStream *vs)
 
 fail:
     av_dict_free(&options);
-    ret = hlsenc_io_close(s, byterange_mode ? &hls->m3u8_out : &vs->out, temp_filename);
+    ret = hlsenc_io_close_playlist(s, byterange_mode ? &hls->m3u8_out : &vs->out, temp_filename);
     if (ret < 0) {
         return ret;
     }
-    hlsenc_io_close(s, &hls->sub_m3u8_out, vs->vtt_m3u8_name);
+    hlsenc_io_close_playlist(s, &hls->sub_m3u8_out, vs->vtt_m3u8_name);
     if (use_temp_file) {
-        ff_rename(temp_filename, vs->m3u8_name, s);
+        hls_rename(s, temp_filename, vs->m3u8_name);
         if (vs->vtt_m3u8_name)
-            ff_rename(temp_vtt_filename, vs->vtt_m3u8_name, s);
+            hls_rename(s, temp_vtt_filename, vs->vtt_m3u8_name);
     }
     if (ret >= 0 && hls->master_pl_name)
         if (create_master_playlist(s, vs) < 0)
@@ -1675,17 +2063,66 @@ fail:
     return ret;
 }
 
+/**
+ * Replace the WebVTT muxer by a new one with the same streams, so the next
+ * segment can start with timestamps before the end of the previous one.
+ */
+static int hls_reopen_vtt_mux(VariantStream *vs)
+{
+    AVFormatContext *old = vs->vtt_avf;
+    AVFormatContext *vtt_oc = NULL;
+    int ret;
+
+    ret = avformat_alloc_output_context2(&vtt_oc, vs->vtt_oformat, NULL, NULL);
+    if (ret < 0)
+        return ret;
+    av_dict_copy(&vtt_oc->metadata, old->metadata, 0);
+    for (int i = 0; i < old->nb_streams; i++) {
+        const AVStream *ist = old->streams[i];
+        AVStream *st = avformat_new_stream(vtt_oc, NULL);
+
+        if (!st || (ret = avcodec_parameters_copy(st->codecpar, ist->codecpar)) < 0) {
+            avformat_free_context(vtt_oc);
+            return st ? ret : AVERROR(ENOMEM);
+        }
+        st->sample_aspect_ratio = ist->sample_aspect_ratio;
+        st->time_base = ist->time_base;
+        av_dict_copy(&st->metadata, ist->metadata, 0);
+        st->id = ist->id;
+    }
+    /* still open in byterange mode */
+    vtt_oc->pb = old->pb;
+    old->pb = NULL;
+    if (old->url) {
+        ff_format_set_url(vtt_oc, old->url);
+        old->url = NULL;
+    }
+
+    avformat_free_context(old);
+    vs->vtt_avf = vtt_oc;
+    return 0;
+}
+
 static int hls_start(AVFormatContext *s, VariantStream *vs)
 {
     HLSContext *c = s->priv_data;
     AVFormatContext *oc = vs->avf;
-    AVFormatContext *vtt_oc = vs->vtt_avf;
+    AVFormatContext *vtt_oc;
     AVDictionary *options = NULL;
     const char *proto = NULL;
     int use_temp_file = 0;
     char iv_string[KEYSIZE*2 + 1];
     int err = 0;
 
+    /* Repeated events go back in time at the start of each segment, which
+     * a muxer that already wrote the previous segment would reject. */
+    if (vs->vtt_avf && c->subtitle_split == SUBSPLIT_REPEAT && vs->vtt_started) {
+        err = hls_reopen_vtt_mux(vs);
+        if (err < 0)
+            return err;
+    }
+    vtt_oc = vs->vtt_avf;
+
     if (c->flags & HLS_SINGLE_FILE) {
         char *new_name = av_strdup(vs->basename);
         if (!new_name)
@@ -1851,6 +2288,7 @@ static int hls_start(AVFormatContext *s, VariantStream *vs)
         err = avformat_write_header(vtt_oc,NULL);
         if (err < 0)
             return err;
+        vs->vtt_started = 1;
     }
 
     return 0;
@@ -2402,6 +2840,18 @@ static int64_t append_single_file(AVFormatContext *s, VariantStream *vs)
 
     return ret;
 }
+static int hls_write_subtitle(AVFormatContext *s, void *opaque, AVPacket *pkt)
+{
+    HLSContext *hls = s->priv_data;
+    VariantStream *vs = opaque;
+    int ret;
+
+    if (!vs->vtt_avf->pb)
+        return 0;
+    ret = ff_write_chained(vs->vtt_avf, 0, pkt, s, 0);
+    return hls->ignore_io_errors ? 0 : ret;
+}
+
 static int hls_write_packet(AVFormatContext *s, AVPacket *pkt)
 {
     HLSContext *hls = s->priv_data;
@@ -2445,6 +2895,9 @@ static int hls_write_packet(AVFormatContext *s, AVPacket *pkt)
         return AVERROR(ENOMEM);
     }
 
+    if ((ret = upload_queue_error(hls, 0)) < 0)
+        return ret;
+
     end_pts = hls->recording_time * vs->number;
 
     if (vs->sequence - vs->nb_entries > hls->start_sequence && hls->init_time > 0) {
@@ -2470,6 +2923,11 @@ static int hls_write_packet(AVFormatContext *s, AVPacket *pkt)
                     ((pkt->flags & AV_PKT_FLAG_KEY) || (hls->flags & HLS_SPLIT_BY_TIME));
         is_ref_pkt = (st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) && (pkt->stream_index == vs->reference_stream_index);
     }
+    /* Subtitles follow the boundaries of the other streams when their
+     * events are split. */
+    if (hls->subtitle_split && st->codecpar->codec_type == AVMEDIA_TYPE_SUBTITLE &&
+        vs->nb_streams > vs->has_subtitle)
+        can_split = 0;
     if (pkt->pts == AV_NOPTS_VALUE)
         is_ref_pkt = can_split = 0;
 
@@ -2493,6 +2951,18 @@ static int hls_write_packet(AVFormatContext *s, AVPacket *pkt)
     }
 
     can_split = can_split && (pkt->pts - vs->end_pts > 0);
+
+    if (vs->vtt_avf && hls->subtitle_split && pkt->pts != AV_NOPTS_VALUE &&
+        st->codecpar->codec_type != AVMEDIA_TYPE_SUBTITLE &&
+        (!vs->has_video || st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO)) {
+        /* The next boundary is at or after this packet and no earlier than
+         * the target segment duration. */
+        int64_t next_cut = av_rescale_q(vs->start_pts, st->time_base, AV_TIME_BASE_Q) + end_pts;
+        if (pkt->dts != AV_NOPTS_VALUE)
+            next_cut = FFMAX(next_cut, av_rescale_q(pkt->dts, st->time_base, AV_TIME_BASE_Q));
+        if ((ret = ff_subsplit_advance(&vs->subsplit, next_cut)) < 0)
+            return ret;
+    }
     if (vs->packets_written && can_split && av_compare_ts(pkt->pts - vs->start_pts, st->time_base,
                                                           end_pts, AV_TIME_BASE_Q) >= 0) {
         int64_t new_start_pos;
@@ -2519,6 +2989,12 @@ static int hls_write_packet(AVFormatContext *s, AVPacket *pkt)
                 }
             }
         }
+        if (vs->vtt_avf && hls->subtitle_split) {
+            ret = ff_subsplit_cut(&vs->subsplit,
+                                  av_rescale_q(pkt->pts, st->time_base, AV_TIME_BASE_Q));
+            if (ret < 0)
+                return ret;
+        }
         if (!byterange_mode) {
             if (vs->vtt_avf) {
                 hlsenc_io_close(s, &vs->vtt_avf->pb, vs->vtt_avf->url);
@@ -2617,7 +3093,7 @@ static int hls_write_packet(AVFormatContext *s, AVPacket *pkt)
         if (hls->pl_type != PLAYLIST_TYPE_VOD) {
             if ((ret = hls_window(s, 0, vs)) < 0) {
                 av_log(s, AV_LOG_WARNING, "upload playlist failed, will retry with a new http session.\n");
-                ff_format_io_close(s, &vs->out);
+                hlsenc_io_discard(s, &vs->out);
                 if ((ret = hls_window(s, 0, vs)) < 0) {
                     av_freep(&old_filename);
                     return ret;
@@ -2643,7 +3119,7 @@ static int hls_write_packet(AVFormatContext *s, AVPacket *pkt)
         } else if (hls->max_seg_size > 0) {
             if (vs->size + vs->start_pos >= hls->max_seg_size) {
                 vs->sequence++;
-                sls_flag_file_rename(hls, vs, old_filename);
+                sls_flag_file_rename(s, vs, old_filename);
                 ret = hls_start(s, vs);
                 vs->start_pos = 0;
                 /* When split segment by byte, the duration is short than hls_time,
@@ -2653,7 +3129,7 @@ static int hls_write_packet(AVFormatContext *s, AVPacket *pkt)
             }
         } else {
             vs->start_pos = new_start_pos;
-            sls_flag_file_rename(hls, vs, old_filename);
+            sls_flag_file_rename(s, vs, old_filename);
             ret = hls_start(s, vs);
         }
         vs->number++;
@@ -2665,6 +3141,8 @@ static int hls_write_packet(AVFormatContext *s, AVPacket *pkt)
     }
 
     vs->packets_written++;
+    if (oc == vs->vtt_avf && ff_subsplit_handles(&vs->subsplit, pkt))
+        return ff_subsplit_write_packet(&vs->subsplit, pkt);
     if (oc->pb) {
         ret = ff_write_chained(oc, stream_index, pkt, s, 0);
         vs->video_keyframe_size += pkt->size;
@@ -2695,6 +3173,7 @@ static void hls_deinit(AVFormatContext *s)
         av_freep(&vs->vtt_basename);
         av_freep(&vs->vtt_m3u8_name);
 
+        ff_subsplit_uninit(&vs->subsplit);
         avformat_free_context(vs->vtt_avf);
         avformat_free_context(vs->avf);
         if (hls->resend_init_file)
@@ -2705,8 +3184,12 @@ static void hls_deinit(AVFormatContext *s)
         av_freep(&vs->streams);
     }
 
-    ff_format_io_close(s, &hls->m3u8_out);
-    ff_format_io_close(s, &hls->sub_m3u8_out);
+    hlsenc_io_discard(s, &hls->m3u8_out);
+    hlsenc_io_discard(s, &hls->sub_m3u8_out);
+    upload_queue_uninit(hls);
+    for (i = 0; i < hls->nb_io_open_uploads; i++)
+        upload_free(&hls->io_open_uploads[i]);
+    av_freep(&hls->io_open_uploads);
     av_freep(&hls->key_basename);
     av_freep(&hls->var_streams);
     av_freep(&hls->cc_streams);
@@ -2765,7 +3248,8 @@ static int hls_write_trailer(struct AVFormatContext *s)
                 vs->start_pos = range_length;
                 byterange_mode = (hls->flags & HLS_SINGLE_FILE) || (hls->max_seg_size > 0);
                 if (!byterange_mode) {
-                    ff_format_io_close(s, &vs->out);
+                    if (!hls->io_threads)
+                        ff_format_io_close(s, &vs->out);
                     hlsenc_io_close(s, &vs->out, vs->base_output_dirname);
                 }
             }
@@ -2829,18 +3313,22 @@ failed:
         /* after av_write_trailer, then duration + 1 duration per packet */
         hls_append_segment(s, hls, vs, vs->duration + vs->dpp, vs->start_pos, vs->size);
 
-        sls_flag_file_rename(hls, vs, old_filename);
+        sls_flag_file_rename(s, vs, old_filename);
 
         if (vtt_oc) {
+            ff_subsplit_flush(&vs->subsplit);
             if (vtt_oc->pb)
                 av_write_trailer(vtt_oc);
             vs->size = avio_tell(vs->vtt_avf->pb) - vs->start_pos;
-            ff_format_io_close(s, &vtt_oc->pb);
+            if (hls->io_threads)
+                hlsenc_io_close(s, &vtt_oc->pb, vtt_oc->url);
+            else
+                ff_format_io_close(s, &vtt_oc->pb);
         }
         ret = hls_window(s, 1, vs);
         if (ret < 0) {
             av_log(s, AV_LOG_WARNING, "upload playlist failed, will retry with a new http session.\n");
-            ff_format_io_close(s, &vs->out);
+            hlsenc_io_discard(s, &vs->out);
             hls_window(s, 1, vs);
         }
         ffio_free_dyn_buf(&oc->pb);
@@ -2848,7 +3336,7 @@ failed:
         av_free(old_filename);
     }
 
-    return 0;
+    return upload_queue_error(hls, 1);
 }
 
 
@@ -2887,6 +3375,17 @@ static int hls_init(AVFormatContext *s)
         av_log(hls, AV_LOG_WARNING, "No HTTP method set, hls muxer defaulting to method PUT.\n");
     }
 
+    if (hls->io_threads) {
+        if (!HAVE_THREADS || hls->http_persistent ||
+            (hls->flags & HLS_SINGLE_FILE) || hls->max_seg_size > 0) {
+            av_log(hls, AV_LOG_WARNING, "io_threads is not supported with %s, uploading synchronously\n",
+                   !HAVE_THREADS ? "this build" : hls->http_persistent ? "http_persistent" : "byte ranges");
+            hls->io_threads = 0;
+        } else if ((ret = upload_queue_init(hls)) < 0) {
+            return ret;
+        }
+    }
+
     ret = validate_name(hls->nb_varstreams, s->url);
     if (ret < 0)
         return ret;
@@ -3084,6 +3583,21 @@ static int hls_init(AVFormatContext *s)
         if ((ret = hls_mux_init(s, vs)) < 0)
             return ret;
 
+        if (vs->has_subtitle) {
+            if (hls->subtitle_split == SUBSPLIT_REPEAT &&
+                ((hls->flags & HLS_SINGLE_FILE) || hls->max_seg_size > 0)) {
+                av_log(s, AV_LOG_WARNING, "Subtitle events can not be repeated "
+                       "in byte range segments, splitting them instead.\n");
+                hls->subtitle_split = SUBSPLIT_SPLIT;
+            }
+            vs->subsplit.mode         = hls->subtitle_split;
+            vs->subsplit.s            = s;
+            vs->subsplit.opaque       = vs;
+            vs->subsplit.write_packet = hls_write_subtitle;
+            if ((ret = ff_subsplit_init(&vs->subsplit)) < 0)
+                return ret;
+        }
+
         if (hls->flags & HLS_APPEND_LIST) {
             parse_playlist(s, vs->m3u8_name, vs);
             vs->discontinuity = 1;
@@ -3126,6 +3640,10 @@ static const AVOption options[] = {
     {"hls_enc_key_url",    "url to access the key to decrypt the segments", OFFSET(key_url),      AV_OPT_TYPE_STRING, {.str = NULL},            0,       0,         E},
     {"hls_enc_iv",    "hex-coded 16 byte initialization vector", OFFSET(iv),      AV_OPT_TYPE_STRING, .flags = E},
     {"hls_subtitle_path",     "set path of hls subtitles", OFFSET(subtitle_filename), AV_OPT_TYPE_STRING, {.str = NULL},  0, 0,    E},
+    {"hls_subtitle_split", "set how subtitle events crossing segment boundaries are written", OFFSET(subtitle_split), AV_OPT_TYPE_INT, {.i64 = SUBSPLIT_NONE }, 0, SUBSPLIT_NB - 1, E, "subtitle_split"},
+    {"none",   "write events into the segment they start in", 0, AV_OPT_TYPE_CONST, {.i64 = SUBSPLIT_NONE },   0, 0, E, "subtitle_split"},
+    {"split",  "cut events at segment boundaries",            0, AV_OPT_TYPE_CONST, {.i64 = SUBSPLIT_SPLIT },  0, 0, E, "subtitle_split"},
+    {"repeat", "repeat events in every segment they overlap", 0, AV_OPT_TYPE_CONST, {.i64 = SUBSPLIT_REPEAT }, 0, 0, E, "subtitle_split"},
     {"hls_segment_type",     "set hls segment files type", OFFSET(segment_type), AV_OPT_TYPE_INT, {.i64 = SEGMENT_TYPE_MPEGTS }, 0, SEGMENT_TYPE_FMP4, E, "segment_type"},
     {"mpegts",   "make segment file to mpegts files in m3u8", 0, AV_OPT_TYPE_CONST, {.i64 = SEGMENT_TYPE_MPEGTS }, 0, UINT_MAX,   E, "segment_type"},
     {"fmp4",   "make segment file to fragment mp4 files in m3u8", 0, AV_OPT_TYPE_CONST, {.i64 = SEGMENT_TYPE_FMP4 }, 0, UINT_MAX,   E, "segment_type"},
@@ -3166,6 +3684,7 @@ static const AVOption options[] = {
     {"http_persistent", "Use persistent HTTP connections", OFFSET(http_persistent), AV_OPT_TYPE_BOOL, {.i64 = 0 }, 0, 1, E },
     {"timeout", "set timeout for socket I/O operations", OFFSET(timeout), AV_OPT_TYPE_DURATION, { .i64 = -1 }, -1, INT_MAX, .flags = E },
     {"ignore_io_errors", "Ignore IO errors for stable long-duration runs with network output", OFFSET(ignore_io_errors), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, E },
+    {"io_threads", "number of threads writing outputs in the background, calling io_open/io_close2 concurrently", OFFSET(io_threads), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 64, E},
     {"headers", "set custom HTTP headers, can override built in default headers", OFFSET(headers), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, E },
     { NULL },
 };
@@ -62,6 +62,7 @@
 #include "rtpenc.h"
 #include "mov_chan.h"
 #include "movenc_ttml.h"
+#include "movenc_webvtt.h"
 #include "mux.h"
 #include "rawutils.h"
 #include "ttmlenc.h"
@@ -1828,6 +1829,20 @@ static int mov_write_fiel_tag(AVIOContext *pb, MOVTrack *track, int field_order)
     return 10;
 }
 
+static int mov_write_vttc_tag(AVIOContext *pb, MOVTrack *track)
+{
+    int64_t pos = avio_tell(pb);
+    avio_wb32(pb, 0); /* size */
+    ffio_wfourcc(pb, "vttC");
+    /* The configuration is the header of a WebVTT file, without the cues */
+    if (track->par->extradata_size >= 6 &&
+        !memcmp(track->par->extradata, "WEBVTT", 6))
+        avio_write(pb, track->par->extradata, track->par->extradata_size);
+    else
+        avio_write(pb, "WEBVTT", 6);
+    return update_size(pb, pos);
+}
+
 static int mov_write_subtitle_tag(AVFormatContext *s, AVIOContext *pb, MOVTrack *track)
 {
     MOVMuxContext *mov = s->priv_data;
@@ -1863,6 +1878,8 @@ static int mov_write_subtitle_tag(AVFormatContext *s, AVIOContext *pb, MOVTrack
                    track->track_id);
             return AVERROR(EINVAL);
         }
+    } else if (track->tag == MKTAG('w','v','t','t')) {
+        mov_write_vttc_tag(pb, track);
     } else if (track->par->extradata_size)
         avio_write(pb, track->par->extradata, track->par->extradata_size);
 
@@ -5710,10 +5727,11 @@ static int mov_flush_fragment(AVFormatContext *s, int force)
     // from queued packets in the interleave queues. If the flushing
     // of fragments was triggered automatically by an AVPacket, we
     // already have reliable info for the end of that track, but other
-    // tracks may need to be filled in.
+    // tracks may need to be filled in. The 'wvtt' samples lag behind
+    // the queued cues, and always have exact durations.
     for (i = 0; i < s->nb_streams; i++) {
         MOVTrack *track = &mov->tracks[i];
-        if (!track->end_reliable) {
+        if (!track->end_reliable && track->tag != MKTAG('w','v','t','t')) {
             const AVPacket *pkt = ff_interleaved_peek(s, i);
             if (pkt) {
                 int64_t offset, dts, pts;
@@ -6404,6 +6422,55 @@ static int mov_write_subtitle_end_packet(AVFormatContext *s,
     return ret;
 }
 
+static int mov_write_wvtt_samples(AVFormatContext *s, MOVTrack *trk,
+                                  int64_t end)
+{
+    MOVMuxContext *mov = s->priv_data;
+    AVPacket *sample = mov->pkt;
+    int ret;
+
+    while ((ret = ff_mov_webvtt_generate_sample(s, trk, end, sample)) >= 0) {
+        sample->stream_index = trk->st->index;
+        ret = mov_write_single_packet(s, sample);
+        av_packet_unref(sample);
+        if (ret < 0)
+            return ret;
+    }
+
+    return ret == AVERROR(EAGAIN) ? 0 : ret;
+}
+
+/*
+ * The samples up to the start of a WebVTT cue are final once the cue
+ * arrives, so write them before queueing the cue itself. A zero-sized
+ * packet only advances the time, e.g. to complete the samples of a
+ * fragment before it gets flushed.
+ */
+static int mov_write_wvtt_packet(AVFormatContext *s, MOVTrack *trk,
+                                 const AVPacket *pkt)
+{
+    int ret;
+
+    if (pkt->pts == AV_NOPTS_VALUE) {
+        av_log(s, AV_LOG_ERROR,
+               "WebVTT packets without a valid presentation timestamp are "
+               "not supported!\n");
+        return AVERROR(EINVAL);
+    }
+
+    // The track starts at 0 unless it was started explicitly.
+    if (trk->webvtt_time == AV_NOPTS_VALUE)
+        trk->webvtt_time = pkt->size ? FFMIN(pkt->pts, 0) : pkt->pts;
+
+    if ((ret = mov_write_wvtt_samples(s, trk, pkt->pts)) < 0)
+        return ret;
+
+    if (!pkt->size)
+        return 0;
+
+    return ff_mov_webvtt_add_cue(s, trk, pkt);
+}
+
 static int mov_write_packet(AVFormatContext *s, AVPacket *pkt)
 {
     MOVMuxContext *mov = s->priv_data;
@@ -6433,7 +6500,11 @@ static int mov_write_packet(AVFormatContext *s, AVPacket *pkt)
     } else {
         int i;
 
-        if (!pkt->size)
+        if (trk->tag == MKTAG('w','v','t','t'))
+            return mov_write_wvtt_packet(s, trk, pkt);
+
+        /* Zero-sized packets extend the duration of squashed samples. */
+        if (!pkt->size && !trk->squash_fragment_samples_to_one)
             return mov_write_single_packet(s, pkt); /* Passthrough. */
 
         /*
@@ -6753,6 +6824,7 @@ static void mov_free(AVFormatContext *s)
         ffio_free_dyn_buf(&track->mdat_buf);
 
         avpriv_packet_list_free(&track->squashed_packet_queue);
+        ff_mov_webvtt_free(track);
     }
 
     av_freep(&mov->tracks);
@@ -7062,6 +7134,7 @@ static int mov_init(AVFormatContext *s)
         track->start_cts  = AV_NOPTS_VALUE;
         track->end_pts    = AV_NOPTS_VALUE;
         track->dts_shift  = AV_NOPTS_VALUE;
+        track->webvtt_time = AV_NOPTS_VALUE;
         if (st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
             if (track->tag == MKTAG('m','x','3','p') || track->tag == MKTAG('m','x','3','n') ||
                 track->tag == MKTAG('m','x','4','p') || track->tag == MKTAG('m','x','4','n') ||
@@ -7185,8 +7258,12 @@ static int mov_init(AVFormatContext *s)
                 track->squash_fragment_samples_to_one =
                     ff_is_ttml_stream_paragraph_based(track->par);
 
+                /* A single track fragmented on demand of the caller needs
+                   no synchronization with other tracks; this is what the
+                   DASH muxer does. */
                 if (mov->flags & FF_MOV_FLAG_FRAGMENT &&
-                    track->squash_fragment_samples_to_one) {
+                    track->squash_fragment_samples_to_one &&
+                    (s->nb_streams > 1 || !(mov->flags & FF_MOV_FLAG_FRAG_CUSTOM))) {
                     av_log(s, AV_LOG_ERROR,
                            "Fragmentation is not currently supported for "
                            "TTML in MP4/ISMV (track synchronization between "
@@ -7513,6 +7590,9 @@ static int mov_write_trailer(AVFormatContext *s)
             mov_write_subtitle_end_packet(s, i, trk->track_duration);
             trk->last_sample_is_subtitle_end = 1;
         }
+        if (trk->tag == MKTAG('w','v','t','t') &&
+            (res = mov_write_wvtt_samples(s, trk, ff_mov_webvtt_cues_end(trk))) < 0)
+            return res;
     }
 
     // Check if we have any tracks that require squashing.
@@ -7722,6 +7802,7 @@ static const AVCodecTag codec_mp4_tags[] = {
     { AV_CODEC_ID_MPEGH_3D_AUDIO,  MKTAG('m', 'h', 'm', '1') },
     { AV_CODEC_ID_TTML,            MOV_MP4_TTML_TAG          },
     { AV_CODEC_ID_TTML,            MOV_ISMV_TTML_TAG         },
+    { AV_CODEC_ID_WEBVTT,          MKTAG('w', 'v', 't', 't') },
     { AV_CODEC_ID_NONE,               0 },
 };
 #if CONFIG_MP4_MUXER || CONFIG_PSP_MUXER
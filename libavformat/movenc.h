@@ -83,6 +83,13 @@ typedef struct MOVFragmentInfo {
     int size;
 } MOVFragmentInfo;
 
+typedef struct MOVWebVTTCue {
+    int64_t     start;
+    int64_t     end;
+    uint8_t    *box;      ///< serialized VTTCueBox
+    int         box_size;
+} MOVWebVTTCue;
+
 typedef struct MOVTrack {
     int         mode;
     int         entry;
@@ -170,6 +177,11 @@ typedef struct MOVTrack {
     unsigned int squash_fragment_samples_to_one; //< flag to note formats where all samples for a fragment are to be squashed
 
     PacketList squashed_packet_queue;
+
+    MOVWebVTTCue *webvtt_cues; ///< cues not completely written to 'wvtt' samples yet
+    int         nb_webvtt_cues;
+    unsigned    webvtt_cues_size;
+    int64_t     webvtt_time;   ///< time up to which 'wvtt' samples have been written
 } MOVTrack;
 
 typedef enum {
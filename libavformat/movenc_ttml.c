@@ -62,17 +62,50 @@ static int mov_write_ttml_document_from_queue(AVFormatContext *s,
                                               int64_t *out_duration)
 {
     int ret = AVERROR_BUG;
+    PacketList carried = { 0 };
     int64_t start_ts = track->start_dts == AV_NOPTS_VALUE ?
                        0 : (track->start_dts + track->track_duration);
     int64_t end_ts   = start_ts;
+    int64_t boundary = AV_NOPTS_VALUE;
+
+    // Zero-sized packets mark the time up to which the document lasts,
+    // and for the first document also where it starts.
+    for (PacketListEntry *entry = track->squashed_packet_queue.head;
+         entry; entry = entry->next) {
+        if (entry->pkt.size)
+            continue;
+        if (track->start_dts == AV_NOPTS_VALUE &&
+            entry == track->squashed_packet_queue.head)
+            end_ts = start_ts = entry->pkt.pts;
+        else if (boundary == AV_NOPTS_VALUE || entry->pkt.pts > boundary)
+            boundary = entry->pkt.pts;
+    }
 
     if ((ret = avformat_write_header(ttml_ctx, NULL)) < 0) {
         return ret;
     }
 
     while (!avpriv_packet_list_get(&track->squashed_packet_queue, pkt)) {
+        if (!pkt->size) {
+            av_packet_unref(pkt);
+            continue;
+        }
+
         end_ts = FFMAX(end_ts, pkt->pts + pkt->duration);
 
+        // Paragraphs lasting beyond the boundary are repeated in the
+        // next document.
+        if (boundary != AV_NOPTS_VALUE &&
+            pkt->pts + pkt->duration > boundary) {
+            if ((ret = avpriv_packet_list_put(&carried, pkt,
+                                              av_packet_ref, 0)) < 0)
+                goto cleanup;
+            if (pkt->pts >= boundary) {
+                av_packet_unref(pkt);
+                continue;
+            }
+        }
+
         // in case of the 'dfxp' muxing mode, each written document is offset
         // to its containing sample's beginning.
         if (track->par->codec_tag == MOV_ISMV_TTML_TAG) {
@@ -94,12 +127,17 @@ static int mov_write_ttml_document_from_queue(AVFormatContext *s,
     if ((ret = av_write_trailer(ttml_ctx)) < 0)
         goto cleanup;
 
+    if (boundary != AV_NOPTS_VALUE)
+        end_ts = FFMAX(boundary, start_ts);
+
     *out_start_ts = start_ts;
     *out_duration = end_ts - start_ts;
 
     ret = 0;
 
 cleanup:
+    avpriv_packet_list_free(&track->squashed_packet_queue);
+    track->squashed_packet_queue = carried;
     return ret;
 }
 
@@ -0,0 +1,168 @@
+/*
+ * MP4 Muxer WebVTT helpers
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * WebVTT in ISOBMFF as specified in 14496-30: samples must not overlap,
+ * so every sample covers the time between two cue boundaries and carries
+ * all cues active during that time, each in its own VTTCueBox. Times
+ * without any active cue are covered by samples with a VTTEmptyCueBox.
+ */
+
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mem.h"
+#include "avformat.h"
+#include "avio_internal.h"
+#include "movenc.h"
+#include "movenc_webvtt.h"
+
+static void put_string_box(AVIOContext *pb, const char *tag,
+                           const uint8_t *str, size_t size)
+{
+    avio_wb32(pb, 8 + size);
+    ffio_wfourcc(pb, tag);
+    avio_write(pb, str, size);
+}
+
+int ff_mov_webvtt_add_cue(AVFormatContext *s, MOVTrack *track,
+                          const AVPacket *pkt)
+{
+    MOVWebVTTCue *cue;
+    AVIOContext *pb;
+    const uint8_t *side_data;
+    size_t side_data_size;
+    int64_t start = FFMAX(pkt->pts, track->webvtt_time);
+    int64_t end   = pkt->pts + pkt->duration;
+    int ret;
+
+    if (end <= start) {
+        av_log(s, AV_LOG_WARNING,
+               "Dropping WebVTT cue at %"PRId64" in stream %d, "
+               "it ends before the current sample time.\n",
+               pkt->pts, pkt->stream_index);
+        return 0;
+    }
+
+    cue = av_fast_realloc(track->webvtt_cues, &track->webvtt_cues_size,
+                          (track->nb_webvtt_cues + 1) * sizeof(*cue));
+    if (!cue)
+        return AVERROR(ENOMEM);
+    track->webvtt_cues = cue;
+    cue = &cue[track->nb_webvtt_cues];
+
+    if ((ret = avio_open_dyn_buf(&pb)) < 0)
+        return ret;
+
+    avio_wb32(pb, 0); /* size */
+    ffio_wfourcc(pb, "vttc");
+    side_data = av_packet_get_side_data(pkt, AV_PKT_DATA_WEBVTT_IDENTIFIER,
+                                        &side_data_size);
+    if (side_data_size)
+        put_string_box(pb, "iden", side_data, side_data_size);
+    side_data = av_packet_get_side_data(pkt, AV_PKT_DATA_WEBVTT_SETTINGS,
+                                        &side_data_size);
+    if (side_data_size)
+        put_string_box(pb, "sttg", side_data, side_data_size);
+    put_string_box(pb, "payl", pkt->data, pkt->size);
+
+    cue->box_size = avio_close_dyn_buf(pb, &cue->box);
+    if (!cue->box)
+        return AVERROR(ENOMEM);
+    AV_WB32(cue->box, cue->box_size);
+
+    cue->start = start;
+    cue->end   = end;
+    track->nb_webvtt_cues++;
+
+    return 0;
+}
+
+int ff_mov_webvtt_generate_sample(AVFormatContext *s, MOVTrack *track,
+                                  int64_t end, AVPacket *pkt)
+{
+    int64_t time = track->webvtt_time, next = end;
+    int size = 0, i, j, ret;
+    uint8_t *p;
+
+    if (time >= end)
+        return AVERROR(EAGAIN);
+
+    for (i = 0; i < track->nb_webvtt_cues; i++) {
+        const MOVWebVTTCue *cue = &track->webvtt_cues[i];
+        if (cue->start > time) {
+            next = FFMIN(next, cue->start);
+        } else {
+            next = FFMIN(next, cue->end);
+            size += cue->box_size;
+        }
+    }
+
+    if ((ret = av_new_packet(pkt, size ? size : 8)) < 0)
+        return ret;
+
+    p = pkt->data;
+    if (size) {
+        for (i = 0; i < track->nb_webvtt_cues; i++) {
+            const MOVWebVTTCue *cue = &track->webvtt_cues[i];
+            if (cue->start > time)
+                continue;
+            memcpy(p, cue->box, cue->box_size);
+            p += cue->box_size;
+        }
+    } else {
+        AV_WB32(p, 8);
+        AV_WL32(p + 4, MKTAG('v','t','t','e'));
+    }
+
+    pkt->pts = pkt->dts = time;
+    pkt->duration = next - time;
+    pkt->flags |= AV_PKT_FLAG_KEY;
+
+    // Drop the cues that are completely covered by now.
+    track->webvtt_time = next;
+    for (i = j = 0; i < track->nb_webvtt_cues; i++) {
+        MOVWebVTTCue *cue = &track->webvtt_cues[i];
+        if (cue->end <= next)
+            av_freep(&cue->box);
+        else
+            track->webvtt_cues[j++] = *cue;
+    }
+    track->nb_webvtt_cues = j;
+
+    return 0;
+}
+
+int64_t ff_mov_webvtt_cues_end(const MOVTrack *track)
+{
+    int64_t end = track->webvtt_time;
+
+    for (int i = 0; i < track->nb_webvtt_cues; i++)
+        end = FFMAX(end, track->webvtt_cues[i].end);
+
+    return end;
+}
+
+void ff_mov_webvtt_free(MOVTrack *track)
+{
+    for (int i = 0; i < track->nb_webvtt_cues; i++)
+        av_freep(&track->webvtt_cues[i].box);
+    av_freep(&track->webvtt_cues);
+    track->nb_webvtt_cues   = 0;
+    track->webvtt_cues_size = 0;
+}
@@ -0,0 +1,54 @@
+/*
+ * MP4 Muxer WebVTT helpers
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFORMAT_MOVENC_WEBVTT_H
+#define AVFORMAT_MOVENC_WEBVTT_H
+
+#include "avformat.h"
+#include "movenc.h"
+
+/**
+ * Add the cue carried by a WebVTT packet to the cues pending for track.
+ * Parts of the cue before track->webvtt_time are dropped.
+ */
+int ff_mov_webvtt_add_cue(AVFormatContext *s, MOVTrack *track,
+                          const AVPacket *pkt);
+
+/**
+ * Generate the next 'wvtt' sample, starting at track->webvtt_time and
+ * lasting until the next cue boundary, but no longer than until end.
+ * The sample contains a VTTCueBox for each cue active during that time,
+ * or a VTTEmptyCueBox if there is none.
+ *
+ * @return 0 on success, AVERROR(EAGAIN) if track->webvtt_time is not
+ *         before end, another negative AVERROR value on failure
+ */
+int ff_mov_webvtt_generate_sample(AVFormatContext *s, MOVTrack *track,
+                                  int64_t end, AVPacket *pkt);
+
+/**
+ * @return the end time of the last pending cue, or track->webvtt_time
+ *         if there is none
+ */
+int64_t ff_mov_webvtt_cues_end(const MOVTrack *track);
+
+void ff_mov_webvtt_free(MOVTrack *track);
+
+#endif /* AVFORMAT_MOVENC_WEBVTT_H */
@@ -69,6 +69,15 @@ enum MpegTSFilterType {
     MPEGTS_PCR,
 };
 
+/* what the bulk packet loop does with a PID, see handle_packets_bulk() */
+enum MpegTSPidAction {
+    MPEGTS_PID_DROP = 0,        /**< no filter */
+    MPEGTS_PID_DISCARDED,       /**< filter of discarded programs only */
+    MPEGTS_PID_SECTION,
+    MPEGTS_PID_PES,
+    MPEGTS_PID_PCR,
+};
+
 typedef struct MpegTSFilter MpegTSFilter;
 
 typedef int PESCallback (MpegTSFilter *f, const uint8_t *buf, int len,
@@ -165,6 +174,8 @@ struct MpegTSContext {
     int resync_size;
     int merge_pmt_versions;
     int max_packet_size;
+    int bulk_read;
+    int subtitles_only;
 
     /******************************************/
     /* private mpegts data */
@@ -176,6 +187,8 @@ struct MpegTSContext {
     int8_t crc_validity[NB_PID_MAX];
     /** filters for various streams specified by PMT + for the PAT and PMT */
     MpegTSFilter *pids[NB_PID_MAX];
+    /** enum MpegTSPidAction, kept in sync with pids[] and their discard flag */
+    uint8_t pid_action[NB_PID_MAX];
     int current_pid;
 
     AVStream *epg_stream;
@@ -203,6 +216,10 @@ static const AVOption options[] = {
      {.i64 = 0}, 0, 1, 0 },
     {"max_packet_size", "maximum size of emitted packet", offsetof(MpegTSContext, max_packet_size), AV_OPT_TYPE_INT,
      {.i64 = 204800}, 1, INT_MAX/2, AV_OPT_FLAG_DECODING_PARAM },
+    {"bulk_read", "handle TS packets in place in the I/O buffer, skipping unused PIDs early", offsetof(MpegTSContext, bulk_read), AV_OPT_TYPE_BOOL,
+     {.i64 = 0}, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
+    {"subtitles_only", "only create streams for subtitle and teletext elementary streams", offsetof(MpegTSContext, subtitles_only), AV_OPT_TYPE_BOOL,
+     {.i64 = 0}, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
     { NULL },
 };
 
@@ -484,6 +501,17 @@ static void write_section_data(MpegTSContext *ts, MpegTSFilter *tss1,
     }
 }
 
+static uint8_t pid_action(const MpegTSFilter *filter)
+{
+    if (filter->discard)
+        return MPEGTS_PID_DISCARDED;
+    switch (filter->type) {
+    case MPEGTS_PES:     return MPEGTS_PID_PES;
+    case MPEGTS_SECTION: return MPEGTS_PID_SECTION;
+    default:             return MPEGTS_PID_PCR;
+    }
+}
+
 static MpegTSFilter *mpegts_open_filter(MpegTSContext *ts, unsigned int pid,
                                         enum MpegTSFilterType type)
 {
@@ -504,6 +532,8 @@ static MpegTSFilter *mpegts_open_filter(MpegTSContext *ts, unsigned int pid,
     filter->last_cc = -1;
     filter->last_pcr= -1;
 
+    ts->pid_action[pid] = pid_action(filter);
+
     return filter;
 }
 
@@ -574,6 +604,7 @@ static void mpegts_close_filter(MpegTSContext *ts, MpegTSFilter *filter)
 
     av_free(filter);
     ts->pids[pid] = NULL;
+    ts->pid_action[pid] = MPEGTS_PID_DROP;
 }
 
 static int analyze(const uint8_t *buf, int size, int packet_size,
@@ -2302,6 +2333,52 @@ static int parse_stream_identifier_desc(const uint8_t *p, const uint8_t *p_end)
     return -1;
 }
 
+/**
+ * Check whether an elementary stream of a PMT carries subtitles, judging by
+ * its stream type and the tags of its descriptor loop.
+ *
+ * @param p pointer to the ES_info_length field of the elementary stream
+ */
+static int is_subtitle_stream(int stream_type, uint32_t prog_reg_desc,
+                              const uint8_t *p, const uint8_t *p_end)
+{
+    const uint8_t **pp = &p;
+    const uint8_t *desc_list_end;
+    int desc_list_len;
+    int desc_len, desc_tag;
+
+    if ((prog_reg_desc == AV_RL32("HDMV") || prog_reg_desc == AV_RL32("HDPR")) &&
+        (stream_type == 0x90 || stream_type == 0x92))
+        return 1;
+    if (stream_type != 0x06)
+        return 0;
+
+    desc_list_len = get16(pp, p_end);
+    if (desc_list_len < 0)
+        return 0;
+    desc_list_len &= 0xfff;
+    desc_list_end  = p + desc_list_len;
+    if (desc_list_end > p_end)
+        return 0;
+
+    while (1) {
+        desc_tag = get8(pp, desc_list_end);
+        if (desc_tag < 0)
+            return 0;
+        desc_len = get8(pp, desc_list_end);
+        if (desc_len < 0 || *pp + desc_len > desc_list_end)
+            return 0;
+
+        if (desc_tag == 0x56 || desc_tag == 0x59)
+            return 1;
+        /* ARIB data coding type descriptor announcing captions */
+        if (desc_tag == 0xfd && desc_len >= 2 &&
+            (AV_RB16(*pp) == 0x0008 || AV_RB16(*pp) == 0x0012))
+            return 1;
+        *pp += desc_len;
+    }
+}
+
 static int is_pes_stream(int stream_type, uint32_t prog_reg_desc)
 {
     return !(stream_type == 0x13 ||
@@ -2325,7 +2402,7 @@ static void pmt_cb(MpegTSFilter *filter, const uint8_t *section, int section_len
 
     int mp4_descr_count = 0;
     Mp4Descr mp4_descr[MAX_MP4_DESCR_COUNT] = { { 0 } };
-    int i;
+    int i, stream_idx = 0;
 
     av_log(ts->stream, AV_LOG_TRACE, "PMT: len %i\n", section_len);
     hex_dump_debug(ts->stream, section, section_len);
@@ -2425,11 +2502,26 @@ static void pmt_cb(MpegTSFilter *filter, const uint8_t *section, int section_len
 
         stream_identifier = parse_stream_identifier_desc(p, p_end) + 1;
 
+        /* in subtitle-only mode, the PIDs of other elementary streams get
+         * neither a stream nor a filter, only the PCR of the program is
+         * still followed, for the timing of the subtitles */
+        if (ts->subtitles_only &&
+            (!ts->pids[pid] || ts->pids[pid]->type != MPEGTS_PES) &&
+            !is_subtitle_stream(stream_type, prog_reg_desc, p, p_end)) {
+            desc_list_len = get16(&p, p_end);
+            if (desc_list_len < 0)
+                goto out;
+            p += desc_list_len & 0xfff;
+            if (p > p_end)
+                goto out;
+            continue;
+        }
+
         /* now create stream */
         if (ts->pids[pid] && ts->pids[pid]->type == MPEGTS_PES) {
             pes = ts->pids[pid]->u.pes_filter.opaque;
             if (ts->merge_pmt_versions && !pes->st) {
-                st = find_matching_stream(ts, pid, h->id, stream_identifier, i, &old_program);
+                st = find_matching_stream(ts, pid, h->id, stream_identifier, stream_idx, &old_program);
                 if (st) {
                     pes->st = st;
                     pes->stream_type = stream_type;
@@ -2448,7 +2540,7 @@ static void pmt_cb(MpegTSFilter *filter, const uint8_t *section, int section_len
                 mpegts_close_filter(ts, ts->pids[pid]); // wrongly added sdt filter probably
             pes = add_pes_stream(ts, pid, pcr_pid);
             if (ts->merge_pmt_versions && pes && !pes->st) {
-                st = find_matching_stream(ts, pid, h->id, stream_identifier, i, &old_program);
+                st = find_matching_stream(ts, pid, h->id, stream_identifier, stream_idx, &old_program);
                 if (st) {
                     pes->st = st;
                     pes->stream_type = stream_type;
@@ -2467,7 +2559,7 @@ static void pmt_cb(MpegTSFilter *filter, const uint8_t *section, int section_len
                 st = ts->stream->streams[idx];
             }
             if (ts->merge_pmt_versions && !st) {
-                st = find_matching_stream(ts, pid, h->id, stream_identifier, i, &old_program);
+                st = find_matching_stream(ts, pid, h->id, stream_identifier, stream_idx, &old_program);
             }
             if (!st) {
                 st = avformat_new_stream(ts->stream, NULL);
@@ -2490,10 +2582,11 @@ static void pmt_cb(MpegTSFilter *filter, const uint8_t *section, int section_len
 
         add_pid_to_program(prg, pid);
         if (prg) {
-            prg->streams[i].idx = st->index;
-            prg->streams[i].stream_identifier = stream_identifier;
+            prg->streams[stream_idx].idx = st->index;
+            prg->streams[stream_idx].stream_identifier = stream_identifier;
             prg->nb_streams++;
         }
+        stream_idx++;
 
         av_program_add_stream_index(ts->stream, h->id, st->index);
 
@@ -2775,8 +2868,10 @@ static int handle_packet(MpegTSContext *ts, const uint8_t *packet, int64_t pos)
     }
     if (!tss)
         return 0;
-    if (is_start)
+    if (is_start) {
         tss->discard = discard_pid(ts, pid);
+        ts->pid_action[pid] = pid_action(tss);
+    }
     if (tss->discard)
         return 0;
     ts->current_pid = pid;
@@ -2965,6 +3060,53 @@ static void finished_reading_packet(AVFormatContext *s, int raw_packet_size)
         avio_skip(pb, skip);
 }
 
+/**
+ * Handle the TS packets already present in the I/O buffer in place.
+ *
+ * Sync bytes of the whole block are checked up front and the per-PID
+ * action table lets packets of unused or discarded PIDs be skipped without
+ * calling handle_packet(). Stops after the packet that completed an
+ * AVPacket, before the first packet without a sync byte, or after
+ * max_packets packets.
+ *
+ * @return number of packets consumed (0 if less than two packets are
+ *         buffered or the buffer does not start with a sync byte), or a
+ *         negative error code
+ */
+static int handle_packets_bulk(MpegTSContext *ts, int64_t max_packets)
+{
+    AVIOContext *pb = ts->stream->pb;
+    const int raw_packet_size = ts->raw_packet_size;
+    const uint8_t *block = pb->buf_ptr;
+    int64_t pos = avio_tell(pb);
+    int nb = FFMIN((pb->buf_end - pb->buf_ptr) / raw_packet_size, max_packets);
+    int i, ret = 0;
+
+    if (nb < 2)
+        return 0;
+
+    for (i = 0; i < nb; i++)
+        if (block[i * raw_packet_size] != 0x47)
+            break;
+    nb = i;
+
+    for (i = 0; i < nb;) {
+        const uint8_t *packet = block + i * raw_packet_size;
+        int action   = ts->pid_action[AV_RB16(packet + 1) & 0x1fff];
+        int is_start = packet[1] & 0x40;
+
+        i++;
+        if (action == MPEGTS_PID_DROP && !(ts->auto_guess && is_start) ||
+            action == MPEGTS_PID_DISCARDED && !is_start)
+            continue;
+        ret = handle_packet(ts, packet, pos + (i - 1) * raw_packet_size + TS_PACKET_SIZE);
+        if (ret < 0 || ts->stop_parse)
+            break;
+    }
+    avio_skip(pb, (int64_t)i * raw_packet_size);
+    return ret < 0 ? ret : i;
+}
+
 static int handle_packets(MpegTSContext *ts, int64_t nb_packets)
 {
     AVFormatContext *s = ts->stream;
@@ -3006,6 +3148,17 @@ static int handle_packets(MpegTSContext *ts, int64_t nb_packets)
         if (ts->stop_parse > 0)
             break;
 
+        if (ts->bulk_read) {
+            ret = handle_packets_bulk(ts, nb_packets ? nb_packets - packet_num : INT64_MAX);
+            if (ret < 0)
+                break;
+            if (ret > 0) {
+                packet_num += ret - 1;
+                ret = 0;
+                continue;
+            }
+        }
+
         ret = read_packet(s, packet, ts->raw_packet_size, &data);
         if (ret != 0)
             break;
@@ -3130,7 +3283,9 @@ static int mpegts_read_header(AVFormatContext *s)
         handle_packets(ts, probesize / ts->raw_packet_size);
         /* if could not find service, enable auto_guess */
 
-        ts->auto_guess = 1;
+        /* but not in subtitle-only mode, where guessing would add streams
+         * for the PIDs skipped in the PMT */
+        ts->auto_guess = !ts->subtitles_only;
 
         av_log(ts->stream, AV_LOG_TRACE, "tuning done\n");
 
@@ -126,6 +126,10 @@ typedef struct MpegTSWrite {
     uint8_t provider_name[256];
 
     int omit_video_pes_length;
+
+    int write_batch;        ///< number of TS packets gathered per avio_write(), 0 to disable
+    uint8_t *write_buf;     ///< TS packets waiting to be written
+    int write_buf_len;
 } MpegTSWrite;
 
 /* a PES packet header is generated every DEFAULT_PES_HEADER_FREQ packets */
@@ -953,9 +957,44 @@ static int64_t get_pcr(const MpegTSWrite *ts)
            ts->first_pcr;
 }
 
+static void flush_write_buf(AVFormatContext *s)
+{
+    MpegTSWrite *ts = s->priv_data;
+
+    if (ts->write_buf_len) {
+        avio_write(s->pb, ts->write_buf, ts->write_buf_len);
+        ts->write_buf_len = 0;
+    }
+}
+
+/* Return where the next TS packet should be built: in the write buffer
+ * when batching, so that write_packet() does not have to copy it. */
+static uint8_t *get_packet_buf(MpegTSWrite *ts, uint8_t *buf)
+{
+    if (!ts->write_buf)
+        return buf;
+    return ts->write_buf + ts->write_buf_len + (ts->m2ts_mode ? 4 : 0);
+}
+
 static void write_packet(AVFormatContext *s, const uint8_t *packet)
 {
     MpegTSWrite *ts = s->priv_data;
+
+    if (ts->write_buf) {
+        uint8_t *q = ts->write_buf + ts->write_buf_len;
+        if (ts->m2ts_mode) {
+            AV_WB32(q, get_pcr(ts) % 0x3fffffff);
+            q += 4;
+        }
+        if (packet != q)
+            memcpy(q, packet, TS_PACKET_SIZE);
+        ts->write_buf_len = q + TS_PACKET_SIZE - ts->write_buf;
+        ts->total_size += TS_PACKET_SIZE;
+        if (ts->write_buf_len >= ts->write_batch * (TS_PACKET_SIZE + 4 * !!ts->m2ts_mode))
+            flush_write_buf(s);
+        return;
+    }
+
     if (ts->m2ts_mode) {
         int64_t pcr = get_pcr(s->priv_data);
         uint32_t tp_extra_header = pcr % 0x3fffffff;
@@ -1107,6 +1146,12 @@ static int mpegts_init(AVFormatContext *s)
         }
     }
 
+    if (ts->write_batch) {
+        ts->write_buf = av_malloc(ts->write_batch * (TS_PACKET_SIZE + 4));
+        if (!ts->write_buf)
+            return AVERROR(ENOMEM);
+    }
+
     if (s->max_delay < 0) /* Not set by the caller */
         s->max_delay = 0;
 
@@ -1344,7 +1389,8 @@ static int write_pcr_bits(uint8_t *buf, int64_t pcr)
 static void mpegts_insert_null_packet(AVFormatContext *s)
 {
     uint8_t *q;
-    uint8_t buf[TS_PACKET_SIZE];
+    uint8_t packet_buf[TS_PACKET_SIZE];
+    uint8_t *buf = get_packet_buf(s->priv_data, packet_buf);
 
     q    = buf;
     *q++ = 0x47;
@@ -1361,7 +1407,8 @@ static void mpegts_insert_pcr_only(AVFormatContext *s, AVStream *st)
     MpegTSWrite *ts = s->priv_data;
     MpegTSWriteStream *ts_st = st->priv_data;
     uint8_t *q;
-    uint8_t buf[TS_PACKET_SIZE];
+    uint8_t packet_buf[TS_PACKET_SIZE];
+    uint8_t *buf = get_packet_buf(ts, packet_buf);
 
     q    = buf;
     *q++ = 0x47;
@@ -1471,7 +1518,8 @@ static void mpegts_write_pes(AVFormatContext *s, AVStream *st,
 {
     MpegTSWriteStream *ts_st = st->priv_data;
     MpegTSWrite *ts = s->priv_data;
-    uint8_t buf[TS_PACKET_SIZE];
+    uint8_t packet_buf[TS_PACKET_SIZE];
+    uint8_t *buf = packet_buf;
     uint8_t *q;
     int val, is_start, len, header_len, write_pcr, flags;
     int afc_len, stuffing_len;
@@ -1551,6 +1599,7 @@ static void mpegts_write_pes(AVFormatContext *s, AVStream *st,
         }
 
         /* prepare packet header */
+        buf  = get_packet_buf(ts, packet_buf);
         q    = buf;
         *q++ = 0x47;
         val  = ts_st->pid >> 8;
@@ -2164,7 +2213,9 @@ static void mpegts_write_flush(AVFormatContext *s)
     }
 
     if (ts->m2ts_mode) {
-        int packets = (avio_tell(s->pb) / (TS_PACKET_SIZE + 4)) % 32;
+        int packets;
+        flush_write_buf(s);
+        packets = (avio_tell(s->pb) / (TS_PACKET_SIZE + 4)) % 32;
         while (packets++ < 32)
             mpegts_insert_null_packet(s);
     }
@@ -2172,18 +2223,26 @@ static void mpegts_write_flush(AVFormatContext *s)
 
 static int mpegts_write_packet(AVFormatContext *s, AVPacket *pkt)
 {
+    int ret;
+
     if (!pkt) {
         mpegts_write_flush(s);
-        return 1;
+        ret = 1;
     } else {
-        return mpegts_write_packet_internal(s, pkt);
+        ret = mpegts_write_packet_internal(s, pkt);
     }
+    /* Only batch the TS packets of one call, the caller may switch or
+     * flush s->pb between calls (e.g. segmenting muxers). */
+    flush_write_buf(s);
+    return ret;
 }
 
 static int mpegts_write_end(AVFormatContext *s)
 {
-    if (s->pb)
+    if (s->pb) {
         mpegts_write_flush(s);
+        flush_write_buf(s);
+    }
 
     return 0;
 }
@@ -2212,6 +2271,7 @@ static void mpegts_deinit(AVFormatContext *s)
         av_freep(&service);
     }
     av_freep(&ts->services);
+    av_freep(&ts->write_buf);
 }
 
 static int mpegts_check_bitstream(AVFormatContext *s, AVStream *st,
@@ -2290,6 +2350,8 @@ static const AVOption options[] = {
     { "tables_version", "set PAT, PMT, SDT and NIT version", OFFSET(tables_version), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 31, ENC },
     { "omit_video_pes_length", "Omit the PES packet length for video packets",
       OFFSET(omit_video_pes_length), AV_OPT_TYPE_BOOL, { .i64 = 1 }, 0, 1, ENC },
+    { "write_batch", "Number of TS packets gathered before writing them out, 0 to disable",
+      OFFSET(write_batch), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 4096, ENC },
     { "pcr_period", "PCR retransmission time in milliseconds",
       OFFSET(pcr_period_ms), AV_OPT_TYPE_INT, { .i64 = -1 }, -1, INT_MAX, ENC },
     { "pat_period", "PAT/PMT retransmission time limit in seconds",
@@ -31,6 +31,7 @@
 #include "avformat.h"
 #include "internal.h"
 #include "mux.h"
+#include "subsplit.h"
 
 #include "libavutil/avassert.h"
 #include "libavutil/internal.h"
@@ -117,6 +118,8 @@ typedef struct SegmentContext {
     int   reference_stream_index;
     int   break_non_keyframes;
     int   write_empty;
+    int   subtitle_split;  ///< enum SubSplitMode
+    SubSplitContext subsplit;
 
     int use_rename;
     char temp_list_filename[1024];
@@ -654,6 +657,7 @@ static void seg_free(AVFormatContext *s)
         avformat_free_context(seg->avf);
         seg->avf = NULL;
     }
+    ff_subsplit_uninit(&seg->subsplit);
     av_freep(&seg->times);
     av_freep(&seg->frames);
     av_freep(&seg->cur_entry.filename);
@@ -667,6 +671,39 @@ static void seg_free(AVFormatContext *s)
     }
 }
 
+static int seg_write_chained(AVFormatContext *s, AVPacket *pkt)
+{
+    SegmentContext *seg = s->priv_data;
+    AVStream *st = s->streams[pkt->stream_index];
+    int64_t offset;
+
+    av_log(s, AV_LOG_DEBUG, "stream:%d start_pts_time:%s pts:%s pts_time:%s dts:%s dts_time:%s",
+           pkt->stream_index,
+           av_ts2timestr(seg->cur_entry.start_pts, &AV_TIME_BASE_Q),
+           av_ts2str(pkt->pts), av_ts2timestr(pkt->pts, &st->time_base),
+           av_ts2str(pkt->dts), av_ts2timestr(pkt->dts, &st->time_base));
+
+    /* compute new timestamps */
+    offset = av_rescale_q(seg->initial_offset - (seg->reset_timestamps ? seg->cur_entry.start_pts : 0),
+                          AV_TIME_BASE_Q, st->time_base);
+    if (pkt->pts != AV_NOPTS_VALUE)
+        pkt->pts += offset;
+    if (pkt->dts != AV_NOPTS_VALUE)
+        pkt->dts += offset;
+
+    av_log(s, AV_LOG_DEBUG, " -> pts:%s pts_time:%s dts:%s dts_time:%s\n",
+           av_ts2str(pkt->pts), av_ts2timestr(pkt->pts, &st->time_base),
+           av_ts2str(pkt->dts), av_ts2timestr(pkt->dts, &st->time_base));
+
+    return ff_write_chained(seg->avf, pkt->stream_index, pkt, s,
+                            seg->initial_offset || seg->reset_timestamps || seg->avf->oformat->interleave_packet);
+}
+
+static int seg_write_subtitle(AVFormatContext *s, void *opaque, AVPacket *pkt)
+{
+    return seg_write_chained(s, pkt);
+}
+
 static int seg_init(AVFormatContext *s)
 {
     SegmentContext *seg = s->priv_data;
@@ -738,6 +775,17 @@ static int seg_init(AVFormatContext *s)
            seg->reference_stream_index,
            av_get_media_type_string(s->streams[seg->reference_stream_index]->codecpar->codec_type));
 
+    if (seg->subtitle_split == SUBSPLIT_REPEAT && !seg->individual_header_trailer) {
+        av_log(s, AV_LOG_WARNING, "Subtitle events can not be repeated "
+               "without individual_header_trailer, splitting them instead.\n");
+        seg->subtitle_split = SUBSPLIT_SPLIT;
+    }
+    seg->subsplit.mode         = seg->subtitle_split;
+    seg->subsplit.s            = s;
+    seg->subsplit.write_packet = seg_write_subtitle;
+    if ((ret = ff_subsplit_init(&seg->subsplit)) < 0)
+        return ret;
+
     seg->oformat = av_guess_format(seg->format, s->url, NULL);
 
     if (!seg->oformat)
@@ -839,7 +887,7 @@ static int seg_write_packet(AVFormatContext *s, AVPacket *pkt)
 {
     SegmentContext *seg = s->priv_data;
     AVStream *st = s->streams[pkt->stream_index];
-    int64_t end_pts = INT64_MAX, offset;
+    int64_t end_pts = INT64_MAX;
     int start_frame = INT_MAX;
     int ret;
     struct tm ti;
@@ -901,6 +949,11 @@ calc_times:
         if (seg->cur_entry.last_duration == 0)
             seg->cur_entry.end_time = (double)pkt->pts * av_q2d(st->time_base);
 
+        if (seg->subtitle_split &&
+            (ret = ff_subsplit_cut(&seg->subsplit, av_rescale_q(pkt->pts, st->time_base,
+                                                                AV_TIME_BASE_Q))) < 0)
+            goto fail;
+
         if ((ret = segment_end(s, seg->individual_header_trailer, 0)) < 0)
             goto fail;
 
@@ -930,26 +983,24 @@ calc_times:
                av_ts2str(pkt->pts), av_ts2timestr(pkt->pts, &st->time_base), seg->frame_count);
     }
 
-    av_log(s, AV_LOG_DEBUG, "stream:%d start_pts_time:%s pts:%s pts_time:%s dts:%s dts_time:%s",
-           pkt->stream_index,
-           av_ts2timestr(seg->cur_entry.start_pts, &AV_TIME_BASE_Q),
-           av_ts2str(pkt->pts), av_ts2timestr(pkt->pts, &st->time_base),
-           av_ts2str(pkt->dts), av_ts2timestr(pkt->dts, &st->time_base));
-
-    /* compute new timestamps */
-    offset = av_rescale_q(seg->initial_offset - (seg->reset_timestamps ? seg->cur_entry.start_pts : 0),
-                          AV_TIME_BASE_Q, st->time_base);
-    if (pkt->pts != AV_NOPTS_VALUE)
-        pkt->pts += offset;
-    if (pkt->dts != AV_NOPTS_VALUE)
-        pkt->dts += offset;
+    if (seg->subtitle_split) {
+        /* The next boundary is no earlier than the next reference packet
+         * and, for time based cuts, the next segment end time. */
+        int64_t next_cut = seg->frames || seg->use_clocktime ? INT64_MIN :
+                           end_pts - seg->time_delta;
+        if (pkt->stream_index == seg->reference_stream_index && pkt->dts != AV_NOPTS_VALUE)
+            next_cut = FFMAX(next_cut, av_rescale_q(pkt->dts, st->time_base, AV_TIME_BASE_Q));
+        if ((ret = ff_subsplit_advance(&seg->subsplit, next_cut)) < 0)
+            goto fail;
 
-    av_log(s, AV_LOG_DEBUG, " -> pts:%s pts_time:%s dts:%s dts_time:%s\n",
-           av_ts2str(pkt->pts), av_ts2timestr(pkt->pts, &st->time_base),
-           av_ts2str(pkt->dts), av_ts2timestr(pkt->dts, &st->time_base));
+        if (pkt->stream_index != seg->reference_stream_index &&
+            ff_subsplit_handles(&seg->subsplit, pkt)) {
+            ret = ff_subsplit_write_packet(&seg->subsplit, pkt);
+            goto fail;
+        }
+    }
 
-    ret = ff_write_chained(seg->avf, pkt->stream_index, pkt, s,
-                           seg->initial_offset || seg->reset_timestamps || seg->avf->oformat->interleave_packet);
+    ret = seg_write_chained(s, pkt);
 
 fail:
     /* Use st->index here as the packet returned from ff_write_chained()
@@ -971,6 +1022,9 @@ static int seg_write_trailer(struct AVFormatContext *s)
     if (!oc)
         return 0;
 
+    if ((ret = ff_subsplit_flush(&seg->subsplit)) < 0)
+        return ret;
+
     if (!seg->write_header_trailer) {
         if ((ret = segment_end(s, 0, 1)) < 0)
             return ret;
@@ -1046,6 +1100,10 @@ static const AVOption options[] = {
     { "reset_timestamps", "reset timestamps at the beginning of each segment", OFFSET(reset_timestamps), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, E },
     { "initial_offset", "set initial timestamp offset", OFFSET(initial_offset), AV_OPT_TYPE_DURATION, {.i64 = 0}, -INT64_MAX, INT64_MAX, E },
     { "write_empty_segments", "allow writing empty 'filler' segments", OFFSET(write_empty), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, E },
+    { "segment_subtitle_split", "set how subtitle events crossing segment boundaries are written", OFFSET(subtitle_split), AV_OPT_TYPE_INT, {.i64 = SUBSPLIT_NONE}, 0, SUBSPLIT_NB - 1, E, "subtitle_split" },
+    { "none",   "write events into the segment they start in", 0, AV_OPT_TYPE_CONST, {.i64 = SUBSPLIT_NONE },   0, 0, E, "subtitle_split" },
+    { "split",  "cut events at segment boundaries",            0, AV_OPT_TYPE_CONST, {.i64 = SUBSPLIT_SPLIT },  0, 0, E, "subtitle_split" },
+    { "repeat", "repeat events in every segment they overlap", 0, AV_OPT_TYPE_CONST, {.i64 = SUBSPLIT_REPEAT }, 0, 0, E, "subtitle_split" },
     { NULL },
 };
 
@@ -0,0 +1,195 @@
+/*
+ * Splitting of subtitle events at segment boundaries
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/mathematics.h"
+#include "libavutil/mem.h"
+#include "libavcodec/codec_desc.h"
+#include "subsplit.h"
+
+/* Upper bound for the number of held events; only reached if the segmenter
+ * does not announce its progress, e.g. with a sparse reference stream. */
+#define MAX_QUEUED 256
+
+static AVRational packet_tb(const SubSplitContext *ctx, const AVPacket *pkt)
+{
+    return ctx->s->streams[pkt->stream_index]->time_base;
+}
+
+static int64_t packet_end(const SubSplitContext *ctx, const AVPacket *pkt)
+{
+    return av_rescale_q(pkt->pts + pkt->duration, packet_tb(ctx, pkt),
+                        AV_TIME_BASE_Q);
+}
+
+/* Make pkt start at time (in the packet time base), keeping its end. */
+static void move_start(AVPacket *pkt, int64_t time)
+{
+    int64_t delta = time - pkt->pts;
+
+    pkt->pts      += delta;
+    pkt->duration -= delta;
+    if (pkt->dts != AV_NOPTS_VALUE)
+        pkt->dts  += delta;
+}
+
+static int write_and_unref(SubSplitContext *ctx, AVPacket *pkt)
+{
+    int ret = ctx->write_packet(ctx->s, ctx->opaque, pkt);
+    av_packet_unref(pkt);
+    return ret;
+}
+
+static int write_queued(SubSplitContext *ctx, int64_t until)
+{
+    while (ctx->queue.head &&
+           packet_end(ctx, &ctx->queue.head->pkt) <= until) {
+        int ret;
+
+        avpriv_packet_list_get(&ctx->queue, ctx->pkt);
+        ctx->nb_queued--;
+        if ((ret = write_and_unref(ctx, ctx->pkt)) < 0)
+            return ret;
+    }
+    return 0;
+}
+
+int ff_subsplit_init(SubSplitContext *ctx)
+{
+    ctx->safe_time = INT64_MIN;
+    ctx->cut_time  = AV_NOPTS_VALUE;
+    ctx->pkt       = av_packet_alloc();
+    if (!ctx->pkt)
+        return AVERROR(ENOMEM);
+    return 0;
+}
+
+int ff_subsplit_handles(const SubSplitContext *ctx, const AVPacket *pkt)
+{
+    const AVCodecParameters *par = ctx->s->streams[pkt->stream_index]->codecpar;
+    const AVCodecDescriptor *desc;
+
+    if (ctx->mode == SUBSPLIT_NONE || par->codec_type != AVMEDIA_TYPE_SUBTITLE)
+        return 0;
+    /* Bitmap subtitles carry their display time in the bitstream. */
+    desc = avcodec_descriptor_get(par->codec_id);
+    if (!desc || !(desc->props & AV_CODEC_PROP_TEXT_SUB))
+        return 0;
+    return pkt->pts != AV_NOPTS_VALUE && pkt->duration > 0;
+}
+
+int ff_subsplit_write_packet(SubSplitContext *ctx, const AVPacket *pkt)
+{
+    AVPacket *const out = ctx->pkt;
+    int ret;
+
+    if ((ret = av_packet_ref(out, pkt)) < 0)
+        return ret;
+
+    /* Late event crossing a boundary which has already been written. */
+    if (ctx->mode == SUBSPLIT_SPLIT && ctx->cut_time != AV_NOPTS_VALUE) {
+        int64_t cut = av_rescale_q(ctx->cut_time, AV_TIME_BASE_Q,
+                                   packet_tb(ctx, out));
+        if (out->pts < cut && out->pts + out->duration > cut)
+            move_start(out, cut);
+    }
+
+    if (!ctx->queue.head && packet_end(ctx, out) <= ctx->safe_time)
+        return write_and_unref(ctx, out);
+
+    if ((ret = avpriv_packet_list_put(&ctx->queue, out, NULL, 0)) < 0) {
+        av_packet_unref(out);
+        return ret;
+    }
+    ctx->nb_queued++;
+
+    if (ctx->nb_queued > MAX_QUEUED) {
+        if (!ctx->overflow_warned) {
+            av_log(ctx->s, AV_LOG_WARNING, "Too many subtitle events waiting "
+                   "for a segment boundary, writing them without splitting.\n");
+            ctx->overflow_warned = 1;
+        }
+        avpriv_packet_list_get(&ctx->queue, out);
+        ctx->nb_queued--;
+        return write_and_unref(ctx, out);
+    }
+
+    return 0;
+}
+
+int ff_subsplit_advance(SubSplitContext *ctx, int64_t time)
+{
+    ctx->safe_time = FFMAX(ctx->safe_time, time);
+    return write_queued(ctx, ctx->safe_time);
+}
+
+int ff_subsplit_cut(SubSplitContext *ctx, int64_t time)
+{
+    PacketListEntry **next = &ctx->queue.head, *entry;
+    int ret = 0;
+
+    while ((entry = *next)) {
+        AVPacket *const pkt = &entry->pkt;
+        int64_t cut = av_rescale_q(time, AV_TIME_BASE_Q, packet_tb(ctx, pkt));
+
+        if (pkt->pts >= cut) {
+            next = &entry->next;
+            continue;
+        }
+
+        if ((ret = av_packet_ref(ctx->pkt, pkt)) < 0)
+            break;
+        if (ctx->mode == SUBSPLIT_SPLIT)
+            ctx->pkt->duration = FFMIN(pkt->duration, cut - pkt->pts);
+        if ((ret = write_and_unref(ctx, ctx->pkt)) < 0)
+            break;
+
+        if (pkt->pts + pkt->duration > cut) {
+            if (ctx->mode == SUBSPLIT_SPLIT)
+                move_start(pkt, cut);
+            next = &entry->next;
+        } else {
+            *next = entry->next;
+            av_packet_unref(pkt);
+            av_free(entry);
+            ctx->nb_queued--;
+        }
+    }
+
+    ctx->queue.tail = NULL;
+    for (entry = ctx->queue.head; entry; entry = entry->next)
+        ctx->queue.tail = entry;
+
+    ctx->cut_time  = time;
+    ctx->safe_time = FFMAX(ctx->safe_time, time);
+
+    return ret;
+}
+
+int ff_subsplit_flush(SubSplitContext *ctx)
+{
+    return write_queued(ctx, INT64_MAX);
+}
+
+void ff_subsplit_uninit(SubSplitContext *ctx)
+{
+    avpriv_packet_list_free(&ctx->queue);
+    ctx->nb_queued = 0;
+    av_packet_free(&ctx->pkt);
+}
@@ -0,0 +1,101 @@
+/*
+ * Splitting of subtitle events at segment boundaries
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFORMAT_SUBSPLIT_H
+#define AVFORMAT_SUBSPLIT_H
+
+#include <stdint.h>
+
+#include "libavcodec/packet_internal.h"
+#include "avformat.h"
+
+enum SubSplitMode {
+    SUBSPLIT_NONE,   ///< write events unmodified into the segment they start in
+    SUBSPLIT_SPLIT,  ///< cut events at segment boundaries
+    SUBSPLIT_REPEAT, ///< write events unmodified into every segment they overlap
+    SUBSPLIT_NB,
+};
+
+/**
+ * Segmenting muxers hand their text subtitle packets to this context
+ * instead of writing them directly. A packet is only held back as long as
+ * it may still cross the next segment boundary; everything ending before
+ * the earliest possible boundary is passed through at once, so at most the
+ * events around a boundary are buffered, not whole segments.
+ *
+ * All times given to the functions below are in AV_TIME_BASE units.
+ */
+typedef struct SubSplitContext {
+    int mode;                   ///< enum SubSplitMode
+    AVFormatContext *s;
+    void *opaque;
+    /**
+     * Write a subtitle packet into the current segment. The packet is in
+     * the time base of its stream in s and does not need to be left intact.
+     */
+    int (*write_packet)(AVFormatContext *s, void *opaque, AVPacket *pkt);
+
+    AVPacket *pkt;
+    PacketList queue;
+    int nb_queued;
+    int64_t safe_time;          ///< no boundary can happen before this time
+    int64_t cut_time;           ///< time of the last boundary
+    int overflow_warned;
+} SubSplitContext;
+
+/**
+ * Initialize the context. mode, s, opaque and write_packet must be set
+ * before calling this.
+ */
+int ff_subsplit_init(SubSplitContext *ctx);
+
+/**
+ * @return 1 if pkt has to be passed to ff_subsplit_write_packet() instead
+ *         of being written directly, 0 otherwise
+ */
+int ff_subsplit_handles(const SubSplitContext *ctx, const AVPacket *pkt);
+
+/**
+ * Write pkt, or hold it back until it is known whether it crosses the next
+ * boundary. The packet is not modified.
+ */
+int ff_subsplit_write_packet(SubSplitContext *ctx, const AVPacket *pkt);
+
+/**
+ * Announce that no boundary can happen before time, and write the held
+ * packets that end before it.
+ */
+int ff_subsplit_advance(SubSplitContext *ctx, int64_t time);
+
+/**
+ * Write the held packets starting before the boundary at time into the
+ * current segment, cut or repeated according to the mode. Must be called
+ * before the current segment is closed.
+ */
+int ff_subsplit_cut(SubSplitContext *ctx, int64_t time);
+
+/**
+ * Write all held packets unmodified, e.g. before the last segment is closed.
+ */
+int ff_subsplit_flush(SubSplitContext *ctx);
+
+void ff_subsplit_uninit(SubSplitContext *ctx);
+
+#endif /* AVFORMAT_SUBSPLIT_H */
@@ -27,6 +27,16 @@
 #define _DEFAULT_SOURCE
 #define _BSD_SOURCE     /* Needed for using struct ip_mreq with recent glibc */
 
+#include "config.h"
+
+#if HAVE_RECVMMSG || HAVE_SENDMMSG
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE     /* Needed for recvmmsg() and sendmmsg() */
+#endif
+#endif
+
+#include <stdatomic.h>
+
 #include "avformat.h"
 #include "avio_internal.h"
 #include "libavutil/avassert.h"
@@ -79,6 +89,26 @@
 #define UDP_RX_BUF_SIZE 393216
 #define UDP_MAX_PKT_SIZE 65536
 #define UDP_HEADER_SIZE 8
+#define UDP_MAX_BATCH_SIZE 1024
+#define UDP_RX_SLOT_SIZE 1472
+/* cap on the receive buffers of a batch, which need room for the largest
+ * datagram in every slot */
+#define UDP_MAX_RX_BATCH_BUF (4 << 20)
+
+#if HAVE_RECVMMSG || HAVE_SENDMMSG
+/* Datagram slots for recvmmsg()/sendmmsg(). */
+typedef struct UDPBatch {
+    struct mmsghdr *msgs;
+    struct iovec *iov;
+    struct sockaddr_storage *addrs;
+    uint8_t *buf;
+    int slot_size;
+    int nb_slots;
+    int nb;             /* number of filled slots */
+    int64_t deadline;   /* time by which the queued datagrams are sent (tx) */
+    int pos;            /* first slot not yet consumed (rx) or sent (tx) */
+} UDPBatch;
+#endif
 
 typedef struct UDPContext {
     const AVClass *class;
@@ -98,8 +128,23 @@ typedef struct UDPContext {
 
     /* Circular Buffer variables for use in UDP receive code */
     int circular_buffer_size;
-    AVFifo *fifo;
-    int circular_buffer_error;
+    AVFifo *fifo;       /* transmit queue of the bitrate thread */
+    atomic_int circular_buffer_error;
+    int merge_datagrams;
+    /* Lock-free single-producer/single-consumer ring of fixed-size slots
+     * filled by the receive thread; head and tail only ever increase.
+     * A datagram takes as many consecutive slots as it needs; ring_len of
+     * its first slot holds its size, or minus the number of slots to skip
+     * (at the end of the ring, or left by a dropped datagram). */
+    uint8_t *ring_buf;
+    int *ring_len;
+    unsigned ring_slots;
+    int ring_slot_size;
+    unsigned ring_max_run;  /* slots taken by the largest datagram */
+    atomic_uint ring_head;
+    atomic_uint ring_tail;
+    atomic_int reader_waiting;
+    atomic_uint nb_overruns;
     int64_t bitrate; /* number of bits to send per second */
     int64_t burst_bits;
     int close_req;
@@ -117,6 +162,14 @@ typedef struct UDPContext {
     char *sources;
     char *block;
     IPSourceFilters filters;
+    int batch_size;
+    int batch_delay;
+#if HAVE_RECVMMSG
+    UDPBatch rx_batch;
+#endif
+#if HAVE_SENDMMSG
+    UDPBatch tx_batch;
+#endif
 } UDPContext;
 
 #define OFFSET(x) offsetof(UDPContext, x)
@@ -138,9 +191,12 @@ static const AVOption options[] = {
     { "connect",        "set if connect() should be called on socket",     OFFSET(is_connected),   AV_OPT_TYPE_BOOL,   { .i64 =  0 },     0, 1,       .flags = D|E },
     { "fifo_size",      "set the UDP receiving circular buffer size, expressed as a number of packets with size of 188 bytes", OFFSET(circular_buffer_size), AV_OPT_TYPE_INT, {.i64 = 7*4096}, 0, INT_MAX, D },
     { "overrun_nonfatal", "survive in case of UDP receiving circular buffer overrun", OFFSET(overrun_nonfatal), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1,    D },
+    { "merge_datagrams", "return as many whole datagrams as fit per read from the circular buffer", OFFSET(merge_datagrams), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, D },
     { "timeout",        "set raise error timeout, in microseconds (only in read mode)",OFFSET(timeout),         AV_OPT_TYPE_INT,  {.i64 = 0}, 0, INT_MAX, D },
     { "sources",        "Source list",                                     OFFSET(sources),        AV_OPT_TYPE_STRING, { .str = NULL },               .flags = D|E },
     { "block",          "Block list",                                      OFFSET(block),          AV_OPT_TYPE_STRING, { .str = NULL },               .flags = D|E },
+    { "batch_size",     "Number of datagrams per system call (recvmmsg/sendmmsg)", OFFSET(batch_size), AV_OPT_TYPE_INT, { .i64 = 1 },     1, UDP_MAX_BATCH_SIZE, .flags = D|E },
+    { "batch_delay",    "Maximum time a datagram is held in the send batch, in microseconds", OFFSET(batch_delay), AV_OPT_TYPE_INT, { .i64 = 5000 }, 0, INT_MAX, .flags = E },
     { NULL }
 };
 
@@ -480,65 +536,323 @@ static int udp_get_file_handle(URLContext *h)
     return s->udp_fd;
 }
 
+#if HAVE_RECVMMSG || HAVE_SENDMMSG
+static void udp_batch_free(UDPBatch *b)
+{
+    av_freep(&b->msgs);
+    av_freep(&b->iov);
+    av_freep(&b->addrs);
+    av_freep(&b->buf);
+    b->nb = b->pos = 0;
+}
+
+static int udp_batch_alloc(UDPBatch *b, int nb_slots, int slot_size)
+{
+    b->msgs  = av_calloc(nb_slots, sizeof(*b->msgs));
+    /* a second vector per datagram for the ring spill buffers */
+    b->iov   = av_calloc(2 * nb_slots, sizeof(*b->iov));
+    b->addrs = av_calloc(nb_slots, sizeof(*b->addrs));
+    if (slot_size)
+        b->buf = av_malloc_array(nb_slots, slot_size);
+    if (!b->msgs || !b->iov || !b->addrs || (slot_size && !b->buf)) {
+        udp_batch_free(b);
+        return AVERROR(ENOMEM);
+    }
+    b->slot_size = slot_size;
+    b->nb_slots  = nb_slots;
+    for (int i = 0; i < nb_slots; i++) {
+        if (b->buf) {
+            b->iov[2 * i].iov_base = b->buf + (size_t)i * slot_size;
+            b->iov[2 * i].iov_len  = slot_size;
+        }
+        b->msgs[i].msg_hdr.msg_iov    = &b->iov[2 * i];
+        b->msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    return 0;
+}
+#endif
+
+#if HAVE_RECVMMSG
+/**
+ * Receive up to nb datagrams with a single recvmmsg() call.
+ * @return number of datagrams received or a negative error code
+ */
+static int udp_recv_batch(UDPContext *s, int nb, int flags)
+{
+    UDPBatch *b = &s->rx_batch;
+    int ret;
+
+    for (int i = 0; i < nb; i++) {
+        b->msgs[i].msg_hdr.msg_name    = &b->addrs[i];
+        b->msgs[i].msg_hdr.msg_namelen = sizeof(b->addrs[i]);
+    }
+    ret = recvmmsg(s->udp_fd, b->msgs, nb, flags, NULL);
+    if (ret < 0)
+        return ff_neterrno();
+    b->nb  = ret;
+    b->pos = 0;
+    return ret;
+}
+#endif
+
+#if HAVE_SENDMMSG
+/**
+ * Send the queued datagrams, starting with the first unsent one.
+ */
+static int udp_flush_batch(URLContext *h, int nonblock)
+{
+    UDPContext *s = h->priv_data;
+    UDPBatch *b = &s->tx_batch;
+    int ret;
+
+    for (int i = b->pos; i < b->nb; i++) {
+        b->msgs[i].msg_hdr.msg_name    = s->is_connected ? NULL : &s->dest_addr;
+        b->msgs[i].msg_hdr.msg_namelen = s->is_connected ? 0    : s->dest_addr_len;
+    }
+    while (b->pos < b->nb) {
+        if (!nonblock) {
+            ret = ff_network_wait_fd(s->udp_fd, 1);
+            if (ret < 0)
+                return ret;
+        }
+        ret = sendmmsg(s->udp_fd, b->msgs + b->pos, b->nb - b->pos, 0);
+        if (ret < 0) {
+            ret = ff_neterrno();
+            if (ret == AVERROR(EINTR) || (ret == AVERROR(EAGAIN) && !nonblock))
+                continue;
+            return ret;
+        }
+        b->pos += ret;
+    }
+    b->nb = b->pos = 0;
+    return 0;
+}
+#endif
+
 #if HAVE_PTHREAD_CANCEL
+static inline uint8_t *ring_slot(UDPContext *s, unsigned idx)
+{
+    return s->ring_buf + (size_t)(idx & (s->ring_slots - 1)) * s->ring_slot_size;
+}
+
+/**
+ * Number of slots taken by a datagram of len bytes.
+ */
+static inline unsigned ring_run(UDPContext *s, int len)
+{
+    return len > s->ring_slot_size ? (len + s->ring_slot_size - 1) / s->ring_slot_size : 1;
+}
+
+/**
+ * Return the number of contiguous free slots from *head on. If fewer than
+ * need slots are left before the end of the ring, the end is skipped when
+ * that leaves enough room at its start.
+ */
+static unsigned ring_reserve(UDPContext *s, unsigned *head, unsigned need)
+{
+    unsigned tail  = atomic_load_explicit(&s->ring_tail, memory_order_acquire);
+    unsigned space = s->ring_slots - (*head - tail);
+    unsigned end   = s->ring_slots - (*head & (s->ring_slots - 1));
+
+    if (end < need && space - end >= need) {
+        s->ring_len[*head & (s->ring_slots - 1)] = -(int)end;
+        *head += end;
+        space -= end;
+        end    = s->ring_slots;
+    }
+    return FFMIN(space, end);
+}
+
+static void circular_buffer_wake_reader(UDPContext *s, int force)
+{
+    if (force || atomic_load(&s->reader_waiting)) {
+        pthread_mutex_lock(&s->mutex);
+        pthread_cond_signal(&s->cond);
+        pthread_mutex_unlock(&s->mutex);
+    }
+}
+
+/**
+ * Account for a datagram received while the ring is full.
+ */
+static int circular_buffer_overrun(URLContext *h)
+{
+    UDPContext *s = h->priv_data;
+
+    atomic_fetch_add_explicit(&s->nb_overruns, 1, memory_order_relaxed);
+    if (s->overrun_nonfatal) {
+        av_log(h, AV_LOG_WARNING, "Circular buffer overrun. "
+                "Surviving due to overrun_nonfatal option\n");
+        return 0;
+    }
+    av_log(h, AV_LOG_ERROR, "Circular buffer overrun. "
+            "To avoid, increase fifo_size URL option. "
+            "To survive in such case, use overrun_nonfatal option\n");
+    return AVERROR(EIO);
+}
+
+#if HAVE_RECVMMSG
+/**
+ * Lay out the datagrams of a batch received into consecutive slots from
+ * head on, with the parts longer than a slot in the spill buffers.
+ * Datagrams are moved if an earlier one is longer than a slot; datagrams
+ * which are filtered out or do not fit into free slots leave their slot
+ * unused, so that the others are only ever moved towards the end.
+ *
+ * @return index following the last stored datagram, or a negative error
+ */
+static int64_t circular_buffer_store_batch(URLContext *h, unsigned head,
+                                           unsigned free, int nb)
+{
+    UDPContext *s = h->priv_data;
+    UDPBatch *b = &s->rx_batch;
+    unsigned pos[UDP_MAX_BATCH_SIZE];
+    int lens[UDP_MAX_BATCH_SIZE];
+    unsigned dst = head;
+    int stored = 0, ret;
+
+    for (int i = 0; i < nb; i++) {
+        lens[i] = b->msgs[i].msg_len;
+        if (b->msgs[i].msg_hdr.msg_flags & MSG_TRUNC)
+            av_log(h, AV_LOG_WARNING, "Part of datagram lost due to insufficient buffer size\n");
+        if (ff_ip_check_source_lists(&b->addrs[i], &s->filters)) {
+            lens[i] = -1;
+        } else if (dst + ring_run(s, lens[i]) - head > free) {
+            lens[i] = -1;
+            if ((ret = circular_buffer_overrun(h)) < 0)
+                return ret;
+        }
+        /* Once the ring is full, no later datagram is stored either. */
+        if (lens[i] < 0 && dst - head == free)
+            continue;
+        pos[i] = dst;
+        dst   += ring_run(s, lens[i]);
+        stored = i + 1;
+    }
+
+    /* Backwards, so that no datagram is overwritten before it is moved. */
+    for (int i = stored - 1; i >= 0; i--) {
+        int len = lens[i];
+        int in_slot = FFMIN(len, s->ring_slot_size);
+
+        if (len >= 0) {
+            if (pos[i] != head + i)
+                memmove(ring_slot(s, pos[i]), ring_slot(s, head + i), in_slot);
+            if (len > in_slot)
+                memcpy(ring_slot(s, pos[i]) + in_slot, b->iov[2 * i + 1].iov_base, len - in_slot);
+        }
+        s->ring_len[pos[i] & (s->ring_slots - 1)] = len;
+    }
+    return dst;
+}
+#endif
+
 static void *circular_buffer_task_rx( void *_URLContext)
 {
     URLContext *h = _URLContext;
     UDPContext *s = h->priv_data;
-    int old_cancelstate;
+    int old_cancelstate, ret = 0;
 
     pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_cancelstate);
-    pthread_mutex_lock(&s->mutex);
     if (ff_socket_nonblock(s->udp_fd, 0) < 0) {
         av_log(h, AV_LOG_ERROR, "Failed to set blocking mode");
-        s->circular_buffer_error = AVERROR(EIO);
+        ret = AVERROR(EIO);
         goto end;
     }
     while(1) {
-        int len;
+        unsigned start = atomic_load_explicit(&s->ring_head, memory_order_relaxed);
+        unsigned head  = start;
+        unsigned free  = ring_reserve(s, &head, s->ring_max_run);
+        unsigned dst   = head;
         struct sockaddr_storage addr;
         socklen_t addr_len = sizeof(addr);
+        int len;
 
-        pthread_mutex_unlock(&s->mutex);
-        /* Blocking operations are always cancellation points;
-           see "General Information" / "Thread Cancelation Overview"
-           in Single Unix. */
-        pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &old_cancelstate);
-        len = recvfrom(s->udp_fd, s->tmp+4, sizeof(s->tmp)-4, 0, (struct sockaddr *)&addr, &addr_len);
-        pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_cancelstate);
-        pthread_mutex_lock(&s->mutex);
-        if (len < 0) {
-            if (ff_neterrno() != AVERROR(EAGAIN) && ff_neterrno() != AVERROR(EINTR)) {
-                s->circular_buffer_error = ff_neterrno();
-                goto end;
+        if (free < s->ring_max_run) {
+            /* Receive into the scratch buffer: the reader may free slots
+             * meanwhile, otherwise the datagram is counted as overrun. */
+            pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &old_cancelstate);
+            len = recvfrom(s->udp_fd, s->tmp, UDP_MAX_PKT_SIZE, 0, (struct sockaddr *)&addr, &addr_len);
+            pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_cancelstate);
+            if (len < 0) {
+                len = ff_neterrno();
+                goto recv_error;
             }
-            continue;
-        }
-        if (ff_ip_check_source_lists(&addr, &s->filters))
-            continue;
-        AV_WL32(s->tmp, len);
-
-        if (av_fifo_can_write(s->fifo) < len + 4) {
-            /* No Space left */
-            if (s->overrun_nonfatal) {
-                av_log(h, AV_LOG_WARNING, "Circular buffer overrun. "
-                        "Surviving due to overrun_nonfatal option\n");
+            if (ff_ip_check_source_lists(&addr, &s->filters))
                 continue;
-            } else {
-                av_log(h, AV_LOG_ERROR, "Circular buffer overrun. "
-                        "To avoid, increase fifo_size URL option. "
-                        "To survive in such case, use overrun_nonfatal option\n");
-                s->circular_buffer_error = AVERROR(EIO);
+            head = start;
+            if (ring_reserve(s, &head, ring_run(s, len)) < ring_run(s, len)) {
+                if ((ret = circular_buffer_overrun(h)) < 0)
+                    goto end;
+                continue;
+            }
+            memcpy(ring_slot(s, head), s->tmp, len);
+            s->ring_len[head & (s->ring_slots - 1)] = len;
+            dst = head + ring_run(s, len);
+#if HAVE_RECVMMSG
+        } else if (s->rx_batch.msgs) {
+            UDPBatch *b = &s->rx_batch;
+            int nb = FFMIN(b->nb_slots, free);
+            int64_t next;
+
+            /* Receive straight into the free slots, spilling what does not
+             * fit; block for the first datagram only, then take whatever
+             * else is already queued. */
+            for (int i = 0; i < nb; i++) {
+                b->iov[2 * i].iov_base = ring_slot(s, head + i);
+                b->iov[2 * i].iov_len  = s->ring_slot_size;
+                if (b->buf) {
+                    b->iov[2 * i + 1].iov_base = b->buf + (size_t)i * b->slot_size;
+                    b->iov[2 * i + 1].iov_len  = b->slot_size;
+                    b->msgs[i].msg_hdr.msg_iovlen = 2;
+                }
+            }
+            pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &old_cancelstate);
+            nb = udp_recv_batch(s, nb, MSG_WAITFORONE);
+            pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_cancelstate);
+            if (nb < 0) {
+                len = nb;
+                goto recv_error;
+            }
+            next = circular_buffer_store_batch(h, head, free, nb);
+            if (next < 0) {
+                ret = next;
                 goto end;
             }
+            dst = next;
+#endif
+        } else {
+            /* Blocking operations are always cancellation points;
+               see "General Information" / "Thread Cancelation Overview"
+               in Single Unix. */
+            pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &old_cancelstate);
+            len = recvfrom(s->udp_fd, ring_slot(s, head), UDP_MAX_PKT_SIZE, 0, (struct sockaddr *)&addr, &addr_len);
+            pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_cancelstate);
+            if (len < 0) {
+                len = ff_neterrno();
+                goto recv_error;
+            }
+            if (!ff_ip_check_source_lists(&addr, &s->filters)) {
+                s->ring_len[head & (s->ring_slots - 1)] = len;
+                dst = head + ring_run(s, len);
+            }
         }
-        av_fifo_write(s->fifo, s->tmp, len + 4);
-        pthread_cond_signal(&s->cond);
+        if (dst != head) {
+            atomic_store(&s->ring_head, dst);
+            circular_buffer_wake_reader(s, 0);
+        }
+        continue;
+
+recv_error:
+        ret = len;
+        if (ret != AVERROR(EAGAIN) && ret != AVERROR(EINTR))
+            goto end;
+        ret = 0;
     }
 
 end:
-    pthread_cond_signal(&s->cond);
-    pthread_mutex_unlock(&s->mutex);
+    atomic_store(&s->circular_buffer_error, ret);
+    circular_buffer_wake_reader(s, 1);
     return NULL;
 }
 
@@ -556,7 +870,7 @@ static void *circular_buffer_task_tx( void *_URLContext)
 
     if (ff_socket_nonblock(s->udp_fd, 0) < 0) {
         av_log(h, AV_LOG_ERROR, "Failed to set blocking mode");
-        s->circular_buffer_error = AVERROR(EIO);
+        atomic_store(&s->circular_buffer_error, AVERROR(EIO));
         goto end;
     }
 
@@ -622,7 +936,7 @@ static void *circular_buffer_task_tx( void *_URLContext)
                 ret = ff_neterrno();
                 if (ret != AVERROR(EAGAIN) && ret != AVERROR(EINTR)) {
                     pthread_mutex_lock(&s->mutex);
-                    s->circular_buffer_error = ret;
+                    atomic_store(&s->circular_buffer_error, ret);
                     pthread_mutex_unlock(&s->mutex);
                     return NULL;
                 }
@@ -745,6 +1059,17 @@ static int udp_open(URLContext *h, const char *uri, int flags)
             if ((ret = ff_ip_parse_blocks(h, buf, &s->filters)) < 0)
                 goto fail;
         }
+        if (av_find_info_tag(buf, sizeof(buf), "batch_size", p)) {
+            s->batch_size = strtol(buf, NULL, 10);
+            if (s->batch_size < 1 || s->batch_size > UDP_MAX_BATCH_SIZE) {
+                av_log(h, AV_LOG_ERROR, "batch_size(%d) should be in range [1,%d]\n",
+                       s->batch_size, UDP_MAX_BATCH_SIZE);
+                ret = AVERROR(EINVAL);
+                goto fail;
+            }
+        }
+        if (av_find_info_tag(buf, sizeof(buf), "batch_delay", p))
+            s->batch_delay = FFMAX(strtol(buf, NULL, 10), 0);
         if (!is_output && av_find_info_tag(buf, sizeof(buf), "timeout", p))
             s->timeout = strtol(buf, NULL, 10);
         if (is_output && av_find_info_tag(buf, sizeof(buf), "broadcast", p))
@@ -915,6 +1240,42 @@ static int udp_open(URLContext *h, const char *uri, int flags)
 
     s->udp_fd = udp_fd;
 
+    if (s->batch_size > 1) {
+        if (!is_output) {
+#if HAVE_RECVMMSG
+            int slot_size = UDP_MAX_PKT_SIZE, nb_slots;
+#if HAVE_PTHREAD_CANCEL
+            /* the receive thread reads straight into the ring slots, only
+             * the part of longer datagrams goes to the spill buffers */
+            if (s->circular_buffer_size)
+                slot_size -= av_clip(s->pkt_size, UDP_RX_SLOT_SIZE, UDP_MAX_PKT_SIZE);
+#endif
+            nb_slots = s->batch_size;
+            if (slot_size && nb_slots > UDP_MAX_RX_BATCH_BUF / slot_size) {
+                nb_slots = FFMAX(UDP_MAX_RX_BATCH_BUF / slot_size, 1);
+                av_log(h, AV_LOG_VERBOSE, "Receiving up to %d datagrams per "
+                       "system call instead of %d\n", nb_slots, s->batch_size);
+            }
+            if ((ret = udp_batch_alloc(&s->rx_batch, nb_slots, slot_size)) < 0)
+                goto fail;
+#else
+            av_log(h, AV_LOG_WARNING,
+                   "'batch_size' option was set but it is not supported "
+                   "on this build (recvmmsg support is required)\n");
+#endif
+        } else if (!s->bitrate || !s->circular_buffer_size) {
+#if HAVE_SENDMMSG
+            if (s->pkt_size > 0 &&
+                (ret = udp_batch_alloc(&s->tx_batch, s->batch_size, s->pkt_size)) < 0)
+                goto fail;
+#else
+            av_log(h, AV_LOG_WARNING,
+                   "'batch_size' option was set but it is not supported "
+                   "on this build (sendmmsg support is required)\n");
+#endif
+        }
+    }
+
 #if HAVE_PTHREAD_CANCEL
     /*
       Create thread in case of:
@@ -929,11 +1290,32 @@ static int udp_open(URLContext *h, const char *uri, int flags)
 
     if ((!is_output && s->circular_buffer_size) || (is_output && s->bitrate && s->circular_buffer_size)) {
         /* start the task going */
-        s->fifo = av_fifo_alloc2(s->circular_buffer_size, 1, 0);
-        if (!s->fifo) {
-            ret = AVERROR(ENOMEM);
-            goto fail;
+        if (is_output) {
+            s->fifo = av_fifo_alloc2(s->circular_buffer_size, 1, 0);
+            if (!s->fifo) {
+                ret = AVERROR(ENOMEM);
+                goto fail;
+            }
+        } else {
+            /* Datagrams larger than a slot take several consecutive
+             * slots; pkt_size grows the slots beyond what a 1500 byte MTU
+             * can carry. */
+            s->ring_slot_size = av_clip(s->pkt_size, UDP_RX_SLOT_SIZE, UDP_MAX_PKT_SIZE);
+            s->ring_max_run   = ring_run(s, UDP_MAX_PKT_SIZE);
+            s->ring_slots     = 1U << av_ceil_log2(FFMAX(s->circular_buffer_size / s->ring_slot_size,
+                                                         2 * s->ring_max_run));
+            s->ring_buf       = av_malloc_array(s->ring_slots, s->ring_slot_size);
+            s->ring_len       = av_calloc(s->ring_slots, sizeof(*s->ring_len));
+            if (!s->ring_buf || !s->ring_len) {
+                ret = AVERROR(ENOMEM);
+                goto fail;
+            }
+            atomic_init(&s->ring_head, 0);
+            atomic_init(&s->ring_tail, 0);
+            atomic_init(&s->reader_waiting, 0);
+            atomic_init(&s->nb_overruns, 0);
         }
+        atomic_init(&s->circular_buffer_error, 0);
         ret = pthread_mutex_init(&s->mutex, NULL);
         if (ret != 0) {
             av_log(h, AV_LOG_ERROR, "pthread_mutex_init failed : %s\n", strerror(ret));
@@ -967,6 +1349,14 @@ static int udp_open(URLContext *h, const char *uri, int flags)
     if (udp_fd >= 0)
         closesocket(udp_fd);
     av_fifo_freep2(&s->fifo);
+    av_freep(&s->ring_buf);
+    av_freep(&s->ring_len);
+#if HAVE_RECVMMSG
+    udp_batch_free(&s->rx_batch);
+#endif
+#if HAVE_SENDMMSG
+    udp_batch_free(&s->tx_batch);
+#endif
     ff_ip_reset_filters(&s->filters);
     return ret;
 }
@@ -988,32 +1378,46 @@ static int udp_read(URLContext *h, uint8_t *buf, int size)
     struct sockaddr_storage addr;
     socklen_t addr_len = sizeof(addr);
 #if HAVE_PTHREAD_CANCEL
-    int avail, nonblock = h->flags & AVIO_FLAG_NONBLOCK;
+    int nonblock = h->flags & AVIO_FLAG_NONBLOCK;
+
+    if (s->ring_buf) {
+        unsigned mask = s->ring_slots - 1;
 
-    if (s->fifo) {
-        pthread_mutex_lock(&s->mutex);
         do {
-            avail = av_fifo_can_read(s->fifo);
-            if (avail) { // >=size) {
-                uint8_t tmp[4];
-
-                av_fifo_read(s->fifo, tmp, 4);
-                avail = AV_RL32(tmp);
-                if(avail > size){
-                    av_log(h, AV_LOG_WARNING, "Part of datagram lost due to insufficient buffer size\n");
-                    avail = size;
+            unsigned tail = atomic_load_explicit(&s->ring_tail, memory_order_relaxed);
+            unsigned head = atomic_load_explicit(&s->ring_head, memory_order_acquire);
+
+            if (head != tail) {
+                int len = 0, got = 0;
+
+                while (tail != head) {
+                    int dg = s->ring_len[tail & mask];
+                    int copy = dg;
+
+                    if (dg < 0) {
+                        /* unused slots at the end of the ring */
+                        tail -= dg;
+                        continue;
+                    }
+                    if (len + dg > size) {
+                        if (len)
+                            break;
+                        av_log(h, AV_LOG_WARNING, "Part of datagram lost due to insufficient buffer size\n");
+                        copy = size;
+                    }
+                    memcpy(buf + len, ring_slot(s, tail), copy);
+                    len += copy;
+                    tail += ring_run(s, dg);
+                    got   = 1;
+                    if (!s->merge_datagrams)
+                        break;
                 }
-
-                av_fifo_read(s->fifo, buf, avail);
-                av_fifo_drain2(s->fifo, AV_RL32(tmp) - avail);
-                pthread_mutex_unlock(&s->mutex);
-                return avail;
-            } else if(s->circular_buffer_error){
-                int err = s->circular_buffer_error;
-                pthread_mutex_unlock(&s->mutex);
-                return err;
-            } else if(nonblock) {
-                pthread_mutex_unlock(&s->mutex);
+                atomic_store_explicit(&s->ring_tail, tail, memory_order_release);
+                if (got)
+                    return len;
+            } else if ((ret = atomic_load(&s->circular_buffer_error)) < 0) {
+                return ret;
+            } else if (nonblock) {
                 return AVERROR(EAGAIN);
             } else {
                 /* FIXME: using the monotonic clock would be better,
@@ -1021,17 +1425,56 @@ static int udp_read(URLContext *h, uint8_t *buf, int size)
                 int64_t t = av_gettime() + 100000;
                 struct timespec tv = { .tv_sec  =  t / 1000000,
                                        .tv_nsec = (t % 1000000) * 1000 };
-                int err = pthread_cond_timedwait(&s->cond, &s->mutex, &tv);
-                if (err) {
-                    pthread_mutex_unlock(&s->mutex);
+                int err = 0;
+
+                /* The receive thread only signals when it sees reader_waiting
+                 * set, so recheck the ring after setting it. */
+                pthread_mutex_lock(&s->mutex);
+                atomic_store(&s->reader_waiting, 1);
+                if (atomic_load(&s->ring_head) == tail &&
+                    !atomic_load(&s->circular_buffer_error))
+                    err = pthread_cond_timedwait(&s->cond, &s->mutex, &tv);
+                atomic_store(&s->reader_waiting, 0);
+                pthread_mutex_unlock(&s->mutex);
+                if (err)
                     return AVERROR(err == ETIMEDOUT ? EAGAIN : err);
-                }
                 nonblock = 1;
             }
         } while(1);
     }
 #endif
 
+#if HAVE_RECVMMSG
+    if (s->rx_batch.msgs) {
+        UDPBatch *b = &s->rx_batch;
+
+        if (b->pos >= b->nb) {
+            if (!(h->flags & AVIO_FLAG_NONBLOCK)) {
+                ret = ff_network_wait_fd(s->udp_fd, 0);
+                if (ret < 0)
+                    return ret;
+            }
+            ret = udp_recv_batch(s, b->nb_slots, 0);
+            if (ret < 0)
+                return ret;
+        }
+        while (b->pos < b->nb) {
+            int i = b->pos++;
+            int len = b->msgs[i].msg_len;
+
+            if (ff_ip_check_source_lists(&b->addrs[i], &s->filters))
+                continue;
+            if (len > size) {
+                av_log(h, AV_LOG_WARNING, "Part of datagram lost due to insufficient buffer size\n");
+                len = size;
+            }
+            memcpy(buf, b->buf + (size_t)i * b->slot_size, len);
+            return len;
+        }
+        return AVERROR(EINTR);
+    }
+#endif
+
     if (!(h->flags & AVIO_FLAG_NONBLOCK)) {
         ret = ff_network_wait_fd(s->udp_fd, 0);
         if (ret < 0)
@@ -1053,6 +1496,7 @@ static int udp_write(URLContext *h, const uint8_t *buf, int size)
 #if HAVE_PTHREAD_CANCEL
     if (s->fifo) {
         uint8_t tmp[4];
+        int err;
 
         pthread_mutex_lock(&s->mutex);
 
@@ -1060,8 +1504,8 @@ static int udp_write(URLContext *h, const uint8_t *buf, int size)
           Return error if last tx failed.
           Here we can't know on which packet error was, but it needs to know that error exists.
         */
-        if (s->circular_buffer_error<0) {
-            int err = s->circular_buffer_error;
+        err = atomic_load(&s->circular_buffer_error);
+        if (err < 0) {
             pthread_mutex_unlock(&s->mutex);
             return err;
         }
@@ -1078,6 +1522,36 @@ static int udp_write(URLContext *h, const uint8_t *buf, int size)
         pthread_mutex_unlock(&s->mutex);
         return size;
     }
+#endif
+#if HAVE_SENDMMSG
+    if (s->tx_batch.msgs && size <= s->tx_batch.slot_size) {
+        UDPBatch *b = &s->tx_batch;
+
+        if (b->nb == s->batch_size) {
+            ret = udp_flush_batch(h, h->flags & AVIO_FLAG_NONBLOCK);
+            if (ret < 0)
+                return ret;
+        }
+        if (!b->nb)
+            b->deadline = av_gettime_relative() + s->batch_delay;
+        memcpy(b->iov[2 * b->nb].iov_base, buf, size);
+        b->iov[2 * b->nb].iov_len = size;
+        b->nb++;
+        /* The datagram is queued now, a send that would block is retried
+         * on the next write. */
+        if (b->nb == s->batch_size || av_gettime_relative() >= b->deadline) {
+            ret = udp_flush_batch(h, h->flags & AVIO_FLAG_NONBLOCK);
+            if (ret < 0 && ret != AVERROR(EAGAIN))
+                return ret;
+        }
+        return size;
+    }
+    if (s->tx_batch.nb) {
+        /* keep datagram order when a packet bypasses the batch */
+        ret = udp_flush_batch(h, h->flags & AVIO_FLAG_NONBLOCK);
+        if (ret < 0)
+            return ret;
+    }
 #endif
     if (!(h->flags & AVIO_FLAG_NONBLOCK)) {
         ret = ff_network_wait_fd(s->udp_fd, 1);
@@ -1109,6 +1583,14 @@ static int udp_close(URLContext *h)
     }
 #endif
 
+#if HAVE_SENDMMSG
+    if (s->tx_batch.nb) {
+        int ret = udp_flush_batch(h, 0);
+        if (ret < 0)
+            av_log(h, AV_LOG_ERROR, "Failed to send queued datagrams: %s\n", av_err2str(ret));
+    }
+#endif
+
     if (s->is_multicast && (h->flags & AVIO_FLAG_READ))
         udp_leave_multicast_group(s->udp_fd, (struct sockaddr *)&s->dest_addr,
                                   (struct sockaddr *)&s->local_addr_storage, h);
@@ -1136,6 +1618,17 @@ static int udp_close(URLContext *h)
 #endif
     closesocket(s->udp_fd);
     av_fifo_freep2(&s->fifo);
+    if (atomic_load(&s->nb_overruns))
+        av_log(h, AV_LOG_WARNING, "%u datagrams dropped due to circular buffer overrun\n",
+               (unsigned)atomic_load(&s->nb_overruns));
+    av_freep(&s->ring_buf);
+    av_freep(&s->ring_len);
+#if HAVE_RECVMMSG
+    udp_batch_free(&s->rx_batch);
+#endif
+#if HAVE_SENDMMSG
+    udp_batch_free(&s->tx_batch);
+#endif
     ff_ip_reset_filters(&s->filters);
     return 0;
 }
@@ -273,6 +273,8 @@ AVBufferPool *av_buffer_pool_init2(size_t size, void *opaque,
     pool->pool_free = pool_free;
 
     atomic_init(&pool->refcount, 1);
+    for (int i = 0; i < BUFFER_POOL_CACHE_SIZE; i++)
+        atomic_init(&pool->cache[i], 0);
 
     return pool;
 }
@@ -289,12 +291,51 @@ AVBufferPool *av_buffer_pool_init(size_t size, AVBufferRef* (*alloc)(size_t size
     pool->alloc    = alloc ? alloc : av_buffer_alloc;
 
     atomic_init(&pool->refcount, 1);
+    for (int i = 0; i < BUFFER_POOL_CACHE_SIZE; i++)
+        atomic_init(&pool->cache[i], 0);
 
     return pool;
 }
 
+static BufferPoolEntry *pool_cache_get(AVBufferPool *pool)
+{
+    for (int i = 0; i < BUFFER_POOL_CACHE_SIZE; i++) {
+        BufferPoolEntry *buf;
+
+        /* skip empty slots without taking ownership of the cache line */
+        if (!atomic_load_explicit(&pool->cache[i], memory_order_relaxed))
+            continue;
+        buf = (BufferPoolEntry *)atomic_exchange_explicit(&pool->cache[i], 0,
+                                                          memory_order_acquire);
+        if (buf)
+            return buf;
+    }
+    return NULL;
+}
+
+static int pool_cache_put(AVBufferPool *pool, BufferPoolEntry *buf)
+{
+    for (int i = 0; i < BUFFER_POOL_CACHE_SIZE; i++) {
+        uintptr_t empty = 0;
+
+        if (!atomic_load_explicit(&pool->cache[i], memory_order_relaxed) &&
+            atomic_compare_exchange_strong_explicit(&pool->cache[i], &empty,
+                                                    (uintptr_t)buf,
+                                                    memory_order_release,
+                                                    memory_order_relaxed))
+            return 1;
+    }
+    return 0;
+}
+
 static void buffer_pool_flush(AVBufferPool *pool)
 {
+    BufferPoolEntry *buf;
+
+    while ((buf = pool_cache_get(pool))) {
+        buf->free(buf->opaque, buf->data);
+        av_freep(&buf);
+    }
     while (pool->pool) {
         BufferPoolEntry *buf = pool->pool;
         pool->pool = buf->next;
@@ -336,15 +377,23 @@ void av_buffer_pool_uninit(AVBufferPool **ppool)
         buffer_pool_free(pool);
 }
 
-static void pool_release_buffer(void *opaque, uint8_t *data)
+static void pool_put_entry(AVBufferPool *pool, BufferPoolEntry *buf)
 {
-    BufferPoolEntry *buf = opaque;
-    AVBufferPool *pool = buf->pool;
+    if (pool_cache_put(pool, buf))
+        return;
 
     ff_mutex_lock(&pool->mutex);
     buf->next = pool->pool;
     pool->pool = buf;
     ff_mutex_unlock(&pool->mutex);
+}
+
+static void pool_release_buffer(void *opaque, uint8_t *data)
+{
+    BufferPoolEntry *buf = opaque;
+    AVBufferPool *pool = buf->pool;
+
+    pool_put_entry(pool, buf);
 
     if (atomic_fetch_sub_explicit(&pool->refcount, 1, memory_order_acq_rel) == 1)
         buffer_pool_free(pool);
@@ -383,24 +432,32 @@ static AVBufferRef *pool_alloc_buffer(AVBufferPool *pool)
 
 AVBufferRef *av_buffer_pool_get(AVBufferPool *pool)
 {
-    AVBufferRef *ret;
+    AVBufferRef *ret = NULL;
     BufferPoolEntry *buf;
 
-    ff_mutex_lock(&pool->mutex);
-    buf = pool->pool;
+    buf = pool_cache_get(pool);
+    if (!buf) {
+        ff_mutex_lock(&pool->mutex);
+        buf = pool->pool;
+        if (buf) {
+            pool->pool = buf->next;
+            buf->next = NULL;
+        } else {
+            /* the allocators may rely on being serialized by the mutex */
+            ret = pool_alloc_buffer(pool);
+        }
+        ff_mutex_unlock(&pool->mutex);
+    }
+
     if (buf) {
         memset(&buf->buffer, 0, sizeof(buf->buffer));
         ret = buffer_create(&buf->buffer, buf->data, pool->size,
                             pool_release_buffer, buf, 0);
-        if (ret) {
-            pool->pool = buf->next;
-            buf->next = NULL;
+        if (ret)
             buf->buffer.flags_internal |= BUFFER_FLAG_NO_FREE;
-        }
-    } else {
-        ret = pool_alloc_buffer(pool);
+        else
+            pool_put_entry(pool, buf);
     }
-    ff_mutex_unlock(&pool->mutex);
 
     if (ret)
         atomic_fetch_add_explicit(&pool->refcount, 1, memory_order_relaxed);
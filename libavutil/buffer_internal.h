@@ -85,10 +85,26 @@ typedef struct BufferPoolEntry {
     AVBuffer buffer;
 } BufferPoolEntry;
 
+/**
+ * Number of free buffers a pool keeps in its lock-free cache, in front of
+ * the mutex-protected list.
+ */
+#define BUFFER_POOL_CACHE_SIZE 8
+
 struct AVBufferPool {
     AVMutex mutex;
     BufferPoolEntry *pool;
 
+    /*
+     * Free buffers, as BufferPoolEntry pointers or 0 for empty slots.
+     * Buffers are taken from a slot with an atomic exchange and put back
+     * into an empty slot with a compare-and-swap, so that the common
+     * get/release cycle does not take the mutex. Each slot holds a single
+     * buffer and there are no links between them, so unlike a lock-free
+     * list this is not subject to the ABA problem.
+     */
+    atomic_uintptr_t cache[BUFFER_POOL_CACHE_SIZE];
+
     /*
      * This is used to track when the pool is to be freed.
      * The pointer to the pool itself held by the caller is considered to
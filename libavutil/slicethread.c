@@ -22,6 +22,7 @@
 #include "slicethread.h"
 #include "mem.h"
 #include "thread.h"
+#include "threadpool_internal.h"
 #include "avassert.h"
 
 #define MAX_AUTO_THREADS 16
@@ -52,6 +53,11 @@ struct AVSliceThread {
     void            *priv;
     void            (*worker_func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads);
     void            (*main_func)(void *priv);
+
+    /* shared mode: the jobs run on the shared pool instead of the workers */
+    FFThreadPool     *pool;
+    FFThreadPoolTask *tasks;
+    int              nb_running; ///< tasks started and not done, protected by done_mutex
 };
 
 static int run_jobs(AVSliceThread *ctx)
@@ -95,6 +101,99 @@ static void *attribute_align_arg thread_worker(void *v)
     }
 }
 
+/**
+ * Pool tasks may start late or not at all, so every participant takes its
+ * jobs from the common counter instead of having one reserved for it.
+ */
+static void run_shared_jobs(AVSliceThread *ctx)
+{
+    unsigned nb_jobs  = ctx->nb_jobs;
+    unsigned threadnr = atomic_fetch_add_explicit(&ctx->first_job, 1, memory_order_acq_rel);
+    unsigned jobnr;
+
+    while ((jobnr = atomic_fetch_add_explicit(&ctx->current_job, 1, memory_order_acq_rel)) < nb_jobs)
+        ctx->worker_func(ctx->priv, jobnr, threadnr, nb_jobs, ctx->nb_active_threads);
+}
+
+static void shared_task(void *arg)
+{
+    AVSliceThread *ctx = arg;
+
+    run_shared_jobs(ctx);
+
+    pthread_mutex_lock(&ctx->done_mutex);
+    if (!--ctx->nb_running)
+        pthread_cond_signal(&ctx->done_cond);
+    pthread_mutex_unlock(&ctx->done_mutex);
+}
+
+static void execute_shared(AVSliceThread *ctx)
+{
+    int nb_tasks = ctx->nb_active_threads - 1;
+    int nb_cancelled = 0;
+
+    atomic_store_explicit(&ctx->current_job, 0, memory_order_relaxed);
+    ctx->nb_running = nb_tasks;
+    for (int i = 0; i < nb_tasks; i++)
+        ff_thread_pool_submit(ctx->pool, &ctx->tasks[i]);
+
+    run_shared_jobs(ctx);
+
+    /* all the jobs are taken, the tasks which did not start are useless */
+    for (int i = 0; i < nb_tasks; i++)
+        nb_cancelled += ff_thread_pool_cancel(ctx->pool, &ctx->tasks[i]);
+
+    pthread_mutex_lock(&ctx->done_mutex);
+    ctx->nb_running -= nb_cancelled;
+    while (ctx->nb_running)
+        pthread_cond_wait(&ctx->done_cond, &ctx->done_mutex);
+    pthread_mutex_unlock(&ctx->done_mutex);
+}
+
+int avpriv_slicethread_create_shared(AVSliceThread **pctx, void *priv,
+                                     void (*worker_func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads),
+                                     int nb_threads)
+{
+    AVSliceThread *ctx;
+    int nb_pool_threads;
+
+    av_assert0(nb_threads >= 0);
+
+    *pctx = ctx = av_mallocz(sizeof(*ctx));
+    if (!ctx)
+        return AVERROR(ENOMEM);
+
+    nb_pool_threads = ff_thread_pool_ref(&ctx->pool);
+    if (nb_pool_threads < 0) {
+        av_freep(pctx);
+        return nb_pool_threads;
+    }
+    /* the calling thread runs jobs too */
+    if (!nb_threads)
+        nb_threads = FFMIN(nb_pool_threads + 1, MAX_AUTO_THREADS);
+
+    if (!(ctx->tasks = av_calloc(nb_threads, sizeof(*ctx->tasks)))) {
+        ff_thread_pool_unref(&ctx->pool);
+        av_freep(pctx);
+        return AVERROR(ENOMEM);
+    }
+    for (int i = 0; i < nb_threads; i++) {
+        ctx->tasks[i].func = shared_task;
+        ctx->tasks[i].arg  = ctx;
+    }
+
+    ctx->priv        = priv;
+    ctx->worker_func = worker_func;
+    ctx->nb_threads  = nb_threads;
+
+    atomic_init(&ctx->first_job, 0);
+    atomic_init(&ctx->current_job, 0);
+    pthread_mutex_init(&ctx->done_mutex, NULL);
+    pthread_cond_init(&ctx->done_cond, NULL);
+
+    return nb_threads;
+}
+
 int avpriv_slicethread_create(AVSliceThread **pctx, void *priv,
                               void (*worker_func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads),
                               void (*main_func)(void *priv),
@@ -173,6 +272,10 @@ void avpriv_slicethread_execute(AVSliceThread *ctx, int nb_jobs, int execute_mai
     ctx->nb_jobs           = nb_jobs;
     ctx->nb_active_threads = FFMIN(nb_jobs, ctx->nb_threads);
     atomic_store_explicit(&ctx->first_job, 0, memory_order_relaxed);
+    if (ctx->pool) {
+        execute_shared(ctx);
+        return;
+    }
     atomic_store_explicit(&ctx->current_job, ctx->nb_active_threads, memory_order_relaxed);
     nb_workers             = ctx->nb_active_threads;
     if (!ctx->main_func || !execute_main)
@@ -209,6 +312,15 @@ void avpriv_slicethread_free(AVSliceThread **pctx)
         return;
 
     ctx = *pctx;
+    if (ctx->pool) {
+        ff_thread_pool_unref(&ctx->pool);
+        pthread_cond_destroy(&ctx->done_cond);
+        pthread_mutex_destroy(&ctx->done_mutex);
+        av_freep(&ctx->tasks);
+        av_freep(pctx);
+        return;
+    }
+
     nb_workers = ctx->nb_threads;
     if (!ctx->main_func)
         nb_workers--;
@@ -246,6 +358,14 @@ int avpriv_slicethread_create(AVSliceThread **pctx, void *priv,
     return AVERROR(ENOSYS);
 }
 
+int avpriv_slicethread_create_shared(AVSliceThread **pctx, void *priv,
+                                     void (*worker_func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads),
+                                     int nb_threads)
+{
+    *pctx = NULL;
+    return AVERROR(ENOSYS);
+}
+
 void avpriv_slicethread_execute(AVSliceThread *ctx, int nb_jobs, int execute_main)
 {
     av_assert0(0);
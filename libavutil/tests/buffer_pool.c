@@ -0,0 +1,160 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Multi-threaded test and micro-benchmark of AVBufferPool. Every thread
+ * gets and releases buffers from one pool, and hands half of them over to
+ * the next thread to be released there, like frame threads and filters do.
+ * Each buffer is stamped with its holder to check that the pool never hands
+ * out a buffer twice. With -b, the time per get/release pair is printed.
+ */
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libavutil/buffer.h"
+#include "libavutil/thread.h"
+#include "libavutil/time.h"
+
+#define MAX_THREADS 64
+#define FREE_MARK   0
+
+typedef struct ThreadData {
+    AVBufferPool *pool;
+    int id;
+    int nb_iter;
+    atomic_uintptr_t mailbox;
+    struct ThreadData *next;
+    int errors;
+} ThreadData;
+
+static int take(ThreadData *t, AVBufferRef *buf)
+{
+    int *mark = (int *)buf->data;
+
+    if (*mark != FREE_MARK)
+        return 1;
+    *mark = t->id;
+    return 0;
+}
+
+static int drop(int id, AVBufferRef **buf)
+{
+    int *mark = (int *)(*buf)->data;
+    int err = *mark != id;
+
+    *mark = FREE_MARK;
+    av_buffer_unref(buf);
+    return err;
+}
+
+static void *thread_main(void *arg)
+{
+    ThreadData *t = arg;
+
+    for (int i = 0; i < t->nb_iter; i++) {
+        AVBufferRef *buf = av_buffer_pool_get(t->pool);
+        AVBufferRef *other;
+
+        if (!buf) {
+            t->errors++;
+            break;
+        }
+        t->errors += take(t, buf);
+
+        if (i & 1) {
+            t->errors += drop(t->id, &buf);
+            continue;
+        }
+
+        /* the mark goes with the buffer to the thread releasing it */
+        *(int *)buf->data = t->next->id;
+        other = (AVBufferRef *)atomic_exchange(&t->next->mailbox, (uintptr_t)buf);
+        if (other)
+            t->errors += drop(t->next->id, &other);
+        other = (AVBufferRef *)atomic_exchange(&t->mailbox, 0);
+        if (other)
+            t->errors += drop(t->id, &other);
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    static ThreadData td[MAX_THREADS];
+    pthread_t threads[MAX_THREADS];
+    AVBufferPool *pool;
+    int nb_threads = 4, nb_iter = 100000, bench = 0, errors = 0;
+    int64_t t0, t1;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-b"))
+            bench = 1;
+        else if (!strcmp(argv[i], "-t") && i + 1 < argc)
+            nb_threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-n") && i + 1 < argc)
+            nb_iter = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "Usage: %s [-b] [-t threads] [-n iterations]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (nb_threads < 1 || nb_threads > MAX_THREADS || nb_iter < 1)
+        return 1;
+
+    pool = av_buffer_pool_init(4096, av_buffer_allocz);
+    if (!pool)
+        return 1;
+
+    for (int i = 0; i < nb_threads; i++) {
+        td[i].pool    = pool;
+        td[i].id      = i + 1;
+        td[i].nb_iter = nb_iter;
+        td[i].next    = &td[(i + 1) % nb_threads];
+        atomic_init(&td[i].mailbox, 0);
+    }
+
+    t0 = av_gettime_relative();
+    for (int i = 0; i < nb_threads; i++) {
+        if (pthread_create(&threads[i], NULL, thread_main, &td[i])) {
+            fprintf(stderr, "pthread_create failed\n");
+            return 1;
+        }
+    }
+    for (int i = 0; i < nb_threads; i++)
+        pthread_join(threads[i], NULL);
+    t1 = av_gettime_relative();
+
+    for (int i = 0; i < nb_threads; i++) {
+        AVBufferRef *buf = (AVBufferRef *)atomic_load(&td[i].mailbox);
+
+        if (buf)
+            errors += drop(td[i].id, &buf);
+        errors += td[i].errors;
+    }
+    av_buffer_pool_uninit(&pool);
+
+    if (bench)
+        printf("%d threads: %.1f ns per get/release in each thread\n", nb_threads,
+               (t1 - t0) * 1000.0 / nb_iter);
+    if (errors)
+        fprintf(stderr, "%d errors\n", errors);
+    return !!errors;
+}
@@ -0,0 +1,325 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "avassert.h"
+#include "cpu.h"
+#include "error.h"
+#include "internal.h"
+#include "mem.h"
+#include "thread.h"
+#include "threadpool_internal.h"
+
+static int pool_nb_threads;
+
+#if HAVE_PTHREADS || HAVE_W32THREADS || HAVE_OS2THREADS
+
+static AVMutex pool_lock = AV_MUTEX_INITIALIZER;
+
+/**
+ * Doubly linked list of tasks. Its owning worker pushes and pops at the
+ * tail, the other workers steal at the head.
+ */
+struct FFThreadPoolQueue {
+    pthread_mutex_t  lock;
+    FFThreadPoolTask *head, *tail;
+};
+
+typedef struct PoolWorker {
+    FFThreadPool      *pool;
+    pthread_t         thread;
+    FFThreadPoolQueue queue;
+} PoolWorker;
+
+struct FFThreadPool {
+    PoolWorker        *workers;
+    int               nb_workers;
+    /* tasks submitted from outside of the pool */
+    FFThreadPoolQueue injector;
+
+    pthread_mutex_t   lock;
+    pthread_cond_t    cond;
+    int               pending; ///< number of queued tasks, protected by lock
+    int               quit;
+    int               refcount;
+};
+
+static FFThreadPool *shared_pool;
+
+static void queue_push(FFThreadPoolQueue *q, FFThreadPoolTask *task)
+{
+    pthread_mutex_lock(&q->lock);
+    task->queue = q;
+    task->state = FF_THREAD_POOL_TASK_QUEUED;
+    task->next  = NULL;
+    task->prev  = q->tail;
+    if (q->tail)
+        q->tail->next = task;
+    else
+        q->head = task;
+    q->tail = task;
+    pthread_mutex_unlock(&q->lock);
+}
+
+/* must be called with q->lock held */
+static void queue_unlink(FFThreadPoolQueue *q, FFThreadPoolTask *task)
+{
+    if (task->prev)
+        task->prev->next = task->next;
+    else
+        q->head = task->next;
+    if (task->next)
+        task->next->prev = task->prev;
+    else
+        q->tail = task->prev;
+    task->prev = task->next = NULL;
+}
+
+static FFThreadPoolTask *queue_pop(FFThreadPoolQueue *q, int tail)
+{
+    FFThreadPoolTask *task;
+
+    pthread_mutex_lock(&q->lock);
+    task = tail ? q->tail : q->head;
+    if (task) {
+        queue_unlink(q, task);
+        task->state = FF_THREAD_POOL_TASK_RUNNING;
+    }
+    pthread_mutex_unlock(&q->lock);
+    return task;
+}
+
+static PoolWorker *current_worker(FFThreadPool *pool)
+{
+    pthread_t self = pthread_self();
+
+    for (int i = 0; i < pool->nb_workers; i++)
+        if (pthread_equal(pool->workers[i].thread, self))
+            return &pool->workers[i];
+    return NULL;
+}
+
+static FFThreadPoolTask *get_task(FFThreadPool *pool, PoolWorker *w)
+{
+    FFThreadPoolTask *task = queue_pop(&w->queue, 1);
+    int self = w - pool->workers;
+
+    if (!task)
+        task = queue_pop(&pool->injector, 0);
+    for (int i = 1; !task && i < pool->nb_workers; i++)
+        task = queue_pop(&pool->workers[(self + i) % pool->nb_workers].queue, 0);
+
+    if (task) {
+        pthread_mutex_lock(&pool->lock);
+        pool->pending--;
+        pthread_mutex_unlock(&pool->lock);
+    }
+    return task;
+}
+
+static void *attribute_align_arg pool_worker(void *arg)
+{
+    PoolWorker *w = arg;
+    FFThreadPool *pool = w->pool;
+
+    while (1) {
+        FFThreadPoolTask *task = get_task(pool, w);
+        int quit;
+
+        if (task) {
+            /* the task belongs to its submitter again once func returns */
+            task->func(task->arg);
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        while (!pool->pending && !pool->quit)
+            pthread_cond_wait(&pool->cond, &pool->lock);
+        quit = pool->quit;
+        pthread_mutex_unlock(&pool->lock);
+        if (quit)
+            return NULL;
+    }
+}
+
+static void pool_free(FFThreadPool *pool, int nb_started)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->quit = 1;
+    pthread_cond_broadcast(&pool->cond);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < nb_started; i++)
+        pthread_join(pool->workers[i].thread, NULL);
+    for (int i = 0; i < pool->nb_workers; i++)
+        pthread_mutex_destroy(&pool->workers[i].queue.lock);
+    pthread_mutex_destroy(&pool->injector.lock);
+    pthread_cond_destroy(&pool->cond);
+    pthread_mutex_destroy(&pool->lock);
+    av_freep(&pool->workers);
+    av_free(pool);
+}
+
+static int pool_alloc(FFThreadPool **ppool, int nb_threads)
+{
+    FFThreadPool *pool;
+    int ret;
+
+    pool = av_mallocz(sizeof(*pool));
+    if (!pool)
+        return AVERROR(ENOMEM);
+    pool->workers = av_calloc(nb_threads, sizeof(*pool->workers));
+    if (!pool->workers) {
+        av_free(pool);
+        return AVERROR(ENOMEM);
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->cond, NULL);
+    pthread_mutex_init(&pool->injector.lock, NULL);
+
+    /* the workers steal from each other as soon as they start */
+    pool->nb_workers = nb_threads;
+    for (int i = 0; i < nb_threads; i++) {
+        pool->workers[i].pool = pool;
+        pthread_mutex_init(&pool->workers[i].queue.lock, NULL);
+    }
+    for (int i = 0; i < nb_threads; i++) {
+        if (ret = pthread_create(&pool->workers[i].thread, NULL,
+                                 pool_worker, &pool->workers[i])) {
+            pool_free(pool, i);
+            return AVERROR(ret);
+        }
+    }
+
+    *ppool = pool;
+    return 0;
+}
+
+int ff_thread_pool_ref(FFThreadPool **ppool)
+{
+    int ret = 0;
+
+    ff_mutex_lock(&pool_lock);
+    if (!shared_pool) {
+        int nb_threads = pool_nb_threads ? pool_nb_threads : av_cpu_count();
+        ret = pool_alloc(&shared_pool, nb_threads);
+    }
+    if (ret >= 0) {
+        shared_pool->refcount++;
+        *ppool = shared_pool;
+        ret    = shared_pool->nb_workers;
+    }
+    ff_mutex_unlock(&pool_lock);
+    return ret;
+}
+
+void ff_thread_pool_unref(FFThreadPool **ppool)
+{
+    if (!*ppool)
+        return;
+
+    ff_mutex_lock(&pool_lock);
+    if (!--shared_pool->refcount) {
+        pool_free(shared_pool, shared_pool->nb_workers);
+        shared_pool = NULL;
+    }
+    ff_mutex_unlock(&pool_lock);
+    *ppool = NULL;
+}
+
+void ff_thread_pool_submit(FFThreadPool *pool, FFThreadPoolTask *task)
+{
+    PoolWorker *w = current_worker(pool);
+
+    queue_push(w ? &w->queue : &pool->injector, task);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->pending++;
+    pthread_cond_signal(&pool->cond);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+int ff_thread_pool_cancel(FFThreadPool *pool, FFThreadPoolTask *task)
+{
+    FFThreadPoolQueue *q = task->queue;
+    int cancelled = 0;
+
+    pthread_mutex_lock(&q->lock);
+    if (task->state == FF_THREAD_POOL_TASK_QUEUED) {
+        queue_unlink(q, task);
+        task->state = FF_THREAD_POOL_TASK_IDLE;
+        cancelled   = 1;
+    }
+    pthread_mutex_unlock(&q->lock);
+
+    if (cancelled) {
+        pthread_mutex_lock(&pool->lock);
+        pool->pending--;
+        pthread_mutex_unlock(&pool->lock);
+    }
+    return cancelled;
+}
+
+int av_thread_pool_set_threads(int nb_threads)
+{
+    int ret = 0;
+
+    if (nb_threads < 0)
+        return AVERROR(EINVAL);
+
+    ff_mutex_lock(&pool_lock);
+    if (shared_pool)
+        ret = AVERROR(EBUSY);
+    else
+        pool_nb_threads = nb_threads;
+    ff_mutex_unlock(&pool_lock);
+    return ret;
+}
+
+#else /* HAVE_PTHREADS || HAVE_W32THREADS || HAVE_OS2THREADS */
+
+int ff_thread_pool_ref(FFThreadPool **ppool)
+{
+    *ppool = NULL;
+    return AVERROR(ENOSYS);
+}
+
+void ff_thread_pool_unref(FFThreadPool **ppool)
+{
+    av_assert0(!*ppool);
+}
+
+void ff_thread_pool_submit(FFThreadPool *pool, FFThreadPoolTask *task)
+{
+    av_assert0(0);
+}
+
+int ff_thread_pool_cancel(FFThreadPool *pool, FFThreadPoolTask *task)
+{
+    av_assert0(0);
+    return 0;
+}
+
+int av_thread_pool_set_threads(int nb_threads)
+{
+    if (nb_threads < 0)
+        return AVERROR(EINVAL);
+    pool_nb_threads = nb_threads;
+    return 0;
+}
+
+#endif /* HAVE_PTHREADS || HAVE_W32THREADS || HAVE_OS2THREADS */
@@ -0,0 +1,47 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVUTIL_THREADPOOL_H
+#define AVUTIL_THREADPOOL_H
+
+/**
+ * @file
+ * Process-wide shared thread pool.
+ *
+ * The codec, filtergraph and scaling contexts with their shared_threads
+ * option set run their slice threading jobs on a single pool of worker
+ * threads instead of creating threads of their own. This bounds the total
+ * number of threads of a process using many such contexts at once.
+ *
+ * The pool is created when the first context attaches to it and destroyed
+ * when the last one is freed.
+ */
+
+/**
+ * Set the number of worker threads of the shared thread pool.
+ *
+ * This only takes effect when the pool is created, i.e. it must be called
+ * while no context uses the pool.
+ *
+ * @param nb_threads number of threads, 0 for one per CPU
+ * @return 0 on success, AVERROR(EBUSY) if the pool is in use,
+ *         AVERROR(EINVAL) if nb_threads is negative
+ */
+int av_thread_pool_set_threads(int nb_threads);
+
+#endif /* AVUTIL_THREADPOOL_H */
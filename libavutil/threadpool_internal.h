@@ -0,0 +1,74 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVUTIL_THREADPOOL_INTERNAL_H
+#define AVUTIL_THREADPOOL_INTERNAL_H
+
+#include "threadpool.h"
+
+typedef struct FFThreadPool FFThreadPool;
+typedef struct FFThreadPoolQueue FFThreadPoolQueue;
+
+enum FFThreadPoolTaskState {
+    FF_THREAD_POOL_TASK_IDLE,
+    FF_THREAD_POOL_TASK_QUEUED,
+    FF_THREAD_POOL_TASK_RUNNING,
+};
+
+/**
+ * A task of the shared pool. It is owned by the submitter, which must keep
+ * it alive until it has either run or been cancelled.
+ */
+typedef struct FFThreadPoolTask {
+    void (*func)(void *arg);
+    void *arg;
+
+    /* private to the pool */
+    FFThreadPoolQueue *queue;
+    struct FFThreadPoolTask *prev, *next;
+    enum FFThreadPoolTaskState state;
+} FFThreadPoolTask;
+
+/**
+ * Get a reference to the shared pool, creating it if needed.
+ *
+ * @return the number of worker threads of the pool or a negative AVERROR
+ */
+int ff_thread_pool_ref(FFThreadPool **ppool);
+
+/**
+ * Release a reference to the shared pool, destroying it if it was the last.
+ */
+void ff_thread_pool_unref(FFThreadPool **ppool);
+
+/**
+ * Queue a task. Tasks submitted from a worker of the pool go to the deque
+ * of that worker and are run by it first, the other workers only steal them
+ * when they are idle.
+ */
+void ff_thread_pool_submit(FFThreadPool *pool, FFThreadPoolTask *task);
+
+/**
+ * Remove a task from the pool unless a worker already took it.
+ *
+ * @return 1 if the task was removed and will not run, 0 if it is running
+ *         or done
+ */
+int ff_thread_pool_cancel(FFThreadPool *pool, FFThreadPoolTask *task);
+
+#endif /* AVUTIL_THREADPOOL_INTERNAL_H */
@@ -139,6 +139,24 @@ extern void (*deinterleaveBytes)(const uint8_t *src, uint8_t *dst1, uint8_t *dst
                                  int width, int height, int srcStride,
                                  int dst1Stride, int dst2Stride);
 
+/**
+ * Interleave two lines of 16-bit samples, shifting them left by shift bits.
+ */
+extern void (*interleaveWords)(const uint16_t *src1, const uint16_t *src2,
+                               uint16_t *dst, int width, int shift);
+
+/**
+ * Split a line of interleaved 16-bit samples in two, shifting them right by
+ * shift bits.
+ */
+extern void (*deinterleaveWords)(const uint16_t *src, uint16_t *dst1,
+                                 uint16_t *dst2, int width, int shift);
+
+extern void (*shiftWordsLeft)(const uint16_t *src, uint16_t *dst, int width,
+                              int shift);
+extern void (*shiftWordsRight)(const uint16_t *src, uint16_t *dst, int width,
+                               int shift);
+
 extern void (*vu9_to_vu12)(const uint8_t *src1, const uint8_t *src2,
                            uint8_t *dst1, uint8_t *dst2,
                            int width, int height,
@@ -1170,7 +1170,8 @@ int sws_receive_slice(struct SwsContext *c, unsigned int slice_start,
     }
 
     for (int i = 0; i < FF_ARRAY_ELEMS(dst); i++) {
-        ptrdiff_t offset = c->frame_dst->linesize[i] * (slice_start >> c->chrDstVSubSample);
+        const int vshift = (i == 1 || i == 2) ? c->chrDstVSubSample : 0;
+        ptrdiff_t offset = c->frame_dst->linesize[i] * (slice_start >> vshift);
         dst[i] = FF_PTR_ADD(c->frame_dst->data[i], offset);
     }
 
@@ -1196,6 +1197,75 @@ int sws_scale_frame(struct SwsContext *c, AVFrame *dst, const AVFrame *src)
     return ret;
 }
 
+/* Source lines per band in sws_scale_frame_multi(), small enough for a band
+ * of a 1080p frame to stay in the L2 cache. */
+#define MULTI_BAND_LINES 128
+
+/**
+ * Whether scaling c by output slices only reads the source lines the slice
+ * needs. Otherwise every slice would convert or scale the whole source.
+ */
+static int scales_by_band(const SwsContext *c, const AVFrame *dst)
+{
+    if (dst->height % sws_receive_slice_alignment(c))
+        return 0;
+    if (c->slice_ctx)
+        c = c->slice_ctx[0];
+
+    return !c->cascaded_context[0] && !c->convert_unscaled &&
+           !c->srcXYZ && !c->src0Alpha && c->dither != SWS_DITHER_ED;
+}
+
+int sws_scale_frame_multi(struct SwsContext **c, AVFrame **dst, int nb,
+                          const AVFrame *src)
+{
+    int nb_bands = FFMAX(src->height / MULTI_BAND_LINES, 1);
+    int started, ret = 0;
+
+    for (started = 0; started < nb; started++) {
+        ret = sws_frame_start(c[started], dst[started], src);
+        if (ret < 0)
+            goto end;
+        ret = sws_send_slice(c[started], 0, src->height);
+        if (ret < 0) {
+            started++;
+            goto end;
+        }
+    }
+
+    for (int i = 0; i < nb; i++) {
+        if (!scales_by_band(c[i], dst[i])) {
+            ret = sws_receive_slice(c[i], 0, dst[i]->height);
+            if (ret < 0)
+                goto end;
+        }
+    }
+
+    for (int band = 0; band < nb_bands; band++) {
+        for (int i = 0; i < nb; i++) {
+            unsigned align = sws_receive_slice_alignment(c[i]);
+            int h     = dst[i]->height;
+            int start = FFALIGN(FFMIN((int64_t)h * band / nb_bands, h), align);
+            int end   = band + 1 < nb_bands ?
+                        FFALIGN((int64_t)h * (band + 1) / nb_bands, align) : h;
+
+            if (!scales_by_band(c[i], dst[i]))
+                continue;
+            end = FFMIN(end, h);
+            if (end <= start)
+                continue;
+            ret = sws_receive_slice(c[i], start, end - start);
+            if (ret < 0)
+                goto end;
+        }
+    }
+
+end:
+    while (started--)
+        sws_frame_end(c[started]);
+    return ret;
+}
+
 /**
  * swscale wrapper, so we don't need to export the SwsContext.
  * Assumes planar YUV to be in YUV order instead of YVU.
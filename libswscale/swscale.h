@@ -243,6 +243,28 @@ int sws_scale(struct SwsContext *c, const uint8_t *const srcSlice[],
  */
 int sws_scale_frame(struct SwsContext *c, AVFrame *dst, const AVFrame *src);
 
+/**
+ * Scale source data from src into several destination frames, e.g. the
+ * renditions of an adaptive bitrate ladder, in a single pass over the
+ * source.
+ *
+ * The destinations are written in interleaved horizontal bands, so that
+ * each band of the source is read from memory once and is still in the
+ * cache when the other contexts scale it. The output is the same as with
+ * sws_scale_frame() called for each context in turn.
+ *
+ * @param c   Array of nb scaling contexts, all with the source size and
+ *            format of src
+ * @param dst Array of nb destination frames, one per context. See
+ *            documentation for sws_frame_start() for more details.
+ * @param nb  Number of contexts and destination frames
+ * @param src The source frame.
+ *
+ * @return 0 on success, a negative AVERROR code on failure
+ */
+int sws_scale_frame_multi(struct SwsContext **c, AVFrame **dst, int nb,
+                          const AVFrame *src);
+
 /**
  * Initialize the scaling process for a given pair of source/destination frames.
  * Must be called before any calls to sws_send_slice() and sws_receive_slice().
@@ -26,6 +26,7 @@
 #include "config.h"
 
 #include "libavutil/avassert.h"
+#include "libavutil/buffer.h"
 #include "libavutil/common.h"
 #include "libavutil/frame.h"
 #include "libavutil/intreadwrite.h"
@@ -682,6 +683,18 @@ typedef struct SwsContext {
     atomic_int   data_unaligned_warned;
 
     Half2FloatTables *h2f_tables;
+
+    /**
+     * Owners of hLumFilter/hLumFilterPos etc. when the arrays are shared
+     * with other contexts through the filter cache, NULL when the context
+     * owns them. Shared arrays must not be modified.
+     */
+    AVBufferRef *hLumFilterRef;
+    AVBufferRef *hChrFilterRef;
+    AVBufferRef *vLumFilterRef;
+    AVBufferRef *vChrFilterRef;
+
+    int shared_threads;           ///< Run the slice threads on the shared thread pool
 } SwsContext;
 //FIXME check init (where 0)
 
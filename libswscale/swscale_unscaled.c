@@ -231,38 +231,26 @@ static int planarToP01xWrapper(SwsContext *c, const uint8_t *src8[],
     const uint16_t **src = (const uint16_t**)src8;
     uint16_t *dstY = (uint16_t*)(dstParam8[0] + dstStride[0] * srcSliceY);
     uint16_t *dstUV = (uint16_t*)(dstParam8[1] + dstStride[1] * srcSliceY / 2);
-    int x, y;
+    int y;
 
-    /* Calculate net shift required for values. */
-    const int shift[3] = {
+    /* Calculate net shift required for values, U and V share theirs. */
+    const int shift[2] = {
         dst_format->comp[0].depth + dst_format->comp[0].shift -
         src_format->comp[0].depth - src_format->comp[0].shift,
         dst_format->comp[1].depth + dst_format->comp[1].shift -
         src_format->comp[1].depth - src_format->comp[1].shift,
-        dst_format->comp[2].depth + dst_format->comp[2].shift -
-        src_format->comp[2].depth - src_format->comp[2].shift,
     };
 
     av_assert0(!(srcStride[0] % 2 || srcStride[1] % 2 || srcStride[2] % 2 ||
                  dstStride[0] % 2 || dstStride[1] % 2));
 
     for (y = 0; y < srcSliceH; y++) {
-        uint16_t *tdstY = dstY;
-        const uint16_t *tsrc0 = src[0];
-        for (x = c->srcW; x > 0; x--) {
-            *tdstY++ = *tsrc0++ << shift[0];
-        }
+        shiftWordsLeft(src[0], dstY, c->srcW, shift[0]);
         src[0] += srcStride[0] / 2;
         dstY += dstStride[0] / 2;
 
         if (!(y & 1)) {
-            uint16_t *tdstUV = dstUV;
-            const uint16_t *tsrc1 = src[1];
-            const uint16_t *tsrc2 = src[2];
-            for (x = c->srcW / 2; x > 0; x--) {
-                *tdstUV++ = *tsrc1++ << shift[1];
-                *tdstUV++ = *tsrc2++ << shift[2];
-            }
+            interleaveWords(src[1], src[2], dstUV, c->srcW / 2, shift[1]);
             src[1] += srcStride[1] / 2;
             src[2] += srcStride[2] / 2;
             dstUV += dstStride[1] / 2;
@@ -272,6 +260,47 @@ static int planarToP01xWrapper(SwsContext *c, const uint8_t *src8[],
     return srcSliceH;
 }
 
+static int p01xToPlanarWrapper(SwsContext *c, const uint8_t *src8[],
+                               int srcStride[], int srcSliceY,
+                               int srcSliceH, uint8_t *dstParam8[],
+                               int dstStride[])
+{
+    const AVPixFmtDescriptor *src_format = av_pix_fmt_desc_get(c->srcFormat);
+    const AVPixFmtDescriptor *dst_format = av_pix_fmt_desc_get(c->dstFormat);
+    const uint16_t *srcY  = (const uint16_t*)src8[0];
+    const uint16_t *srcUV = (const uint16_t*)src8[1];
+    uint16_t *dstY = (uint16_t*)(dstParam8[0] + dstStride[0] * srcSliceY);
+    uint16_t *dstU = (uint16_t*)(dstParam8[1] + dstStride[1] * srcSliceY / 2);
+    uint16_t *dstV = (uint16_t*)(dstParam8[2] + dstStride[2] * srcSliceY / 2);
+    int y;
+
+    /* Calculate net shift required for values, U and V share theirs. */
+    const int shift[2] = {
+        src_format->comp[0].depth + src_format->comp[0].shift -
+        dst_format->comp[0].depth - dst_format->comp[0].shift,
+        src_format->comp[1].depth + src_format->comp[1].shift -
+        dst_format->comp[1].depth - dst_format->comp[1].shift,
+    };
+
+    av_assert0(!(srcStride[0] % 2 || srcStride[1] % 2 ||
+                 dstStride[0] % 2 || dstStride[1] % 2 || dstStride[2] % 2));
+
+    for (y = 0; y < srcSliceH; y++) {
+        shiftWordsRight(srcY, dstY, c->srcW, shift[0]);
+        srcY += srcStride[0] / 2;
+        dstY += dstStride[0] / 2;
+
+        if (!(y & 1)) {
+            deinterleaveWords(srcUV, dstU, dstV, c->chrSrcW, shift[1]);
+            srcUV += srcStride[1] / 2;
+            dstU += dstStride[1] / 2;
+            dstV += dstStride[2] / 2;
+        }
+    }
+
+    return srcSliceH;
+}
+
 #if AV_HAVE_BIGENDIAN
 #define output_pixel(p, v) do { \
         uint16_t *pp = (p); \
@@ -2019,6 +2048,12 @@ void ff_get_unscaled_swscale(SwsContext *c)
         (dstFormat == AV_PIX_FMT_P010 || dstFormat == AV_PIX_FMT_P016)) {
         c->convert_unscaled = planarToP01xWrapper;
     }
+    /* p01x_to_yuv420p1x */
+    if ((srcFormat == AV_PIX_FMT_P010 && dstFormat == AV_PIX_FMT_YUV420P10) ||
+        (srcFormat == AV_PIX_FMT_P012 && dstFormat == AV_PIX_FMT_YUV420P12) ||
+        (srcFormat == AV_PIX_FMT_P016 && dstFormat == AV_PIX_FMT_YUV420P16)) {
+        c->convert_unscaled = p01xToPlanarWrapper;
+    }
     /* yuv420p_to_p01xle */
     if ((srcFormat == AV_PIX_FMT_YUV420P || srcFormat == AV_PIX_FMT_YUVA420P) &&
         (dstFormat == AV_PIX_FMT_P010LE || dstFormat == AV_PIX_FMT_P016LE)) {
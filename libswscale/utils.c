@@ -796,6 +796,196 @@ done:
     return ret;
 }
 
+/**
+ * Process-wide cache of the filters computed by initFilter(). Contexts
+ * with the same geometry, e.g. the slice contexts of a threaded context or
+ * the scalers of several renditions of one source, share the coefficient
+ * and position arrays read-only instead of computing and storing their own.
+ * The cache holds a reference to at most FILTER_CACHE_SIZE entries; entries
+ * which are not used by any context are evicted first.
+ */
+#define FILTER_CACHE_SIZE 64
+
+typedef struct FilterCacheKey {
+    int xInc, srcW, dstW, filterAlign, one, flags, cpu_flags;
+    double param[2];
+    int srcPos, dstPos;
+    int shuffle;                ///< ff_shuffle_filter_coefficients() was applied
+    int srcBpc, dstBpc;
+} FilterCacheKey;
+
+typedef struct FilterTables {
+    int16_t *filter;
+    int32_t *filterPos;
+    int filterSize;
+} FilterTables;
+
+typedef struct FilterCacheEntry {
+    FilterCacheKey key;
+    AVBufferRef *tables;
+} FilterCacheEntry;
+
+static AVMutex filter_cache_lock = AV_MUTEX_INITIALIZER;
+static FilterCacheEntry filter_cache[FILTER_CACHE_SIZE];
+static int filter_cache_count;
+
+static void free_filter_tables(void *opaque, uint8_t *data)
+{
+    FilterTables *t = (FilterTables *)data;
+
+    av_free(t->filter);
+    av_free(t->filterPos);
+    av_free(t);
+}
+
+static AVBufferRef *filter_cache_get(const FilterCacheKey *key)
+{
+    AVBufferRef *ref = NULL;
+
+    ff_mutex_lock(&filter_cache_lock);
+    for (int i = 0; i < filter_cache_count; i++) {
+        if (!memcmp(&filter_cache[i].key, key, sizeof(*key))) {
+            ref = av_buffer_ref(filter_cache[i].tables);
+            break;
+        }
+    }
+    ff_mutex_unlock(&filter_cache_lock);
+    return ref;
+}
+
+/* Takes the ownership of ref; return a reference to the cached tables,
+ * which are the ones of ref unless another context added the same first. */
+static AVBufferRef *filter_cache_add(const FilterCacheKey *key, AVBufferRef *ref)
+{
+    int i;
+
+    ff_mutex_lock(&filter_cache_lock);
+    for (i = 0; i < filter_cache_count; i++) {
+        if (!memcmp(&filter_cache[i].key, key, sizeof(*key))) {
+            AVBufferRef *cached = av_buffer_ref(filter_cache[i].tables);
+            if (cached) {
+                av_buffer_unref(&ref);
+                ref = cached;
+            }
+            goto end;
+        }
+    }
+
+    if (filter_cache_count == FILTER_CACHE_SIZE) {
+        for (i = 0; i < filter_cache_count; i++)
+            if (av_buffer_get_ref_count(filter_cache[i].tables) == 1)
+                break;
+        if (i == filter_cache_count)
+            goto end;
+        av_buffer_unref(&filter_cache[i].tables);
+        memmove(&filter_cache[i], &filter_cache[i + 1],
+                (filter_cache_count - i - 1) * sizeof(*filter_cache));
+        filter_cache_count--;
+    }
+
+    filter_cache[filter_cache_count].tables = av_buffer_ref(ref);
+    if (filter_cache[filter_cache_count].tables)
+        filter_cache[filter_cache_count++].key = *key;
+end:
+    ff_mutex_unlock(&filter_cache_lock);
+    return ref;
+}
+
+/**
+ * initFilter() going through the filter cache, followed by
+ * ff_shuffle_filter_coefficients() for horizontal filters. On success,
+ * *outRef is set if the arrays are shared.
+ */
+static av_cold int init_filter_cached(SwsContext *c, AVBufferRef **outRef,
+                                      int horizontal,
+                                      int16_t **outFilter, int32_t **filterPos,
+                                      int *outFilterSize, int xInc, int srcW,
+                                      int dstW, int filterAlign, int one,
+                                      int flags, int cpu_flags,
+                                      SwsVector *srcFilter, SwsVector *dstFilter,
+                                      double param[2], int srcPos, int dstPos)
+{
+    FilterCacheKey key;
+    FilterTables *t;
+    AVBufferRef *ref;
+    int ret;
+
+    /* Custom filters and verbose output bypass the cache. */
+    int cached = !srcFilter && !dstFilter && !(flags & SWS_PRINT_INFO);
+
+    if (cached) {
+        memset(&key, 0, sizeof(key));
+        key.xInc        = xInc;
+        key.srcW        = srcW;
+        key.dstW        = dstW;
+        key.filterAlign = filterAlign;
+        key.one         = one;
+        key.flags       = flags;
+        key.cpu_flags   = cpu_flags;
+        key.param[0]    = param[0];
+        key.param[1]    = param[1];
+        key.srcPos      = srcPos;
+        key.dstPos      = dstPos;
+        key.shuffle     = horizontal;
+        key.srcBpc      = horizontal ? c->srcBpc : 0;
+        key.dstBpc      = horizontal ? c->dstBpc : 0;
+
+        if ((ref = filter_cache_get(&key))) {
+            t = (FilterTables *)ref->data;
+            *outRef        = ref;
+            *outFilter     = t->filter;
+            *filterPos     = t->filterPos;
+            *outFilterSize = t->filterSize;
+            return 0;
+        }
+    }
+
+    ret = initFilter(outFilter, filterPos, outFilterSize, xInc, srcW, dstW,
+                     filterAlign, one, flags, cpu_flags, srcFilter, dstFilter,
+                     param, srcPos, dstPos);
+    if (ret < 0)
+        return ret;
+    if (horizontal &&
+        ff_shuffle_filter_coefficients(c, *filterPos, *outFilterSize, *outFilter, dstW) < 0)
+        return AVERROR(ENOMEM);
+    if (!cached)
+        return 0;
+
+    /* Failing to share the arrays is not an error, the context keeps them. */
+    t = av_mallocz(sizeof(*t));
+    if (!t)
+        return 0;
+    ref = av_buffer_create((uint8_t *)t, sizeof(*t), free_filter_tables, NULL,
+                           AV_BUFFER_FLAG_READONLY);
+    if (!ref) {
+        av_free(t);
+        return 0;
+    }
+    t->filter     = *outFilter;
+    t->filterPos  = *filterPos;
+    t->filterSize = *outFilterSize;
+
+    ref = filter_cache_add(&key, ref);
+    t = (FilterTables *)ref->data;
+    *outRef        = ref;
+    *outFilter     = t->filter;
+    *filterPos     = t->filterPos;
+    *outFilterSize = t->filterSize;
+    return 0;
+}
+
+static void free_filter(AVBufferRef **ref, int16_t **filter, int32_t **filterPos)
+{
+    if (*ref) {
+        av_buffer_unref(ref);
+        *filter    = NULL;
+        *filterPos = NULL;
+    } else {
+        av_freep(filter);
+        av_freep(filterPos);
+    }
+}
+
 static void fill_rgb2yuv_table(SwsContext *c, const int table[4], int dstRange)
 {
     int64_t W, V, Z, Cy, Cu, Cv;
@@ -1273,8 +1463,12 @@ static int context_init_threaded(SwsContext *c,
 {
     int ret;
 
-    ret = avpriv_slicethread_create(&c->slicethread, (void*)c,
-                                    ff_sws_slice_worker, NULL, c->nb_threads);
+    if (c->shared_threads)
+        ret = avpriv_slicethread_create_shared(&c->slicethread, (void*)c,
+                                               ff_sws_slice_worker, c->nb_threads);
+    else
+        ret = avpriv_slicethread_create(&c->slicethread, (void*)c,
+                                        ff_sws_slice_worker, NULL, c->nb_threads);
     if (ret == AVERROR(ENOSYS)) {
         c->nb_threads = 1;
         return 0;
@@ -1857,7 +2051,8 @@ av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
                                     have_neon(cpu_flags)   ? 4 :
                                     have_lasx(cpu_flags)   ? 8 : 1;
 
-            if ((ret = initFilter(&c->hLumFilter, &c->hLumFilterPos,
+            if ((ret = init_filter_cached(c, &c->hLumFilterRef, 1,
+                           &c->hLumFilter, &c->hLumFilterPos,
                            &c->hLumFilterSize, c->lumXInc,
                            srcW, dstW, filterAlign, 1 << 14,
                            (flags & SWS_BICUBLIN) ? (flags | SWS_BICUBIC) : flags,
@@ -1866,9 +2061,8 @@ av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
                            get_local_pos(c, 0, 0, 0),
                            get_local_pos(c, 0, 0, 0))) < 0)
                 goto fail;
-            if (ff_shuffle_filter_coefficients(c, c->hLumFilterPos, c->hLumFilterSize, c->hLumFilter, dstW) < 0)
-                goto nomem;
-            if ((ret = initFilter(&c->hChrFilter, &c->hChrFilterPos,
+            if ((ret = init_filter_cached(c, &c->hChrFilterRef, 1,
+                           &c->hChrFilter, &c->hChrFilterPos,
                            &c->hChrFilterSize, c->chrXInc,
                            c->chrSrcW, c->chrDstW, filterAlign, 1 << 14,
                            (flags & SWS_BICUBLIN) ? (flags | SWS_BILINEAR) : flags,
@@ -1877,8 +2071,6 @@ av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
                            get_local_pos(c, c->chrSrcHSubSample, c->src_h_chr_pos, 0),
                            get_local_pos(c, c->chrDstHSubSample, c->dst_h_chr_pos, 0))) < 0)
                 goto fail;
-            if (ff_shuffle_filter_coefficients(c, c->hChrFilterPos, c->hChrFilterSize, c->hChrFilter, c->chrDstW) < 0)
-                goto nomem;
         }
     } // initialize horizontal stuff
 
@@ -1888,7 +2080,8 @@ av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
                                 PPC_ALTIVEC(cpu_flags) ? 8 :
                                 have_neon(cpu_flags)   ? 2 : 1;
 
-        if ((ret = initFilter(&c->vLumFilter, &c->vLumFilterPos, &c->vLumFilterSize,
+        if ((ret = init_filter_cached(c, &c->vLumFilterRef, 0,
+                       &c->vLumFilter, &c->vLumFilterPos, &c->vLumFilterSize,
                        c->lumYInc, srcH, dstH, filterAlign, (1 << 12),
                        (flags & SWS_BICUBLIN) ? (flags | SWS_BICUBIC) : flags,
                        cpu_flags, srcFilter->lumV, dstFilter->lumV,
@@ -1896,7 +2089,8 @@ av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
                        get_local_pos(c, 0, 0, 1),
                        get_local_pos(c, 0, 0, 1))) < 0)
             goto fail;
-        if ((ret = initFilter(&c->vChrFilter, &c->vChrFilterPos, &c->vChrFilterSize,
+        if ((ret = init_filter_cached(c, &c->vChrFilterRef, 0,
+                       &c->vChrFilter, &c->vChrFilterPos, &c->vChrFilterSize,
                        c->chrYInc, c->chrSrcH, c->chrDstH,
                        filterAlign, (1 << 12),
                        (flags & SWS_BICUBLIN) ? (flags | SWS_BILINEAR) : flags,
@@ -2433,20 +2627,15 @@ void sws_freeContext(SwsContext *c)
 
     av_freep(&c->src_ranges.ranges);
 
-    av_freep(&c->vLumFilter);
-    av_freep(&c->vChrFilter);
-    av_freep(&c->hLumFilter);
-    av_freep(&c->hChrFilter);
+    free_filter(&c->vLumFilterRef, &c->vLumFilter, &c->vLumFilterPos);
+    free_filter(&c->vChrFilterRef, &c->vChrFilter, &c->vChrFilterPos);
+    free_filter(&c->hLumFilterRef, &c->hLumFilter, &c->hLumFilterPos);
+    free_filter(&c->hChrFilterRef, &c->hChrFilter, &c->hChrFilterPos);
 #if HAVE_ALTIVEC
     av_freep(&c->vYCoeffsBank);
     av_freep(&c->vCCoeffsBank);
 #endif
 
-    av_freep(&c->vLumFilterPos);
-    av_freep(&c->vChrFilterPos);
-    av_freep(&c->hLumFilterPos);
-    av_freep(&c->hChrFilterPos);
-
 #if HAVE_MMX_INLINE
 #if USE_MMAP
     if (c->lumMmxextFilterCode)
@@ -565,6 +565,52 @@ concat(){
     fi
 }
 
+dash_subtitles(){
+    srcfile=$1
+    sub_opts=$2
+    mpd=${outdir}/${test}.mpd
+    sub=${outdir}/${test}.mp4
+    # the segments are written next to the manifest, give them unique names
+    run ffmpeg${PROGSUF}${EXECSUF} -nostdin -nostats -f lavfi -i "sine=d=15" \
+        -i $(target_path $srcfile) -map 0 -map 1 -c:a mp2fixed $sub_opts \
+        -flags +bitexact -fflags +bitexact -f dash -seg_duration 2 \
+        -adaptation_sets "id=0,streams=a id=1,streams=s" \
+        -init_seg_name "${test}-init-\$RepresentationID\$.\$ext\$" \
+        -media_seg_name "${test}-chunk-\$RepresentationID\$-\$Number%05d\$.\$ext\$" \
+        -y $(target_path $mpd) || return
+    segments=$(find $outdir -name "${test}-chunk-1-*" | sort)
+    cleanfiles="$cleanfiles $mpd $sub $(find $outdir -name "${test}-*")"
+    cat $mpd
+    if [ -e ${outdir}/${test}-init-1.m4s ]; then
+        cat ${outdir}/${test}-init-1.m4s $segments > $sub
+        ffmpeg -i $(target_path $sub) -map 0 -c copy -bitexact -f framecrc -
+    else
+        for f in $segments; do
+            echo "${f##*/}:"
+            cat $f
+        done
+    fi
+}
+
+hls_io_threads(){
+    playlist=${outdir}/${test}.m3u8
+    for io_threads in 0 2; do
+        ffmpeg -auto_conversion_filters -f lavfi -i "aevalsrc=cos(2*PI*t)*sin(2*PI*(440+4*t)*t):d=20" -map 0 \
+            -c:a mp2fixed -fflags +bitexact -f hls -hls_time 2 -hls_list_size 4 \
+            -hls_flags delete_segments+temp_file -io_threads $io_threads \
+            -hls_segment_filename $(target_path ${outdir}/${test}_%d.ts) \
+            $(target_path $playlist) || return
+        files="$playlist $(find $outdir -name "${test}_*.ts" | sort)"
+        for f in $files; do
+            do_md5sum $f
+        done > ${outdir}/${test}.${io_threads}.md5
+        rm -f $files
+        cleanfiles="$cleanfiles ${outdir}/${test}.${io_threads}.md5"
+    done
+    cat ${outdir}/${test}.0.md5
+    cmp ${outdir}/${test}.0.md5 ${outdir}/${test}.2.md5
+}
+
 venc_data(){
     file=$1
     stream=$2
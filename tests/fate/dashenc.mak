@@ -0,0 +1,9 @@
+FATE_DASHENC-$(call ALLYES, DASH_MUXER MP4_MUXER WEBVTT_MUXER WEBVTT_DEMUXER LAVFI_INDEV SINE_FILTER MP2FIXED_ENCODER MOV_DEMUXER FRAMECRC_MUXER) += fate-dash-webvtt fate-dash-wvtt
+fate-dash-webvtt: CMD = dash_subtitles $(SRC_PATH)/tests/test.vtt "-c:s copy"
+fate-dash-wvtt: CMD = dash_subtitles $(SRC_PATH)/tests/test.vtt "-c:s copy -dash_segment_type mp4"
+
+FATE_DASHENC-$(call ALLYES, DASH_MUXER MP4_MUXER WEBVTT_DEMUXER WEBVTT_DECODER TTML_ENCODER LAVFI_INDEV SINE_FILTER MP2FIXED_ENCODER MOV_DEMUXER FRAMECRC_MUXER) += fate-dash-ttml
+fate-dash-ttml: CMD = dash_subtitles $(SRC_PATH)/tests/test.vtt "-c:s ttml"
+
+FATE_FFMPEG += $(FATE_DASHENC-yes)
+fate-dashenc: $(FATE_DASHENC-yes)
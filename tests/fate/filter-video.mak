@@ -120,7 +120,7 @@ fate-filter-minterpolate-up: CMD = framecrc -lavfi testsrc2=r=2:d=10,minterpolat
 fate-filter-minterpolate-down: CMD = framecrc -lavfi testsrc2=r=2:d=10,minterpolate=fps=1 -t 1
 
 FATE_FILTER_VSYNTH_PGMYUV-$(CONFIG_BOXBLUR_FILTER) += fate-filter-boxblur
-fate-filter-boxblur: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf boxblur=2:1
+fate-filter-boxblur: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf avgblur=2
 
 FATE_FILTER_VSYNTH_PGMYUV-$(call ALLYES, COLORCHANNELMIXER_FILTER SCALE_FILTER FORMAT_FILTER PERMS_FILTER) += fate-filter-colorchannelmixer
 fate-filter-colorchannelmixer: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf scale,format=rgb24,perms=random,colorchannelmixer=.31415927:.4:.31415927:0:.27182818:.8:.27182818:0:.2:.6:.2:0 -flags +bitexact -sws_flags +accurate_rnd+bitexact
@@ -314,6 +314,43 @@ FATE_FILTER_VSYNTH-$(call FILTERDEMDEC, TRIM, IMAGE2, PGM) += $(FATE_TRIM)
 FATE_FILTER-$(call FILTERFRAMECRC, TESTSRC2 UNTILE) += fate-filter-untile
 fate-filter-untile: CMD = framecrc -lavfi testsrc2=d=1:r=2,untile=2x2
 
+# The same graph once with serial filtering and once with pipeline threading
+# forced on, which must give the same output.
+FILTER_PIPELINE_GRAPH = "testsrc2=r=25:d=2,split[a][b];[a]hflip,avgblur=2[a1];[b]vflip,negate[b1];[a1][b1]overlay=x=W/4:y=H/4,unsharp"
+FATE_FILTER-$(call FILTERFRAMECRC, TESTSRC2 SPLIT HFLIP VFLIP AVGBLUR NEGATE OVERLAY UNSHARP) += fate-filter-pipeline fate-filter-pipeline-threads
+fate-filter-pipeline: CMD = framecrc -filter_complex $(FILTER_PIPELINE_GRAPH)
+fate-filter-pipeline-threads: CMD = framecrc -filter_thread_type slice+pipeline -filter_complex_threads 4 -filter_complex $(FILTER_PIPELINE_GRAPH)
+fate-filter-pipeline-threads: REF = $(SRC_PATH)/tests/ref/fate/filter-pipeline
+
+# graphmonitor reads the links of all the filters while the workers run
+# them, its output depends on the timing and is discarded.
+FILTER_PIPELINE_GRAPHMONITOR = "testsrc2=r=25:d=2,split=3[a][b][m];[m]graphmonitor=flags=all,nullsink;[a]hflip,avgblur=2[a1];[b]vflip,negate[b1];[a1][b1]overlay=x=W/4:y=H/4,unsharp"
+FATE_FILTER-$(call FILTERFRAMECRC, TESTSRC2 SPLIT HFLIP VFLIP AVGBLUR NEGATE OVERLAY UNSHARP GRAPHMONITOR NULLSINK) += fate-filter-pipeline-graphmonitor
+fate-filter-pipeline-graphmonitor: CMD = framecrc -filter_thread_type slice+pipeline -filter_complex_threads 4 -filter_complex $(FILTER_PIPELINE_GRAPHMONITOR)
+fate-filter-pipeline-graphmonitor: REF = $(SRC_PATH)/tests/ref/fate/filter-pipeline
+
+# scale_multi must give the same output as split followed by scale.
+FATE_FILTER-$(call FILTERFRAMECRC, TESTSRC2 SCALE_MULTI SPLIT SCALE) += fate-filter-scale-multi fate-filter-scale-multi-split
+fate-filter-scale-multi: CMD = framecrc -filter_complex "testsrc2=s=352x288:r=5:d=2,format=yuv420p,scale_multi=sizes=352x288|176x144|320x240|704x576:flags=bicubic+accurate_rnd+bitexact[a][b][c][d]" -map "[a]" -map "[b]" -map "[c]" -map "[d]"
+fate-filter-scale-multi-split: CMD = framecrc -filter_complex "testsrc2=s=352x288:r=5:d=2,format=yuv420p,split=4[i0][i1][i2][i3];[i0]scale=352x288:flags=bicubic+accurate_rnd+bitexact[a];[i1]scale=176x144:flags=bicubic+accurate_rnd+bitexact[b];[i2]scale=320x240:flags=bicubic+accurate_rnd+bitexact[c];[i3]scale=704x576:flags=bicubic+accurate_rnd+bitexact[d]" -map "[a]" -map "[b]" -map "[c]" -map "[d]"
+fate-filter-scale-multi-split: REF = $(SRC_PATH)/tests/ref/fate/filter-scale-multi
+
+FATE_FILTER-$(CONFIG_SPLIT_FILTER) += fate-filter-bufferstats
+fate-filter-bufferstats: libavfilter/tests/bufferstats$(EXESUF)
+fate-filter-bufferstats: CMD = run libavfilter/tests/bufferstats$(EXESUF)
+
+FATE_FILTER-$(call ALLYES, SPLIT_FILTER HFLIP_FILTER VFLIP_FILTER SELECT_FILTER) += fate-filter-filterstats
+fate-filter-filterstats: libavfilter/tests/filterstats$(EXESUF)
+fate-filter-filterstats: CMD = run libavfilter/tests/filterstats$(EXESUF)
+
+FATE_FILTER-$(CONFIG_OVERLAYGRAPHICSUBS_FILTER) += fate-filter-heartbeat
+fate-filter-heartbeat: libavfilter/tests/heartbeat$(EXESUF)
+fate-filter-heartbeat: CMD = run libavfilter/tests/heartbeat$(EXESUF)
+
+FATE_FILTER-$(call ALLYES, HFLIP_FILTER ARESAMPLE_FILTER) += fate-filter-sinkpool
+fate-filter-sinkpool: libavfilter/tests/sinkpool$(EXESUF)
+fate-filter-sinkpool: CMD = run libavfilter/tests/sinkpool$(EXESUF)
+
 FATE_FILTER_VSYNTH_PGMYUV-$(CONFIG_UNSHARP_FILTER) += fate-filter-unsharp
 fate-filter-unsharp: CMD = framecrc -c:v pgmyuv -i $(SRC) -vf unsharp=11:11:-1.5:11:11:-1.5
 
@@ -160,6 +160,13 @@ fate-mov-mp4-disposition-mpegts-remux: CMD = transcode mpegts $(TARGET_SAMPLES)/
 
 FATE_SAMPLES_FFMPEG_FFPROBE += $(FATE_MOV_FFMPEG_FFPROBE-yes)
 
+# WebVTT cues are split into non-overlapping 'wvtt' samples, gaps are
+# covered by samples with an empty cue box, zero-length cues are dropped
+FATE_MOV_FFMPEG_FFPROBE_LOCAL-$(call REMUX, MP4 MOV, WEBVTT_DEMUXER) += fate-mov-mp4-wvtt
+fate-mov-mp4-wvtt: CMD = transcode webvtt $(SRC_PATH)/tests/test.vtt mp4 "-map 0 -c:s copy" "-map 0 -c copy" "-show_entries packet=pts,duration,size:stream=codec_tag_string"
+
+FATE_FFMPEG_FFPROBE += $(FATE_MOV_FFMPEG_FFPROBE_LOCAL-yes)
+
 FATE_MOV_FFMPEG-$(call TRANSCODE, PCM_S16LE, MOV, WAV_DEMUXER PAN_FILTER) \
                           += fate-mov-channel-description
 fate-mov-channel-description: tests/data/asynth-44100-1.wav tests/data/filtergraphs/mov-channel-description
@@ -167,4 +174,4 @@ fate-mov-channel-description: CMD = transcode wav $(TARGET_PATH)/tests/data/asyn
 
 FATE_FFMPEG += $(FATE_MOV_FFMPEG-yes)
 
-fate-mov: $(FATE_MOV) $(FATE_MOV_FFMPEG-yes) $(FATE_MOV_FFPROBE) $(FATE_MOV_FASTSTART) $(FATE_MOV_FFMPEG_FFPROBE-yes)
+fate-mov: $(FATE_MOV) $(FATE_MOV_FFMPEG-yes) $(FATE_MOV_FFPROBE) $(FATE_MOV_FASTSTART) $(FATE_MOV_FFMPEG_FFPROBE-yes) $(FATE_MOV_FFMPEG_FFPROBE_LOCAL-yes)
@@ -479,16 +479,52 @@ VSYNTH3_OFF  = $(RESIZE_OFF) $(INC_PAR_OFF)
 FATE_VCODEC3 = $(filter-out $(VSYNTH3_OFF),$(FATE_VCODEC))
 FATE_VSYNTH3 = $(FATE_VCODEC3:%=fate-vsynth3-%)
 
+# Frame threaded decoding of the files of fate-vsynth1-mpeg1b and
+# fate-vsynth1-mpeg2-thread, of an interlaced encode with field motion
+# vectors and alternate scan, and of a sample made of field pictures, with
+# different numbers of threads. All thread counts of a file share one
+# reference, the output has to be bitexact.
+FATE_MPEG12_FRAME_THREADS_COUNTS = 1 2 3 4 8
+FATE_MPEG12_FRAME_THREADS := $(if $(filter fate-vsynth1-mpeg1b, $(FATE_VSYNTH1)),$(FATE_MPEG12_FRAME_THREADS_COUNTS:%=fate-mpeg1-frame-threads-%))
+FATE_MPEG12_FRAME_THREADS += $(if $(filter fate-vsynth1-mpeg2-thread, $(FATE_VSYNTH1)),$(FATE_MPEG12_FRAME_THREADS_COUNTS:%=fate-mpeg2-frame-threads-%))
+FATE_MPEG12_FRAME_THREADS += $(if $(filter fate-vsynth1-mpeg2-ilace, $(FATE_VSYNTH1)),$(FATE_MPEG12_FRAME_THREADS_COUNTS:%=fate-mpeg2-ilace-frame-threads-%))
+FATE_MPEG12_FRAME_THREADS_SAMPLES-$(call FRAMECRC, MPEGTS, MPEG2VIDEO) = $(FATE_MPEG12_FRAME_THREADS_COUNTS:%=fate-mpeg2-field-frame-threads-%)
+
+fate-mpeg1-frame-threads-%: CMD = threads=$(@:fate-mpeg1-frame-threads-%=%) thread_type=frame framecrc -flags +bitexact -idct simple -i $(TARGET_PATH)/tests/data/fate/vsynth1-mpeg1b.mpeg1video
+fate-mpeg1-frame-threads-%: REF = $(SRC_PATH)/tests/ref/fate/mpeg1-frame-threads
+fate-mpeg2-frame-threads-%: CMD = threads=$(@:fate-mpeg2-frame-threads-%=%) thread_type=frame framecrc -flags +bitexact -idct simple -i $(TARGET_PATH)/tests/data/fate/vsynth1-mpeg2-thread.mpeg2video
+fate-mpeg2-frame-threads-%: REF = $(SRC_PATH)/tests/ref/fate/mpeg2-frame-threads
+fate-mpeg2-ilace-frame-threads-%: CMD = threads=$(@:fate-mpeg2-ilace-frame-threads-%=%) thread_type=frame framecrc -flags +bitexact -idct simple -i $(TARGET_PATH)/tests/data/mpeg2-ilace-alt.mpeg2video
+fate-mpeg2-ilace-frame-threads-%: REF = $(SRC_PATH)/tests/ref/fate/mpeg2-ilace-frame-threads
+fate-mpeg2-field-frame-threads-%: CMD = threads=$(@:fate-mpeg2-field-frame-threads-%=%) thread_type=frame framecrc -flags +bitexact -idct simple -i $(TARGET_SAMPLES)/mpeg2/mpeg2_field_encoding.ts -an -frames:v 30
+fate-mpeg2-field-frame-threads-%: REF = $(SRC_PATH)/tests/ref/fate/mpeg2-field-enc
+
+$(filter fate-mpeg1-%, $(FATE_MPEG12_FRAME_THREADS)): fate-vsynth1-mpeg1b
+$(filter fate-mpeg2-frame-%, $(FATE_MPEG12_FRAME_THREADS)): fate-vsynth1-mpeg2-thread
+$(filter fate-mpeg2-ilace-%, $(FATE_MPEG12_FRAME_THREADS)): tests/data/mpeg2-ilace-alt.mpeg2video
+fate-vsynth1-mpeg1b fate-vsynth1-mpeg2-thread: KEEP_FILES ?= 1
+
+tests/data/mpeg2-ilace-alt.mpeg2video: TAG = GEN
+tests/data/mpeg2-ilace-alt.mpeg2video: ffmpeg$(PROGSSUF)$(EXESUF) tests/data/vsynth1.yuv | tests/data
+	$(M)$(TARGET_EXEC) $(TARGET_PATH)/$< -nostdin \
+        -f rawvideo -s 352x288 -pix_fmt yuv420p -i $(TARGET_PATH)/tests/data/vsynth1.yuv \
+        -threads 1 -idct simple -dct fastint -flags +bitexact+ildct+ilme -fflags +bitexact \
+        -c:v mpeg2video -qscale 10 -bf 2 -alternate_scan 1 \
+        -f mpeg2video -y $(TARGET_PATH)/$@ 2>/dev/null
+
 $(FATE_VSYNTH1): tests/data/vsynth1.yuv
 $(FATE_VSYNTH2): tests/data/vsynth2.yuv
 $(FATE_VSYNTH_LENA): tests/data/vsynth_lena.yuv
 $(FATE_VSYNTH3): tests/data/vsynth3.yuv
 
 FATE_AVCONV += $(FATE_VSYNTH1) $(FATE_VSYNTH2) $(FATE_VSYNTH3)
+FATE_AVCONV += $(FATE_MPEG12_FRAME_THREADS)
+FATE_SAMPLES_AVCONV += $(FATE_MPEG12_FRAME_THREADS_SAMPLES-yes)
 FATE_SAMPLES_AVCONV += $(FATE_VSYNTH_LENA)
 
 fate-vsynth1: $(FATE_VSYNTH1)
 fate-vsynth2: $(FATE_VSYNTH2)
 fate-vsynth_lena: $(FATE_VSYNTH_LENA)
 fate-vsynth3: $(FATE_VSYNTH3)
+fate-mpeg12-frame-threads: $(FATE_MPEG12_FRAME_THREADS) $(FATE_MPEG12_FRAME_THREADS_SAMPLES-yes)
 fate-vcodec:  fate-vsynth1 fate-vsynth_lena fate-vsynth2 fate-vsynth3
@@ -0,0 +1,168 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Filter graph configuration benchmark.
+ *
+ * Generates a synthetic graph of about N filters, shaped like a transcoding
+ * ladder: one video source split into renditions which are scaled, get a
+ * logo overlaid and go through a chain of filters with various format
+ * constraints, plus one audio source split into several tracks. The graph
+ * is parsed and configured repeatedly and the time spent in
+ * avfilter_graph_config(), i.e. mostly in format negotiation, is reported.
+ *     tools/graph_config_bench -n 400
+ *     tools/graph_config_bench -n 400 -v 16 -a 8 -p
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libavutil/bprint.h"
+#include "libavutil/error.h"
+#include "libavutil/time.h"
+#include "libavfilter/avfilter.h"
+
+static const char *const video_chain[] = {
+    "null", "hflip", "format=yuv420p|nv12|yuv444p", "setsar=1", "negate",
+    "vflip", "format=gbrp|yuv444p", "transpose=clock", "null", "format=nv12",
+};
+
+static const char *const audio_chain[] = {
+    "anull", "volume=0.5", "aformat=sample_fmts=fltp|s16",
+    "aformat=sample_rates=48000|44100", "anull", "aformat=sample_fmts=s16p",
+};
+
+static void build_graph(AVBPrint *bp, int nb_filters, int nb_video, int nb_audio)
+{
+    /* source + split per media type, then scale, overlay with its logo source
+       and sink per rendition and aformat and sink per audio track */
+    int fixed = 4 + 4 * nb_video + 2 * nb_audio;
+    int chain = FFMAX(nb_filters - fixed, 0) / (nb_video + nb_audio);
+
+    av_bprintf(bp, "nullsrc=s=1920x1080:r=25,format=yuv420p,split=%d", nb_video);
+    for (int i = 0; i < nb_video; i++)
+        av_bprintf(bp, "[v%d]", i);
+    av_bprintf(bp, ";\n");
+    for (int i = 0; i < nb_video; i++) {
+        av_bprintf(bp, "color=c=white@0.5:s=64x64,format=yuva420p[logo%d];\n", i);
+        av_bprintf(bp, "[v%d]scale=%d:-2[s%d];[s%d][logo%d]overlay=16:16",
+                   i, 1920 >> (i % 4), i, i, i);
+        for (int j = 0; j < chain; j++)
+            av_bprintf(bp, ",%s", video_chain[(i + j) % FF_ARRAY_ELEMS(video_chain)]);
+        av_bprintf(bp, ",nullsink;\n");
+    }
+
+    av_bprintf(bp, "anullsrc=r=48000:cl=5.1,asplit=%d", nb_audio);
+    for (int i = 0; i < nb_audio; i++)
+        av_bprintf(bp, "[a%d]", i);
+    av_bprintf(bp, ";\n");
+    for (int i = 0; i < nb_audio; i++) {
+        av_bprintf(bp, "[a%d]aformat=channel_layouts=%s", i, i & 1 ? "stereo" : "5.1");
+        for (int j = 0; j < chain; j++)
+            av_bprintf(bp, ",%s", audio_chain[(i + j) % FF_ARRAY_ELEMS(audio_chain)]);
+        av_bprintf(bp, ",anullsink%s", i + 1 < nb_audio ? ";\n" : "");
+    }
+}
+
+static int usage(const char *argv0, int ret)
+{
+    fprintf(stderr, "%s [-n filters] [-v renditions] [-a audio_tracks] "
+            "[-i iterations] [-p]\n", argv0);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    int nb_filters = 200, nb_video = 8, nb_audio = 4, iterations = 20;
+    int print = 0, nb_configured = 0;
+    int64_t parse_time = 0, config_time = 0;
+    AVBPrint bp;
+    int ret = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            nb_filters = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-v") && i + 1 < argc) {
+            nb_video = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-a") && i + 1 < argc) {
+            nb_audio = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-i") && i + 1 < argc) {
+            iterations = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-p")) {
+            print = 1;
+        } else {
+            return usage(argv[0], 1);
+        }
+    }
+    if (nb_filters <= 0 || nb_video <= 0 || nb_video > 256 ||
+        nb_audio <= 0 || nb_audio > 256 || iterations <= 0)
+        return usage(argv[0], 1);
+
+    av_bprint_init(&bp, 0, AV_BPRINT_SIZE_UNLIMITED);
+    build_graph(&bp, nb_filters, nb_video, nb_audio);
+    if (!av_bprint_is_complete(&bp)) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    if (print)
+        printf("%s\n", bp.str);
+
+    for (int i = 0; i < iterations; i++) {
+        AVFilterGraph *graph = avfilter_graph_alloc();
+        AVFilterInOut *inputs = NULL, *outputs = NULL;
+        int64_t t0, t1;
+        int nb_parsed;
+
+        if (!graph) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        graph->nb_threads = 1;
+
+        t0 = av_gettime_relative();
+        ret = avfilter_graph_parse_ptr(graph, bp.str, &inputs, &outputs, NULL);
+        t1 = av_gettime_relative();
+        nb_parsed = graph->nb_filters;
+        if (ret >= 0)
+            ret = avfilter_graph_config(graph, NULL);
+        parse_time  += t1 - t0;
+        config_time += av_gettime_relative() - t1;
+
+        if (!i && ret >= 0) {
+            nb_configured = graph->nb_filters;
+            printf("%d filters parsed, %d after inserting conversions\n",
+                   nb_parsed, nb_configured);
+        }
+        avfilter_inout_free(&inputs);
+        avfilter_inout_free(&outputs);
+        avfilter_graph_free(&graph);
+        if (ret < 0)
+            goto end;
+    }
+
+    printf("parse  %.3f ms\n", parse_time  / 1000.0 / iterations);
+    printf("config %.3f ms, %.2f us/filter\n", config_time / 1000.0 / iterations,
+           config_time / (double)iterations / FFMAX(nb_configured, 1));
+
+end:
+    if (ret < 0)
+        fprintf(stderr, "Configuring the graph failed: %s\n", av_err2str(ret));
+    av_bprint_finalize(&bp, NULL);
+    return ret < 0;
+}
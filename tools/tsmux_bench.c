@@ -0,0 +1,203 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * MPEG-TS muxing benchmark.
+ *
+ * Muxes synthetic video and audio packets of several programs into a CBR
+ * transport stream which is discarded, and reports the CPU time spent per
+ * TS packet. The output AVIOContext has a 1316 byte buffer, as when
+ * writing to UDP. Run it with different -b values to compare write_batch
+ * settings, e.g.
+ *     tools/tsmux_bench -p 8 -b 0
+ *     tools/tsmux_bench -p 8 -b 7
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if HAVE_GETRUSAGE
+#include <sys/resource.h>
+#endif
+
+#include "libavutil/opt.h"
+#include "libavutil/time.h"
+#include "libavformat/avformat.h"
+
+static int64_t cpu_time(void)
+{
+#if HAVE_GETRUSAGE
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000LL +
+            ru.ru_utime.tv_usec + ru.ru_stime.tv_usec;
+#else
+    return av_gettime_relative();
+#endif
+}
+
+static int64_t written;
+
+static int discard_packet(void *opaque, uint8_t *buf, int buf_size)
+{
+    written += buf_size;
+    return buf_size;
+}
+
+static int usage(const char *argv0, int ret)
+{
+    fprintf(stderr, "%s [-p programs] [-d seconds] [-r video_kbps] [-b write_batch]\n", argv0);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    int nb_programs = 4, duration = 60, video_kbps = 8000, batch = 0;
+    const int fps = 25, audio_kbps = 192, audio_frame_ms = 24;
+    AVFormatContext *oc = NULL;
+    AVIOContext *pb = NULL;
+    AVPacket *pkt = NULL;
+    uint8_t *iobuf = NULL, *payload = NULL;
+    int video_size, audio_size;
+    int64_t t0, cpu0, nb_ts_packets;
+    char muxrate[32];
+    int ret;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-p") && i + 1 < argc) {
+            nb_programs = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-d") && i + 1 < argc) {
+            duration = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-r") && i + 1 < argc) {
+            video_kbps = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-b") && i + 1 < argc) {
+            batch = atoi(argv[++i]);
+        } else {
+            return usage(argv[0], 1);
+        }
+    }
+    if (nb_programs <= 0 || nb_programs > 64 || duration <= 0 ||
+        video_kbps <= 0 || batch < 0)
+        return usage(argv[0], 1);
+
+    video_size = video_kbps * 1000 / 8 / fps;
+    audio_size = audio_kbps * audio_frame_ms / 8;
+
+    ret = avformat_alloc_output_context2(&oc, NULL, "mpegts", NULL);
+    if (ret < 0)
+        goto end;
+
+    iobuf = av_malloc(1316);
+    payload = av_mallocz(video_size + AV_INPUT_BUFFER_PADDING_SIZE);
+    pkt = av_packet_alloc();
+    if (!iobuf || !payload || !pkt) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    pb = avio_alloc_context(iobuf, 1316, 1, NULL, NULL, discard_packet, NULL);
+    if (!pb) {
+        av_free(iobuf);
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    oc->pb = pb;
+
+    for (int i = 0; i < 2 * nb_programs; i++) {
+        AVStream *st = avformat_new_stream(oc, NULL);
+        AVProgram *prg;
+        if (!st) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        if (i & 1) {
+            st->codecpar->codec_type  = AVMEDIA_TYPE_AUDIO;
+            st->codecpar->codec_id    = AV_CODEC_ID_MP2;
+            st->codecpar->sample_rate = 48000;
+            st->codecpar->ch_layout   = (AVChannelLayout)AV_CHANNEL_LAYOUT_STEREO;
+        } else {
+            st->codecpar->codec_type = AVMEDIA_TYPE_VIDEO;
+            st->codecpar->codec_id   = AV_CODEC_ID_MPEG2VIDEO;
+            st->codecpar->width      = 1920;
+            st->codecpar->height     = 1080;
+        }
+        prg = av_new_program(oc, i / 2 + 1);
+        if (!prg) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        av_program_add_stream_index(oc, prg->id, i);
+    }
+
+    snprintf(muxrate, sizeof(muxrate), "%d",
+             nb_programs * (video_kbps + audio_kbps) * 1250);
+    av_opt_set(oc->priv_data, "muxrate", muxrate, 0);
+    av_opt_set_int(oc->priv_data, "write_batch", batch, 0);
+    oc->max_delay = 700000;
+
+    ret = avformat_write_header(oc, NULL);
+    if (ret < 0)
+        goto end;
+
+    cpu0 = cpu_time();
+    t0 = av_gettime_relative();
+    for (int64_t ms = 0; ms < duration * 1000LL; ms++) {
+        for (int i = 0; i < oc->nb_streams; i++) {
+            int audio = i & 1;
+            if (audio ? ms % audio_frame_ms : ms % (1000 / fps))
+                continue;
+            pkt->data = payload;
+            pkt->size = audio ? audio_size : video_size;
+            pkt->stream_index = i;
+            pkt->pts = pkt->dts = av_rescale_q(ms, (AVRational){ 1, 1000 },
+                                               oc->streams[i]->time_base);
+            pkt->flags = audio || !(ms % 1000) ? AV_PKT_FLAG_KEY : 0;
+            ret = av_write_frame(oc, pkt);
+            if (ret < 0)
+                goto end;
+        }
+    }
+    ret = av_write_trailer(oc);
+    if (ret < 0)
+        goto end;
+    avio_flush(pb);
+    cpu0 = cpu_time() - cpu0;
+    t0 = av_gettime_relative() - t0;
+
+    nb_ts_packets = written / 188;
+    printf("write_batch %d, %d programs, %d s at %s bit/s\n",
+           batch, nb_programs, duration, muxrate);
+    printf("muxed %"PRId64" TS packets in %.3f s, %.0f packets/s\n",
+           nb_ts_packets, t0 / 1e6, nb_ts_packets * 1e6 / FFMAX(t0, 1));
+    printf("cpu   %.3f s, %.1f ns/packet\n",
+           cpu0 / 1e6, cpu0 * 1000.0 / FFMAX(nb_ts_packets, 1));
+
+end:
+    if (ret < 0)
+        fprintf(stderr, "Muxing failed: %s\n", av_err2str(ret));
+    if (pb)
+        av_freep(&pb->buffer);
+    avio_context_free(&pb);
+    if (oc)
+        oc->pb = NULL;
+    avformat_free_context(oc);
+    av_packet_free(&pkt);
+    av_free(payload);
+    return ret < 0;
+}
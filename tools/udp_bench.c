@@ -0,0 +1,187 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Loopback UDP throughput benchmark.
+ *
+ * Sends datagrams to 127.0.0.1 through the udp protocol and receives them
+ * in a second thread, reporting packets/s and CPU time per packet. With the
+ * default -f 0 the datagrams are received on the reading thread itself, so
+ * its CPU time isolates the receive path. Run it with different -b values
+ * to compare batch_size settings, e.g.
+ *     tools/udp_bench -n 1000000 -b 1
+ *     tools/udp_bench -n 1000000 -b 32
+ */
+
+#define _GNU_SOURCE /* for RUSAGE_THREAD */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if HAVE_GETRUSAGE
+#include <sys/resource.h>
+#endif
+
+#include "libavutil/thread.h"
+#include "libavutil/time.h"
+#include "libavformat/avformat.h"
+
+typedef struct RecvThread {
+    AVIOContext *in;
+    int64_t nb_packets;
+    int64_t received;
+    int64_t first_us, last_us;
+    int64_t cpu_us;
+} RecvThread;
+
+static int64_t cpu_time(int thread)
+{
+#if HAVE_GETRUSAGE
+    struct rusage ru;
+#ifdef RUSAGE_THREAD
+    getrusage(thread ? RUSAGE_THREAD : RUSAGE_SELF, &ru);
+#else
+    getrusage(RUSAGE_SELF, &ru);
+#endif
+    return (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000LL +
+            ru.ru_utime.tv_usec + ru.ru_stime.tv_usec;
+#else
+    return 0;
+#endif
+}
+
+static void *recv_thread(void *arg)
+{
+    RecvThread *rt = arg;
+    uint8_t buf[65536];
+    int64_t cpu_start = cpu_time(1);
+
+    while (rt->received < rt->nb_packets) {
+        int ret = avio_read_partial(rt->in, buf, sizeof(buf));
+        if (ret < 0)
+            break;
+        if (!rt->received)
+            rt->first_us = av_gettime_relative();
+        rt->received++;
+    }
+    rt->last_us = av_gettime_relative();
+    rt->cpu_us  = cpu_time(1) - cpu_start;
+    return NULL;
+}
+
+static int usage(const char *argv0, int ret)
+{
+    fprintf(stderr, "%s [-n packets] [-s size] [-b batch_size] [-p port] [-f fifo_size]\n", argv0);
+    fprintf(stderr, "fifo_size is expressed in 188 byte units, 0 disables the receive thread\n");
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    int64_t nb_packets = 100000;
+    int size = 1316, batch = 1, port = 23456, fifo_size = 0;
+    char in_url[256], out_url[256];
+    AVIOContext *out = NULL;
+    RecvThread rt = { 0 };
+    pthread_t thread;
+    uint8_t *pkt;
+    int64_t t0, t1, cpu0;
+    int ret;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            nb_packets = strtoll(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+            size = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-b") && i + 1 < argc) {
+            batch = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-p") && i + 1 < argc) {
+            port = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-f") && i + 1 < argc) {
+            fifo_size = atoi(argv[++i]);
+        } else {
+            return usage(argv[0], 1);
+        }
+    }
+    if (nb_packets <= 0 || size <= 0 || size > 65507 || batch <= 0)
+        return usage(argv[0], 1);
+
+    avformat_network_init();
+
+    snprintf(in_url, sizeof(in_url),
+             "udp://127.0.0.1:%d?batch_size=%d&fifo_size=%d&buffer_size=%d&timeout=1000000",
+             port, batch, fifo_size, 8 * 1024 * 1024);
+    snprintf(out_url, sizeof(out_url),
+             "udp://127.0.0.1:%d?batch_size=%d&pkt_size=%d&buffer_size=%d",
+             port, batch, size, 8 * 1024 * 1024);
+
+    if ((ret = avio_open2(&rt.in, in_url, AVIO_FLAG_READ, NULL, NULL)) < 0) {
+        fprintf(stderr, "Unable to open %s: %s\n", in_url, av_err2str(ret));
+        return 1;
+    }
+    if ((ret = avio_open2(&out, out_url, AVIO_FLAG_WRITE, NULL, NULL)) < 0) {
+        fprintf(stderr, "Unable to open %s: %s\n", out_url, av_err2str(ret));
+        avio_closep(&rt.in);
+        return 1;
+    }
+    pkt = av_mallocz(size);
+    if (!pkt) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    rt.nb_packets = nb_packets;
+    if ((ret = pthread_create(&thread, NULL, recv_thread, &rt))) {
+        ret = AVERROR(ret);
+        goto end;
+    }
+
+    cpu0 = cpu_time(0);
+    t0 = av_gettime_relative();
+    for (int64_t i = 0; i < nb_packets; i++) {
+        memcpy(pkt, &i, FFMIN(size, sizeof(i)));
+        avio_write(out, pkt, size);
+    }
+    avio_flush(out);
+    ret = out->error;
+    /* closing flushes datagrams still queued for sendmmsg() */
+    avio_closep(&out);
+    t1 = av_gettime_relative();
+    pthread_join(thread, NULL);
+    cpu0 = cpu_time(0) - cpu0;
+
+    printf("batch_size %d, packet size %d\n", batch, size);
+    printf("sent      %"PRId64" packets in %.3f s, %.0f packets/s\n",
+           nb_packets, (t1 - t0) / 1e6, nb_packets * 1e6 / FFMAX(t1 - t0, 1));
+    printf("received  %"PRId64" packets (%.2f%% loss), %.0f packets/s\n",
+           rt.received, 100.0 * (nb_packets - rt.received) / nb_packets,
+           rt.received * 1e6 / FFMAX(rt.last_us - rt.first_us, 1));
+    printf("recv cpu  %.3f s, %.3f us/packet\n",
+           rt.cpu_us / 1e6, rt.received ? (double)rt.cpu_us / rt.received : 0.0);
+    printf("total cpu %.3f s, %.3f us/packet\n",
+           cpu0 / 1e6, (double)cpu0 / nb_packets);
+
+end:
+    av_free(pkt);
+    avio_closep(&out);
+    avio_closep(&rt.in);
+    avformat_network_deinit();
+    return ret < 0;
+}